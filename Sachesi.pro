@@ -71,25 +71,58 @@ SOURCES += \
     src/sachesi.cpp \
     src/search/mainnet.cpp \
     src/search/scanner.cpp \
+    src/search/scanengine.cpp \
+    src/search/scanresultmodel.cpp \
+    src/search/responsecache.cpp \
+    src/search/updateparser.cpp \
+    src/search/releasedatabase.cpp \
+    src/search/linkgenerator.cpp \
     src/splitter.cpp \
     src/ports.cpp \
+    src/portscore.cpp \
     src/apps.cpp \
+    src/appmodel.cpp \
+    src/downloadfile.cpp \
+    src/linkverifier.cpp \
+    src/deltaplanner.cpp \
+    src/downloadstore.cpp \
+    src/bandwidth.cpp \
     src/fs/ifs.cpp \
     src/fs/fs.cpp \
     src/fs/rcfs.cpp \
-    src/fs/qnx6.cpp
+    src/fs/qnx6.cpp \
+    src/fs/hash.cpp \
+    src/fs/sink.cpp \
+    src/fs/nodetable.cpp
 
 HEADERS += \
     src/search/mainnet.h \
     src/search/scanner.h \
+    src/search/scanengine.h \
+    src/search/scanresultmodel.h \
+    src/search/responsecache.h \
+    src/search/updateparser.h \
+    src/search/releasedatabase.h \
+    src/search/linkgenerator.h \
     src/splitter.h \
     src/ports.h \
+    src/portscore.h \
+    src/packedversion.h \
     src/downloadinfo.h \
+    src/downloadfile.h \
+    src/linkverifier.h \
+    src/deltaplanner.h \
+    src/downloadstore.h \
+    src/bandwidth.h \
     src/apps.h \
+    src/appmodel.h \
     src/fs/ifs.h \
     src/fs/fs.h \
     src/fs/rcfs.h \
     src/fs/qnx6.h \
+    src/fs/hash.h \
+    src/fs/sink.h \
+    src/fs/nodetable.h \
     src/carrierinfo.h \
     src/search/discoveredrelease.h \
     src/autoloaderwriter.h \
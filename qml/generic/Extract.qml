@@ -29,6 +29,7 @@ Item {
                         case 3: splitType = qsTr("Extracting Image"); break;
                         case 4: splitType = qsTr("Extracting Apps"); break;
                         case 5: splitType = qsTr("Fetching required files"); break;
+                        case 6: splitType = qsTr("Creating Image"); break;
                         default: splitType = qsTr("Waiting"); break;
                         }
                     }
@@ -204,10 +205,10 @@ Item {
         ColumnLayout {
             visible: settings.advanced
             RowLayout {
-                property int partValue: corePart.checked * 1 + userPart.checked * 2 + bootPart.checked * 4
+                property int partValue: corePart.checked * 1 + userPart.checked * 2 + bootPart.checked * 4 + manifestPart.checked * 8 + tarPart.checked * 16
                 Button {
                     text:  qsTr("Dump Contents") + translator.lang
-                    enabled: !p.splitting && parent.partValue
+                    enabled: !p.splitting && (parent.partValue & 7)
                     onClicked: if (!p.splitting) p.extractImage(0, parent.partValue);
                 }
                 CheckBox {
@@ -225,6 +226,16 @@ Item {
                     checked: false
                     text:  qsTr("Boot") + translator.lang
                 }
+                CheckBox {
+                    id: manifestPart
+                    checked: false
+                    text:  qsTr("Hash Manifest") + translator.lang
+                }
+                CheckBox {
+                    id: tarPart
+                    checked: false
+                    text:  qsTr("Single .tar") + translator.lang
+                }
             }
             Label {
                 text:  qsTr("Dump all file contents") + translator.lang
@@ -257,5 +268,30 @@ Item {
                 font.bold: true;
             }
         }
+        // Create QNX6
+        ColumnLayout {
+            RowLayout {
+                FileDialog {
+                    id: create_qnx6_dialog
+                    title: qsTr("Create QNX6 Image") + translator.lang
+                    folder: settings.installFolder
+                    selectFolder: true
+                    onAccepted: {
+                        p.createQNX6Image(fileUrl);
+                        settings.installFolder = folder;
+                    }
+                }
+
+                Button {
+                    text: qsTr("Create QNX6 Image") + translator.lang
+                    enabled: !p.splitting
+                    onClicked: create_qnx6_dialog.open()
+                }
+            }
+            Label {
+                text: qsTr("Pack an extracted folder in to a .qnx6 image") + translator.lang
+                font.bold: true;
+            }
+        }
     }
 }
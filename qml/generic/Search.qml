@@ -34,6 +34,34 @@ Item {
                 statusText: "Downloading"
                 text: download.curName
             }
+            Label {
+                anchors.horizontalCenter: parent.horizontalCenter
+                text: qsTr("%1 KB/s").arg(Math.round(bandwidth.downloadRate / 1024)) + translator.lang
+            }
+            RowLayout {
+                anchors.horizontalCenter: parent.horizontalCenter
+                Label { text: qsTr("Total limit") + translator.lang }
+                SpinBox {
+                    width: qt_new ? implicitWidth : implicitWidth + 25
+                    maximumValue: 1000000
+                    stepSize: 100
+                    suffix: " KB/s"
+                    value: bandwidth.totalLimit / 1024
+                    onValueChanged: bandwidth.totalLimit = value * 1024
+                }
+            }
+            Label {
+                Layout.fillWidth: true
+                horizontalAlignment: Text.AlignHCenter
+                wrapMode: Text.WordWrap
+                visible: bandwidth.totalLimit === 0
+                text: qsTr("Set a total limit to let installs and backups go ahead of downloads.") + translator.lang
+            }
+            Label {
+                anchors.horizontalCenter: parent.horizontalCenter
+                visible: download.savedSize > 0
+                text: qsTr("Patches save %1 MB").arg(Math.round(download.savedSize / (1024 * 1024))) + translator.lang
+            }
             Button {
                 id: cancelButton
                 text:  qsTr("Cancel Download") + translator.lang
@@ -64,6 +92,22 @@ Item {
                 text: qsTr("Version Lookup") + translator.lang
                 onClicked: versionLookup.visible = !versionLookup.visible
             }
+            Button {
+                // Every device for this carrier, results go to a table instead of the list below
+                anchors.horizontalCenter: parent.horizontalCenter
+                visible: settings.advanced
+                text: (p.scanEngine.running ? qsTr("Scanning %1/%2").arg(p.scanEngine.done).arg(p.scanEngine.total)
+                                            : qsTr("Scan All Devices")) + translator.lang
+                onClicked: p.scanEngine.running ? p.scanEngine.cancel()
+                                                : p.scanEngine.scanAll([p.npcFromLocale(country.value, carrier.value)], [mode.selectedItem])
+            }
+            Button {
+                anchors.horizontalCenter: parent.horizontalCenter
+                visible: settings.advanced && !p.scanEngine.running && p.scanEngine.results.count > 0
+                text: qsTr("Export Scan (%1 distinct)").arg(p.scanEngine.distinct)
+                      + (p.scanEngine.newestRelease !== "" ? " | " + qsTr("Newest: %1").arg(p.scanEngine.newestRelease) : "") + translator.lang
+                onClicked: p.scanEngine.exportResults()
+            }
         }
         Text {
             property string message: p.error
@@ -125,6 +169,13 @@ Item {
                 text: (download.verifying ? qsTr("Verifying") : qsTr("Download")) + translator.lang
                 onClicked: { download.start(); p.downloadLinks(downloadDevice.selectedItem) }
             }
+            CheckBox {
+                visible: !download.running
+                Layout.alignment: Qt.AlignHCenter
+                text: qsTr("Extract while downloading") + translator.lang
+                checked: download.extractWhileDownloading
+                onCheckedChanged: download.extractWhileDownloading = checked
+            }
             Button {
                 visible: download.running
                 text: qsTr("View Download (%1%)").arg(download.progress) + translator.lang
@@ -347,8 +398,7 @@ Item {
                 text: qsTr("Check All") + translator.lang
                 onTriggered: {
                     options_menu.checkAll();
-                    for (var i = 0; i < p.updateAppCount; i++)
-                        p.updateAppList[i].isMarked = true;
+                    p.updateAppList.markAll();
                 }
             }
             MenuItem {
@@ -356,8 +406,7 @@ Item {
                 text: qsTr("Uncheck All") + translator.lang
                 onTriggered: {
                     options_menu.uncheckAll()
-                    for (var i = 0; i < p.updateAppCount; i++)
-                        p.updateAppList[i].isMarked = false;
+                    p.updateAppList.unmarkAll();
                 }
             }
         }
@@ -416,8 +465,7 @@ Item {
                         text:  qsTr("Check All") + translator.lang
                         onTriggered: {
                             options_menu.checkAll();
-                            for (var i = 0; i < p.updateAppCount; i++)
-                                p.updateAppList[i].isMarked = true;
+                            p.updateAppList.markAll();
                         }
                     }
                     MenuItem {
@@ -425,8 +473,7 @@ Item {
                         text:  qsTr("Check All Needed") + translator.lang
                         onTriggered: {
                             options_menu.checkAllNeeded();
-                            for (var i = 0; i < p.updateAppCount; i++)
-                                p.updateAppList[i].isMarked = (p.updateAppList[i].isAvailable && !p.updateAppList[i].isInstalled);
+                            p.updateAppList.markNeeded();
                         }
                     }
                     MenuItem {
@@ -434,8 +481,7 @@ Item {
                         text:  qsTr("Uncheck All") + translator.lang
                         onTriggered: {
                             options_menu.uncheckAll()
-                            for (var i = 0; i < p.updateAppCount; i++)
-                                p.updateAppList[i].isMarked = false;
+                            p.updateAppList.unmarkAll();
                         }
                     }
                 }
@@ -462,12 +508,12 @@ Item {
                     }
                     CheckBox {
                         id: delegateBox
-                        text: friendlyName + (isInstalled ? " " + qsTr("(older)") : (isAvailable ? "" : " " + qsTr("(downloaded)"))) + translator.lang
+                        text: friendlyName + (isInstalled ? " " + qsTr("(older)") : (isAvailable ? (isCached ? " " + qsTr("(cached)") : "") : " " + qsTr("(downloaded)"))) + translator.lang
                         opacity: (!isInstalled && isAvailable) ? 1.0 : 0.6
                         width: Math.min(implicitWidth, parent.width - versionText.width*versionText.visible - sizeText.width)
                         clip: true
                         checked: isMarked
-                        onCheckedChanged: isMarked = checked;
+                        onCheckedChanged: model.isMarked = checked;
                         Connections {
                             target: options_menu
                             onCheckAll: delegateBox.checked = true;
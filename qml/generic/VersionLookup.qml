@@ -10,7 +10,7 @@ Window {
                           x = window.x + (window.width - width) / 2
                           y = window.y + (window.height - height) / 2
                       }
-    height: 290
+    height: 310
     width: 490
     ColumnLayout {
         height: parent.height
@@ -40,21 +40,34 @@ Window {
                         text: qsTr("Never") + translator.lang
                         exclusiveGroup: group
                     }
+                    CheckBox {
+                        text: qsTr("Skip Known") + translator.lang
+                        checked: scanner.skipKnown
+                        onCheckedChanged: scanner.skipKnown = checked
+                    }
                     Button {
-                        text: scanner.isAuto ? qsTr("Stop Scan") : qsTr("Autoscan") + translator.lang
+                        text: (scanner.isAuto ? qsTr("Stop Scan (%1/%2)").arg(scanner.rangeDone).arg(scanner.rangeTotal) : qsTr("Autoscan")) + translator.lang
                         onClicked: {
-                            scanner.isAuto = !scanner.isAuto;
-                            if (scanner.isAuto) { build.value += 3; relookup.clicked(); }
+                            if (scanner.isAuto)
+                                scanner.isAuto = false;
+                            else
+                                scanner.scanRange("10." + major.value + "." + minor.value, build.value + 3, 9999, 3);
                         }
                         property bool finished: scanner.finishedScan
                         onFinishedChanged: {
-                            if (finished && !scanner.isActive && scanner.isAuto) {
-                                if (build.value >= 9998) {
-                                    minor.value++;
-                                    build.value = (build.value+3) % 10000;
-                                } else
-                                    build.value += 3;
-                                relookup.clicked();
+                            if (!finished || scanner.isActive)
+                                return;
+                            // Pick up from what was found
+                            if (scanner.curRelease !== null) {
+                                var found = scanner.curRelease.osVersion.split('.')
+                                if (found.length > 3 && parseInt(found[2]) === minor.value)
+                                    build.value = parseInt(found[3])
+                            }
+                            // Nothing in this minor version, carry on with the next
+                            if (scanner.isAuto) {
+                                minor.value++;
+                                build.value = 0;
+                                scanner.scanRange("10." + major.value + "." + minor.value, 0, 9999, 3);
                             }
                         }
                     }
@@ -91,8 +104,9 @@ Window {
                     visible: scanner.curRelease !== null && scanner.curRelease.srVersion != ""
                     Button {
                         id: grabPotential
-                        enabled: scanner.curRelease !== null && scanner.curRelease.baseUrl !== ""
-                        text: enabled ? qsTr("Grab Public Links") : qsTr("No Links Available") + translator.lang
+                        enabled: scanner.curRelease !== null && scanner.curRelease.baseUrl !== "" && !scanner.linksRunning
+                        text: (scanner.linksRunning ? qsTr("Checking Links (%1/%2)").arg(scanner.linksDone).arg(scanner.linksTotal)
+                                                    : enabled ? qsTr("Grab Public Links") : qsTr("No Links Available")) + translator.lang
                         onClicked: scanner.generatePotentialLinks()
                     }
                 }
@@ -0,0 +1,142 @@
+// Copyright (C) 2014 Sacha Refshauge
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 3.0.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 3.0 for more details.
+
+// A copy of the GPL 3.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official GIT repository and contact information can be found at
+// http://github.com/xsacha/Sachesi
+
+#include "appmodel.h"
+
+AppModel::AppModel(QObject* parent)
+    : QAbstractListModel(parent)
+    , _checked(0), _needed(0), _checkedNeeded(0)
+{ }
+
+int AppModel::rowCount(const QModelIndex& parent) const {
+    return parent.isValid() ? 0 : _apps.count();
+}
+
+QVariant AppModel::data(const QModelIndex& index, int role) const {
+    if (!index.isValid() || index.row() >= _apps.count())
+        return QVariant();
+    const AppInfo& app = _apps.at(index.row());
+    switch (role) {
+    case NameRole: return app.name;
+    case UrlRole: return app.url;
+    case Qt::DisplayRole:
+    case FriendlyNameRole: return app.friendlyName;
+    case PackageIdRole: return app.packageId;
+    case CodeRole: return app.code;
+    case SizeRole: return app.size;
+    case IsMarkedRole: return app.isMarked;
+    case IsAvailableRole: return app.isAvailable;
+    case IsInstalledRole: return app.isInstalled;
+    case IsCachedRole: return app.isCached;
+    case TypeRole: return app.type;
+    case InstalledVersionRole: return app.installedVersion;
+    case VersionRole: return app.version;
+    case VersionIdRole: return app.versionId;
+    case ChecksumRole: return app.checksum;
+    }
+    return QVariant();
+}
+
+// Only the selection can be changed from QML
+bool AppModel::setData(const QModelIndex& index, const QVariant& value, int role) {
+    if (!index.isValid() || index.row() >= _apps.count() || role != IsMarkedRole)
+        return false;
+    AppInfo app = _apps.at(index.row());
+    if (app.isMarked == value.toBool())
+        return true;
+    app.isMarked = value.toBool();
+    update(index.row(), app);
+    return true;
+}
+
+Qt::ItemFlags AppModel::flags(const QModelIndex& index) const {
+    return QAbstractListModel::flags(index) | Qt::ItemIsEditable;
+}
+
+QHash<int, QByteArray> AppModel::roleNames() const {
+    QHash<int, QByteArray> roles;
+    roles[NameRole] = "name";
+    roles[UrlRole] = "url";
+    roles[FriendlyNameRole] = "friendlyName";
+    roles[PackageIdRole] = "packageId";
+    roles[CodeRole] = "code";
+    roles[SizeRole] = "size";
+    roles[IsMarkedRole] = "isMarked";
+    roles[IsAvailableRole] = "isAvailable";
+    roles[IsInstalledRole] = "isInstalled";
+    roles[IsCachedRole] = "isCached";
+    roles[TypeRole] = "type";
+    roles[InstalledVersionRole] = "installedVersion";
+    roles[VersionRole] = "version";
+    roles[VersionIdRole] = "versionId";
+    roles[ChecksumRole] = "checksum";
+    return roles;
+}
+
+void AppModel::tally(const AppInfo& app, int sign) {
+    if (app.isMarked)
+        _checked += sign;
+    if (app.isNeeded()) {
+        _needed += sign;
+        if (app.isMarked)
+            _checkedNeeded += sign;
+    }
+}
+
+void AppModel::setApps(const QVector<AppInfo>& apps) {
+    beginResetModel();
+    _apps = apps;
+    _checked = _needed = _checkedNeeded = 0;
+    foreach (const AppInfo& app, _apps)
+        tally(app, 1);
+    endResetModel();
+    emit countsChanged();
+}
+
+void AppModel::update(int row, const AppInfo& app) {
+    tally(_apps.at(row), -1);
+    _apps[row] = app;
+    tally(app, 1);
+    QModelIndex changed = index(row);
+    emit dataChanged(changed, changed);
+    emit countsChanged();
+}
+
+// One change notification for the whole list rather than one per entry
+void AppModel::markWhere(Selection selection) {
+    if (_apps.isEmpty())
+        return;
+    for (int i = 0; i < _apps.count(); i++) {
+        AppInfo& app = _apps[i];
+        tally(app, -1);
+        app.isMarked = (selection == All) || (selection == Needed && app.isNeeded());
+        tally(app, 1);
+    }
+    QVector<int> roles;
+    roles << IsMarkedRole;
+    emit dataChanged(index(0), index(_apps.count() - 1), roles);
+    emit countsChanged();
+}
+
+QList<Apps*> AppModel::toApps(bool markedOnly) const {
+    QList<Apps*> list;
+    foreach (const AppInfo& app, _apps) {
+        if (!markedOnly || app.isMarked)
+            list.append(new Apps(app));
+    }
+    return list;
+}
@@ -0,0 +1,91 @@
+// Copyright (C) 2014 Sacha Refshauge
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 3.0.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 3.0 for more details.
+
+// A copy of the GPL 3.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official GIT repository and contact information can be found at
+// http://github.com/xsacha/Sachesi
+
+#pragma once
+
+#include <QAbstractListModel>
+#include <QVector>
+#include "apps.h"
+
+// A list of AppInfo values for QML, for the hundreds of apps an update can list.
+// Roles are named after the Apps properties, so delegates read the same names.
+// The counts the UI shows are kept up to date as entries change instead of being recounted.
+class AppModel : public QAbstractListModel {
+    Q_OBJECT
+    Q_PROPERTY(int count READ count NOTIFY countsChanged)
+    Q_PROPERTY(int checkedCount READ checkedCount NOTIFY countsChanged)
+    Q_PROPERTY(int neededCount READ neededCount NOTIFY countsChanged)
+    Q_PROPERTY(int checkedNeededCount READ checkedNeededCount NOTIFY countsChanged)
+
+public:
+    enum Roles {
+        NameRole = Qt::UserRole + 1,
+        UrlRole,
+        FriendlyNameRole,
+        PackageIdRole,
+        CodeRole,
+        SizeRole,
+        IsMarkedRole,
+        IsAvailableRole,
+        IsInstalledRole,
+        IsCachedRole,
+        TypeRole,
+        InstalledVersionRole,
+        VersionRole,
+        VersionIdRole,
+        ChecksumRole,
+    };
+
+    AppModel(QObject* parent = 0);
+
+    int rowCount(const QModelIndex& parent = QModelIndex()) const;
+    QVariant data(const QModelIndex& index, int role) const;
+    bool setData(const QModelIndex& index, const QVariant& value, int role);
+    Qt::ItemFlags flags(const QModelIndex& index) const;
+    QHash<int, QByteArray> roleNames() const;
+
+    int count() const { return _apps.count(); }
+    int checkedCount() const { return _checked; }
+    int neededCount() const { return _needed; }
+    int checkedNeededCount() const { return _checkedNeeded; }
+
+    const QVector<AppInfo>& apps() const { return _apps; }
+    const AppInfo& at(int row) const { return _apps.at(row); }
+    void setApps(const QVector<AppInfo>& apps);
+    void update(int row, const AppInfo& app);
+    void clear() { setApps(QVector<AppInfo>()); }
+    // Copies for DownloadInfo::setApps. The caller deletes them.
+    QList<Apps*> toApps(bool markedOnly = true) const;
+
+    Q_INVOKABLE void markAll() { markWhere(All); }
+    Q_INVOKABLE void markNeeded() { markWhere(Needed); }
+    Q_INVOKABLE void unmarkAll() { markWhere(None); }
+
+signals:
+    void countsChanged();
+
+private:
+    enum Selection { All, Needed, None };
+    void markWhere(Selection selection);
+    // Adds (sign 1) or removes (sign -1) an entry from the counts
+    void tally(const AppInfo& app, int sign);
+
+    QVector<AppInfo> _apps;
+    int _checked;
+    int _needed;
+    int _checkedNeeded;
+};
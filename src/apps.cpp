@@ -32,7 +32,7 @@ Apps::Apps(QObject *parent)
     : QObject(parent)
     , _name(""), _url(""), _friendlyName(""), _packageId("")
     , _code(0), _size(0)
-    , _isMarked(false), _isAvailable(true), _isInstalled(false)
+    , _isMarked(false), _isAvailable(true), _isInstalled(false), _isCached(false)
     , _type("")
     , _installedVersion(""), _version(""), _versionId("")
     , _checksum("")
@@ -42,23 +42,78 @@ Apps::Apps(const Apps* app, QObject *parent)
     : QObject(parent)
     , _name(app->name()), _url(app->url()), _friendlyName(app->friendlyName()), _packageId(app->packageId())
     , _code(app->code()), _size(app->size())
-    , _isMarked(app->isMarked()), _isAvailable(app->isAvailable()), _isInstalled(app->isInstalled())
+    , _isMarked(app->isMarked()), _isAvailable(app->isAvailable()), _isInstalled(app->isInstalled()), _isCached(app->isCached())
     , _type(app->type())
-    , _installedVersion(app->installedVersion()), _version(app->version()), _versionId(app->versionId())
+    , _installedVersion(app->installedVersion()), _version(app->version())
+    , _packedInstalledVersion(app->packedInstalledVersion()), _packedVersion(app->packedVersion())
+    , _versionId(app->versionId())
     , _checksum(app->checksum())
 { }
 
+Apps::Apps(const AppInfo& app, QObject *parent)
+    : QObject(parent)
+    , _name(app.name), _url(app.url), _friendlyName(app.friendlyName), _packageId(app.packageId)
+    , _code(app.code), _size(app.size)
+    , _isMarked(app.isMarked), _isAvailable(app.isAvailable), _isInstalled(app.isInstalled), _isCached(app.isCached)
+    , _type(app.type)
+    , _installedVersion(app.installedVersion), _version(app.version)
+    , _packedInstalledVersion(app.installedVersion), _packedVersion(app.version)
+    , _versionId(app.versionId)
+    , _checksum(app.checksum)
+{ }
+
+AppInfo Apps::info() const {
+    AppInfo app;
+    app.name = _name;
+    app.url = _url;
+    app.friendlyName = _friendlyName;
+    app.packageId = _packageId;
+    app.code = _code;
+    app.size = _size;
+    app.isMarked = _isMarked;
+    app.isAvailable = _isAvailable;
+    app.isInstalled = _isInstalled;
+    app.isCached = _isCached;
+    app.type = _type;
+    app.installedVersion = _installedVersion;
+    app.version = _version;
+    app.versionId = _versionId;
+    app.checksum = _checksum;
+    return app;
+}
+
 SET_QML2(QString, name, setName)
 SET_QML2(QString, url, setUrl)
 SET_QML2(QString, friendlyName, setFriendlyName)
 SET_QML2(QString, packageId, setPackageId)
 SET_QML2(int, code, setCode)
-SET_QML2(int, size, setSize)
+SET_QML2(qint64, size, setSize)
 SET_QML2(bool, isMarked, setIsMarked)
 SET_QML2(bool, isAvailable, setIsAvailable)
 SET_QML2(bool, isInstalled, setIsInstalled)
+SET_QML2(bool, isCached, setIsCached)
 SET_QML2(QString, type, setType)
-SET_QML2(QString, installedVersion, setInstalledVersion)
-SET_QML2(QString, version, setVersion)
 SET_QML2(QString, versionId, setVersionId)
 SET_QML2(QString, checksum, setChecksum)
+
+QString Apps::installedVersion() const {
+    return _installedVersion;
+}
+void Apps::setInstalledVersion(const QString &var) {
+    if (var != _installedVersion) {
+        _installedVersion = var;
+        _packedInstalledVersion = PackedVersion(var);
+        emit installedVersionChanged();
+    }
+}
+
+QString Apps::version() const {
+    return _version;
+}
+void Apps::setVersion(const QString &var) {
+    if (var != _version) {
+        _version = var;
+        _packedVersion = PackedVersion(var);
+        emit versionChanged();
+    }
+}
@@ -18,12 +18,33 @@
 #pragma once
 
 #include <QString>
-#if QT_VERSION > QT_VERSION_CHECK(5, 0, 0)
-#include <QQmlListProperty>
-#else
-#include <QDeclarativeListProperty>
-#define QQmlListProperty QDeclarativeListProperty
-#endif
+#include <QObject>
+#include "packedversion.h"
+
+// The plain value behind an Apps, for lists that are too long for a QObject each
+struct AppInfo {
+    QString name;
+    QString url;
+    QString friendlyName;
+    QString packageId;
+    int code;
+    qint64 size;
+    bool isMarked;
+    bool isAvailable;
+    bool isInstalled;
+    bool isCached;
+    QString type;
+    QString installedVersion;
+    QString version;
+    QString versionId;
+    QString checksum;
+
+    AppInfo()
+        : code(0), size(0)
+        , isMarked(false), isAvailable(true), isInstalled(false), isCached(false) {}
+    // Worth downloading: not on disk and not already on the device
+    bool isNeeded() const { return isAvailable && !isInstalled; }
+};
 
 class Apps : public QObject {
     Q_OBJECT
@@ -33,10 +54,11 @@ class Apps : public QObject {
     Q_PROPERTY(QString packageId READ packageId WRITE setPackageId NOTIFY packageIdChanged)
     Q_PROPERTY(QString friendlyName READ friendlyName WRITE setFriendlyName NOTIFY friendlyNameChanged)
     Q_PROPERTY(int code READ code WRITE setCode NOTIFY codeChanged)
-    Q_PROPERTY(int size READ size WRITE setSize NOTIFY sizeChanged)
+    Q_PROPERTY(qint64 size READ size WRITE setSize NOTIFY sizeChanged)
     Q_PROPERTY(bool isMarked READ isMarked WRITE setIsMarked NOTIFY isMarkedChanged)
     Q_PROPERTY(bool isAvailable READ isAvailable WRITE setIsAvailable NOTIFY isAvailableChanged)
     Q_PROPERTY(bool isInstalled READ isInstalled WRITE setIsInstalled NOTIFY isInstalledChanged)
+    Q_PROPERTY(bool isCached READ isCached WRITE setIsCached NOTIFY isCachedChanged)
     Q_PROPERTY(QString type READ type WRITE setType NOTIFY typeChanged)
     Q_PROPERTY(QString installedVersion READ installedVersion WRITE setInstalledVersion NOTIFY installedVersionChanged)
     Q_PROPERTY(QString version READ version WRITE setVersion NOTIFY versionChanged)
@@ -46,30 +68,38 @@ class Apps : public QObject {
 public:
     Apps(QObject *parent = 0);
     Apps(const Apps* app, QObject *parent = 0);
+    Apps(const AppInfo& app, QObject *parent = 0);
+
+    AppInfo info() const;
 
     QString name() const;
     QString url() const;
     QString packageId() const;
     QString friendlyName() const;
     int code() const;
-    int size() const;
+    qint64 size() const;
     bool isMarked() const;
     bool isAvailable() const;
     bool isInstalled() const;
+    bool isCached() const;
     QString type() const;
     QString installedVersion() const;
     QString version() const;
     QString versionId() const;
     QString checksum() const;
+    // Parsed once when the version is set, for comparisons
+    PackedVersion packedVersion() const { return _packedVersion; }
+    PackedVersion packedInstalledVersion() const { return _packedInstalledVersion; }
     void setName(const QString &str);
     void setUrl(const QString &str);
     void setPackageId(const QString &str);
     void setFriendlyName(const QString &str);
     void setCode(const int &num);
-    void setSize(const int &num);
+    void setSize(const qint64 &num);
     void setIsMarked(const bool &marked);
     void setIsAvailable(const bool &available);
     void setIsInstalled(const bool &installed);
+    void setIsCached(const bool &cached);
     void setType(const QString &str);
     void setInstalledVersion(const QString &str);
     void setVersion(const QString &str);
@@ -86,6 +116,7 @@ signals:
     void isMarkedChanged();
     void isAvailableChanged();
     void isInstalledChanged();
+    void isCachedChanged();
     void typeChanged();
     void installedVersionChanged();
     void versionChanged();
@@ -98,13 +129,16 @@ private:
     QString _friendlyName;
     QString _packageId;
     int _code;
-    int _size;
+    qint64 _size;
     bool _isMarked;
     bool _isAvailable;
     bool _isInstalled;
+    bool _isCached;
     QString _type;
     QString _installedVersion;
     QString _version;
+    PackedVersion _packedInstalledVersion;
+    PackedVersion _packedVersion;
     QString _versionId;
     QString _checksum;
 };
@@ -0,0 +1,217 @@
+// Copyright (C) 2014 Sacha Refshauge
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 3.0.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 3.0 for more details.
+
+// A copy of the GPL 3.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official GIT repository and contact information can be found at
+// http://github.com/xsacha/Sachesi
+
+#include "bandwidth.h"
+#include <QSettings>
+#include <QSharedPointer>
+
+static const char* limitKeys[Bandwidth::ClassCount] = { "installLimit", "backupLimit", "downloadLimit" };
+
+Bandwidth* Bandwidth::instance() {
+    static Bandwidth* bandwidth = new Bandwidth();
+    return bandwidth;
+}
+
+Bandwidth::Bandwidth(QObject* parent)
+    : QObject(parent)
+    , _historyPos(0)
+    , _idleTicks(0)
+{
+    QSettings settings("Qtness","Sachesi");
+    for (int c = 0; c < ClassCount; c++) {
+        _limit[c] = settings.value(limitKeys[c], 0).toLongLong();
+        _tokens[c] = perTick(_limit[c]);
+        _used[c] = 0;
+        for (int i = 0; i < BANDWIDTH_WINDOW; i++)
+            _history[c][i] = 0;
+    }
+    _totalLimit = settings.value("totalLimit", 0).toLongLong();
+    _totalTokens = perTick(_totalLimit);
+
+    _timer.setInterval(BANDWIDTH_TICK);
+    connect(&_timer, &QTimer::timeout, this, &Bandwidth::tick);
+}
+
+qint64 Bandwidth::acquire(Class c, qint64 wanted) {
+    if (!_timer.isActive()) {
+        _idleTicks = 0;
+        _timer.start();
+    }
+    qint64 granted = wanted;
+    if (_limit[c] > 0)
+        granted = qMin(granted, _tokens[c]);
+    if (_totalLimit > 0) {
+        // Whatever the higher classes moved last tick is kept for them.
+        // What they already used this tick is gone from the total.
+        qint64 reserve = 0;
+        int last = (_historyPos + BANDWIDTH_WINDOW - 1) % BANDWIDTH_WINDOW;
+        for (int higher = 0; higher < c; higher++)
+            reserve += qMax(_history[higher][last] - _used[higher], (qint64)0);
+        granted = qMin(granted, _totalTokens - reserve);
+    }
+    granted = qMax(granted, (qint64)0);
+
+    if (_limit[c] > 0)
+        _tokens[c] -= granted;
+    if (_totalLimit > 0)
+        _totalTokens -= granted;
+    _used[c] += granted;
+    return granted;
+}
+
+void Bandwidth::tick() {
+    bool active = false;
+    for (int c = 0; c < ClassCount; c++) {
+        _history[c][_historyPos] = _used[c];
+        if (_used[c] > 0)
+            active = true;
+        _used[c] = 0;
+        // No more than a tick's worth is saved up, so there are no bursts after a pause
+        _tokens[c] = qMin(_tokens[c] + perTick(_limit[c]), perTick(_limit[c]));
+    }
+    _totalTokens = qMin(_totalTokens + perTick(_totalLimit), perTick(_totalLimit));
+    _historyPos = (_historyPos + 1) % BANDWIDTH_WINDOW;
+
+    emit refilled();
+    if (_historyPos % 5 == 0)
+        emit ratesChanged();
+
+    // Nothing moved for a whole window, so the rates are all 0 now
+    if (!active && ++_idleTicks >= BANDWIDTH_WINDOW) {
+        _timer.stop();
+        emit ratesChanged();
+    } else if (active)
+        _idleTicks = 0;
+}
+
+qint64 Bandwidth::rate(Class c) const {
+    qint64 total = 0;
+    for (int i = 0; i < BANDWIDTH_WINDOW; i++)
+        total += _history[c][i];
+    return total * 1000 / (BANDWIDTH_TICK * BANDWIDTH_WINDOW);
+}
+
+void Bandwidth::setLimit(Class c, qint64 limit) {
+    limit = qMax(limit, (qint64)0);
+    if (limit == _limit[c])
+        return;
+    _limit[c] = limit;
+    _tokens[c] = perTick(limit);
+    saveLimits();
+    emit limitsChanged();
+}
+
+void Bandwidth::setTotalLimit(qint64 limit) {
+    limit = qMax(limit, (qint64)0);
+    if (limit == _totalLimit)
+        return;
+    _totalLimit = limit;
+    _totalTokens = perTick(limit);
+    saveLimits();
+    emit limitsChanged();
+}
+
+void Bandwidth::saveLimits() {
+    QSettings settings("Qtness","Sachesi");
+    for (int c = 0; c < ClassCount; c++)
+        settings.setValue(limitKeys[c], _limit[c]);
+    settings.setValue("totalLimit", _totalLimit);
+}
+
+QByteArray Bandwidth::read(QNetworkReply* reply, Class c) {
+    qint64 available = reply->bytesAvailable();
+    if (available <= 0)
+        return QByteArray();
+    return reply->read(acquire(c, available));
+}
+
+void Bandwidth::stream(QNetworkReply* reply, Class c, std::function<void(const QByteArray&)> sink, std::function<void()> done) {
+    // Qt stops reading from the socket when this fills, which is what slows the sender down
+    reply->setReadBufferSize(1024 * 1024);
+    QSharedPointer<bool> finished(new bool(false));
+    auto drain = [=]() {
+        if (*finished)
+            return;
+        QByteArray data = read(reply, c);
+        if (!data.isEmpty())
+            sink(data);
+        if (reply->isFinished() && reply->bytesAvailable() == 0) {
+            *finished = true;
+            done();
+        }
+    };
+    connect(reply, &QNetworkReply::readyRead, reply, drain);
+    connect(reply, &QNetworkReply::finished, reply, drain);
+    connect(this, &Bandwidth::refilled, reply, drain);
+}
+
+QIODevice* Bandwidth::wrap(QIODevice* device, Class c) {
+    return new ThrottledDevice(device, c);
+}
+
+ThrottledDevice::ThrottledDevice(QIODevice* device, Bandwidth::Class c, QObject* parent)
+    : QIODevice(parent)
+    , _device(device)
+    , _class(c)
+{
+    device->setParent(this);
+    connect(Bandwidth::instance(), &Bandwidth::refilled, this, [=]() {
+        if (bytesAvailable() > 0)
+            emit readyRead();
+    });
+    open(QIODevice::ReadOnly | QIODevice::Unbuffered);
+}
+
+bool ThrottledDevice::isSequential() const {
+    return _device.isNull() || _device->isSequential();
+}
+
+qint64 ThrottledDevice::size() const {
+    return _device.isNull() ? 0 : _device->size();
+}
+
+bool ThrottledDevice::seek(qint64 pos) {
+    if (_device.isNull() || !_device->seek(pos))
+        return false;
+    return QIODevice::seek(pos);
+}
+
+bool ThrottledDevice::reset() {
+    return seek(0);
+}
+
+qint64 ThrottledDevice::bytesAvailable() const {
+    return _device.isNull() ? 0 : _device->bytesAvailable();
+}
+
+qint64 ThrottledDevice::readData(char* data, qint64 maxlen) {
+    // Gone, most likely freed with the reply it was uploaded by
+    if (_device.isNull())
+        return -1;
+    if (_device->atEnd())
+        return -1;
+    qint64 granted = Bandwidth::instance()->acquire(_class, maxlen);
+    if (granted == 0)
+        return 0;
+    return _device->read(data, granted);
+}
+
+qint64 ThrottledDevice::writeData(const char* data, qint64 len) {
+    Q_UNUSED(data);
+    Q_UNUSED(len);
+    return -1;
+}
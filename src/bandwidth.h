@@ -0,0 +1,128 @@
+// Copyright (C) 2014 Sacha Refshauge
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 3.0.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 3.0 for more details.
+
+// A copy of the GPL 3.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official GIT repository and contact information can be found at
+// http://github.com/xsacha/Sachesi
+
+#pragma once
+
+#include <QObject>
+#include <QIODevice>
+#include <QPointer>
+#include <QTimer>
+#include <QNetworkReply>
+#include <functional>
+
+// How often the buckets are refilled (ms)
+#define BANDWIDTH_TICK 100
+// Rates are averaged over this many ticks
+#define BANDWIDTH_WINDOW 10
+
+// Token buckets shared by everything that moves a lot of data. Each class has its own
+// optional cap and all of them draw from an optional total. Device transfers come first:
+// while one is running, downloads can't use what it took in the last tick.
+// That priority needs a total limit, as there is nothing to share out without one.
+// A limit of 0 means no limit. Rates are measured either way.
+class Bandwidth : public QObject {
+    Q_OBJECT
+    Q_PROPERTY(qint64 downloadRate READ downloadRate NOTIFY ratesChanged)
+    Q_PROPERTY(qint64 installRate  READ installRate  NOTIFY ratesChanged)
+    Q_PROPERTY(qint64 backupRate   READ backupRate   NOTIFY ratesChanged)
+    Q_PROPERTY(qint64 downloadLimit READ downloadLimit WRITE setDownloadLimit NOTIFY limitsChanged)
+    Q_PROPERTY(qint64 installLimit  READ installLimit  WRITE setInstallLimit  NOTIFY limitsChanged)
+    Q_PROPERTY(qint64 backupLimit   READ backupLimit   WRITE setBackupLimit   NOTIFY limitsChanged)
+    Q_PROPERTY(qint64 totalLimit    READ totalLimit    WRITE setTotalLimit    NOTIFY limitsChanged)
+public:
+    // In order of priority, highest first
+    enum Class {
+        Install = 0, // update.cgi uploads
+        Backup,      // backup.cgi transfers, both ways
+        Download,    // Update server downloads
+        ClassCount
+    };
+
+    static Bandwidth* instance();
+
+    // How much of 'wanted' may be moved right now. Can be 0; try again on refilled().
+    qint64 acquire(Class c, qint64 wanted);
+    // Reads what the bucket allows from a reply. The rest stays buffered in the reply.
+    QByteArray read(QNetworkReply* reply, Class c);
+    // Feeds a reply's data to 'sink' as bandwidth allows and calls 'done' once it has
+    // finished and everything was read
+    void stream(QNetworkReply* reply, Class c, std::function<void(const QByteArray&)> sink, std::function<void()> done);
+    // An upload device that only gives QNetworkAccessManager data as bandwidth allows.
+    // Takes ownership of 'device'.
+    static QIODevice* wrap(QIODevice* device, Class c);
+
+    qint64 rate(Class c) const;
+    qint64 downloadRate() const { return rate(Download); }
+    qint64 installRate() const { return rate(Install); }
+    qint64 backupRate() const { return rate(Backup); }
+    qint64 downloadLimit() const { return _limit[Download]; }
+    qint64 installLimit() const { return _limit[Install]; }
+    qint64 backupLimit() const { return _limit[Backup]; }
+    qint64 totalLimit() const { return _totalLimit; }
+    void setDownloadLimit(qint64 limit) { setLimit(Download, limit); }
+    void setInstallLimit(qint64 limit) { setLimit(Install, limit); }
+    void setBackupLimit(qint64 limit) { setLimit(Backup, limit); }
+    void setTotalLimit(qint64 limit);
+
+signals:
+    // Buckets were topped up; anything that was held back can try again
+    void refilled();
+    void ratesChanged();
+    void limitsChanged();
+
+private slots:
+    void tick();
+
+private:
+    Bandwidth(QObject* parent = 0);
+    void setLimit(Class c, qint64 limit);
+    void saveLimits();
+    // At least a byte, or a very low limit would never let anything through
+    qint64 perTick(qint64 limit) const { return limit > 0 ? qMax(limit * BANDWIDTH_TICK / 1000, (qint64)1) : 0; }
+
+    QTimer _timer;
+    qint64 _limit[ClassCount];
+    qint64 _tokens[ClassCount];
+    qint64 _totalLimit;
+    qint64 _totalTokens;
+    // Bytes moved in the current tick and the ones before it
+    qint64 _used[ClassCount];
+    qint64 _history[ClassCount][BANDWIDTH_WINDOW];
+    int _historyPos;
+    int _idleTicks;
+};
+
+// Upload side of Bandwidth::wrap
+class ThrottledDevice : public QIODevice {
+    Q_OBJECT
+public:
+    ThrottledDevice(QIODevice* device, Bandwidth::Class c, QObject* parent = 0);
+
+    bool isSequential() const;
+    qint64 size() const;
+    bool seek(qint64 pos);
+    bool reset();
+    qint64 bytesAvailable() const;
+
+protected:
+    qint64 readData(char* data, qint64 maxlen);
+    qint64 writeData(const char* data, qint64 len);
+
+private:
+    QPointer<QIODevice> _device;
+    Bandwidth::Class _class;
+};
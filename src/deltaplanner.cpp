@@ -0,0 +1,128 @@
+// Copyright (C) 2014 Sacha Refshauge
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 3.0.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 3.0 for more details.
+
+// A copy of the GPL 3.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official GIT repository and contact information can be found at
+// http://github.com/xsacha/Sachesi
+
+#include "deltaplanner.h"
+#include "portscore.h"
+#include "search/releasedatabase.h"
+#include <QDir>
+#include <QHash>
+#include <QSharedPointer>
+
+QString DeltaPlanner::patchUrl(const QString& fullUrl, const QString& fromVersion) {
+    QString url = fullUrl;
+    QString oldVersion = fromVersion;
+    oldVersion.replace('.','_');
+    url.chop(4); // Remove extension
+    return url + QString("+patch+%1.bar").arg(oldVersion);
+}
+
+// Every release has a folder of its own on the server, so the link is built from
+// where that release was found. Empty if it was never looked up.
+QString DeltaPlanner::versionUrl(const Apps* app, const QString& version) {
+    QString baseUrl = ReleaseDatabase::instance()->value(version).baseUrl;
+    if (baseUrl.isEmpty())
+        return QString();
+    QString name = app->url().split('/').last();
+    return baseUrl + "/" + name.replace(app->version(), version);
+}
+
+QStringList DeltaPlanner::localVersions(const Apps* app, const QString& from, const QString& to) {
+    QStringList versions;
+    QString pattern = app->name();
+    if (!pattern.contains(app->version()))
+        return versions;
+    pattern.replace(app->version(), "*");
+    int prefix = pattern.indexOf('*');
+    int suffix = pattern.length() - prefix - 1;
+
+    PackedVersion low(from), high(to);
+    // Every release gets its own folder under the save directory
+    QDir saveDir(getSaveDir());
+    foreach (QString release, saveDir.entryList(QDir::Dirs | QDir::NoDotAndDotDot)) {
+        foreach (QString file, QDir(saveDir.absoluteFilePath(release)).entryList(QStringList() << pattern, QDir::Files)) {
+            QString version = file.mid(prefix, file.length() - prefix - suffix);
+            if (version.count('.') != 3 || versions.contains(version))
+                continue;
+            PackedVersion packed(version);
+            if (packed.isNewerThan(low, false) && high.isNewerThan(packed, false))
+                versions.append(version);
+        }
+    }
+    return versions;
+}
+
+void DeltaPlanner::plan(const Apps* app, const QStringList& intermediates, Callback callback) {
+    QString full = app->url();
+    QString installed = app->installedVersion();
+    QString direct = patchUrl(full, installed);
+
+    // Every link that may be part of a plan
+    QStringList urls;
+    urls << full << direct;
+    QList<QStringList> chains;
+    QStringList vias;
+    foreach (QString version, intermediates) {
+        QString hop = versionUrl(app, version);
+        if (hop.isEmpty())
+            continue;
+        QStringList chain;
+        chain << patchUrl(hop, installed) << patchUrl(full, version);
+        chains.append(chain);
+        vias.append(version);
+        urls << chain;
+    }
+
+    qint64 listedSize = app->size();
+    QSharedPointer<QHash<QString, VerifyResult> > results(new QHash<QString, VerifyResult>());
+    QSharedPointer<int> remaining(new int(urls.count()));
+    foreach (QString url, urls) {
+        _verifier->verify(url, [=](const VerifyResult& result) {
+            results->insert(url, result);
+            if (--*remaining > 0)
+                return;
+
+            // Everything is in, so pick the cheapest
+            DeltaPlan best;
+            VerifyResult fullResult = results->value(full);
+            best.fullSize = (fullResult.found() && fullResult.length > 0) ? fullResult.length : listedSize;
+            best.urls << full;
+            best.sizes << best.fullSize;
+            best.total = best.fullSize;
+
+            VerifyResult directResult = results->value(direct);
+            if (directResult.found() && directResult.length > 0 && directResult.length < best.total) {
+                best.urls = QStringList() << direct;
+                best.sizes = QList<qint64>() << directResult.length;
+                best.total = directResult.length;
+            }
+            for (int c = 0; c < chains.count(); c++) {
+                QStringList chain = chains.at(c);
+                VerifyResult first = results->value(chain[0]);
+                VerifyResult second = results->value(chain[1]);
+                if (!first.found() || !second.found() || first.length <= 0 || second.length <= 0)
+                    continue;
+                if (first.length + second.length < best.total) {
+                    best.urls = chain;
+                    best.via = vias.at(c);
+                    best.sizes = QList<qint64>() << first.length << second.length;
+                    best.total = first.length + second.length;
+                }
+            }
+            callback(best);
+        });
+    }
+}
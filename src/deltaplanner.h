@@ -0,0 +1,55 @@
+// Copyright (C) 2014 Sacha Refshauge
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 3.0.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 3.0 for more details.
+
+// A copy of the GPL 3.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official GIT repository and contact information can be found at
+// http://github.com/xsacha/Sachesi
+
+#pragma once
+
+#include <QStringList>
+#include <QList>
+#include "apps.h"
+#include "linkverifier.h"
+
+// The cheapest way found to get from the installed version of a package to the new one.
+// Either the full package, a patch, or a patch to an intermediate version and a patch from there.
+struct DeltaPlan {
+    QStringList urls;     // In the order they have to be installed
+    QList<qint64> sizes;
+    QString via;          // The version the first of two patches installs
+    qint64 total;
+    qint64 fullSize;
+    qint64 saved() const { return fullSize - total; }
+};
+
+// Probes the full package and its patches at the same time and picks the smallest download
+class DeltaPlanner {
+public:
+    typedef std::function<void(const DeltaPlan&)> Callback;
+
+    explicit DeltaPlanner(LinkVerifier* verifier)
+        : _verifier(verifier) {}
+
+    // 'intermediates' are versions between the installed and the new one to try chains through
+    void plan(const Apps* app, const QStringList& intermediates, Callback callback);
+
+    static QString patchUrl(const QString& fullUrl, const QString& fromVersion);
+    // The same package at another version, from the folder of that release
+    static QString versionUrl(const Apps* app, const QString& version);
+    // OS versions that have been downloaded before and lie between 'from' and 'to'
+    static QStringList localVersions(const Apps* app, const QString& from, const QString& to);
+
+private:
+    LinkVerifier* _verifier;
+};
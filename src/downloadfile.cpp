@@ -0,0 +1,578 @@
+// Copyright (C) 2014 Sacha Refshauge
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 3.0.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 3.0 for more details.
+
+// A copy of the GPL 3.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official GIT repository and contact information can be found at
+// http://github.com/xsacha/Sachesi
+
+#include "downloadfile.h"
+#include "bandwidth.h"
+#include <QSaveFile>
+#include <QStringList>
+#include <QTextStream>
+
+DownloadStream::DownloadStream(QSharedPointer<DownloadStreamState> state, qint64 size, QObject* parent)
+    : QIODevice(parent)
+    , _state(state)
+    , _size(size)
+{
+}
+
+DownloadStream::~DownloadStream() {
+    close();
+}
+
+bool DownloadStream::open(OpenMode mode) {
+    if (mode & QIODevice::WriteOnly)
+        return false;
+    _file.setFileName(_state->tempName);
+    if (!_file.open(QIODevice::ReadOnly))
+        return false;
+    QMutexLocker locker(&_state->mutex);
+    _state->readers++;
+    return QIODevice::open(mode);
+}
+
+void DownloadStream::close() {
+    if (!isOpen())
+        return;
+    QIODevice::close();
+    _file.close();
+    bool moved = false;
+    {
+        QMutexLocker locker(&_state->mutex);
+        // The download finished first, so the file is put in place now that nobody is reading it
+        if (--_state->readers == 0 && _state->commitPending) {
+            _state->commitPending = false;
+            QFile::remove(_state->finalName);
+            moved = QFile::rename(_state->tempName, _state->finalName);
+        }
+    }
+    if (moved)
+        emit committed(_state->finalName);
+}
+
+void DownloadStream::cancel() {
+    QMutexLocker locker(&_state->mutex);
+    _state->failed = true;
+    _state->grown.wakeAll();
+}
+
+qint64 DownloadStream::readData(char* data, qint64 maxlen) {
+    qint64 position = pos();
+    {
+        QMutexLocker locker(&_state->mutex);
+        while (_state->available <= position && !_state->done && !_state->failed)
+            _state->grown.wait(&_state->mutex);
+        if (_state->failed)
+            return -1;
+        maxlen = qMin(maxlen, _state->available - position);
+    }
+    // Past the end of a finished download
+    if (maxlen <= 0)
+        return -1;
+    _file.seek(position);
+    return _file.read(data, maxlen);
+}
+
+qint64 DownloadStream::writeData(const char* data, qint64 len) {
+    Q_UNUSED(data);
+    Q_UNUSED(len);
+    return -1;
+}
+
+DownloadFile::DownloadFile(Apps* app, QString baseDir, QObject* parent)
+    : QObject(parent)
+    , _app(app)
+    , _baseDir(baseDir)
+    , _state(Queued)
+    , _manager(nullptr)
+    , _received(0)
+    , _journalAt(0)
+    , _buffered(0)
+    , _unreported(0)
+    , _hash(nullptr)
+    , _hashedAt(0)
+{
+    connect(Bandwidth::instance(), &Bandwidth::refilled, this, &DownloadFile::resumeSegments);
+}
+
+DownloadFile::~DownloadFile() {
+    abort();
+    delete _hash;
+}
+
+int DownloadFile::progress() const {
+    if (expected() <= 0)
+        return 0;
+    return (int)(100 * _received / expected());
+}
+
+QString DownloadFile::tempName() const {
+    return _baseDir + "/." + _app->name();
+}
+
+QString DownloadFile::finalName() const {
+    return _baseDir + "/" + _app->name();
+}
+
+QString DownloadFile::journalName() const {
+    return tempName() + ".journal";
+}
+
+qint64 DownloadFile::partialSize() const {
+    // A segmented file is always full size on disk, only the journal knows what is in it
+    QList<DownloadSegment> segments;
+    if (!loadJournal(&segments))
+        return QFileInfo(tempName()).size();
+    qint64 done = 0;
+    foreach (DownloadSegment seg, segments)
+        done += seg.done;
+    return done;
+}
+
+// Journal format: the expected size on the first line, then 'start end done' for each segment
+bool DownloadFile::loadJournal(QList<DownloadSegment>* segments) const {
+    QFile journal(journalName());
+    if (!journal.open(QIODevice::ReadOnly | QIODevice::Text))
+        return false;
+    if (QFileInfo(tempName()).size() != expected())
+        return false;
+    QTextStream in(&journal);
+    if (in.readLine().toLongLong() != expected())
+        return false;
+    segments->clear();
+    while (!in.atEnd()) {
+        QStringList parts = in.readLine().split(' ', QString::SkipEmptyParts);
+        if (parts.isEmpty())
+            continue;
+        if (parts.count() != 3)
+            return false;
+        DownloadSegment seg(parts[0].toLongLong(), parts[1].toLongLong(), parts[2].toLongLong());
+        if (seg.start < 0 || seg.end <= seg.start || seg.end > expected() || seg.done < 0 || seg.done > seg.end - seg.start)
+            return false;
+        segments->append(seg);
+    }
+    return segments->count() > 1;
+}
+
+void DownloadFile::saveJournal() {
+    if (!isSegmented())
+        return;
+    // Never let the journal claim data that is still sitting in a buffer
+    _file.flush();
+    QSaveFile journal(journalName());
+    if (!journal.open(QIODevice::WriteOnly | QIODevice::Text))
+        return;
+    QTextStream out(&journal);
+    out << expected() << "\n";
+    foreach (DownloadSegment seg, _segments)
+        out << seg.start << " " << seg.end << " " << seg.done << "\n";
+    out.flush();
+    journal.commit();
+    _journalAt = _received;
+}
+
+void DownloadFile::planSegments() {
+    _segments.clear();
+    qint64 existing = QFileInfo(tempName()).size();
+    // Anything left over from a plain download is continued as it was
+    if (expected() < DOWNLOAD_SEGMENT_MIN || existing > 0 || !_stream.isNull()) {
+        DownloadSegment seg(0, expected(), existing);
+        _segments.append(seg);
+        return;
+    }
+    qint64 step = expected() / DOWNLOAD_SEGMENTS;
+    for (int i = 0; i < DOWNLOAD_SEGMENTS; i++) {
+        DownloadSegment seg(i * step, (i == DOWNLOAD_SEGMENTS - 1) ? expected() : (i + 1) * step);
+        _segments.append(seg);
+    }
+}
+
+DownloadStream* DownloadFile::openStream() {
+    if (_stream.isNull()) {
+        _stream = QSharedPointer<DownloadStreamState>(new DownloadStreamState);
+        _stream->available = 0;
+        _stream->done = false;
+        _stream->failed = false;
+        _stream->readers = 0;
+        _stream->commitPending = false;
+        _stream->tempName = tempName();
+        _stream->finalName = finalName();
+    }
+    // Make sure there is something to open, even before the first byte arrives
+    if (!QFile::exists(tempName())) {
+        QFile create(tempName());
+        create.open(QIODevice::WriteOnly);
+    }
+    DownloadStream* stream = new DownloadStream(_stream, expected());
+    stream->open(QIODevice::ReadOnly);
+    return stream;
+}
+
+// Tells readers how much of the file they can have
+void DownloadFile::updateStream(bool done, bool failed) {
+    if (_stream.isNull())
+        return;
+    if (_file.isOpen())
+        _file.flush();
+    QMutexLocker locker(&_stream->mutex);
+    _stream->available = contiguousEnd();
+    _stream->done = _stream->done || done;
+    // Once readers have been told the data is bad, there is no going back
+    _stream->failed = _stream->failed || failed;
+    _stream->grown.wakeAll();
+}
+
+void DownloadFile::start(QNetworkAccessManager* manager) {
+    _manager = manager;
+    _state = Running;
+    _file.setFileName(tempName());
+    if (!loadJournal(&_segments))
+        planSegments();
+
+    _file.open(QIODevice::ReadWrite);
+    if (isSegmented()) {
+        // Every segment writes straight in to its own place
+        if (_file.size() != expected())
+            _file.resize(expected());
+        saveJournal();
+    }
+    _received = 0;
+    _buffered = 0;
+    _unreported = 0;
+    foreach (DownloadSegment seg, _segments)
+        _received += seg.done;
+    _journalAt = _received;
+    setupHash();
+    updateStream();
+
+    bool started = false;
+    for (int i = 0; i < _segments.count(); i++) {
+        // A plain download of unknown size is only over when the server says so
+        if (_segments[i].done < _segments[i].end - _segments[i].start || (!isSegmented() && expected() <= 0)) {
+            startSegment(i);
+            started = true;
+        }
+    }
+    if (!started) {
+        // Everything was already here, but it still has to match
+        verifyHash();
+        updateStream(true);
+        _file.close();
+        _state = Finished;
+        emit finished();
+    }
+}
+
+void DownloadFile::startSegment(int i) {
+    DownloadSegment& seg = _segments[i];
+    QNetworkRequest request(_app->url());
+    request.setAttribute(QNetworkRequest::HttpPipeliningAllowedAttribute, true);
+    // It is possible that it already exists and, in this case, we would want to resume
+    bool ranged = isSegmented() || seg.done > 0;
+    if (isSegmented())
+        request.setRawHeader("Range", QString("bytes=%1-%2").arg(seg.start + seg.done).arg(seg.end - 1).toLatin1());
+    else if (ranged)
+        request.setRawHeader("Range", QString("bytes=%1-").arg(seg.done).toLatin1());
+    seg.checked = !ranged;
+
+    QNetworkReply* reply = _manager->get(request);
+    // Let the socket wait rather than piling up data we can't write fast enough
+    reply->setReadBufferSize(DOWNLOAD_READ_BUFFER);
+    seg.reply = reply;
+    connect(reply, &QNetworkReply::readyRead, this, [=]() { segmentData(reply); });
+    connect(reply, &QNetworkReply::finished, this, [=]() { segmentFinished(reply); });
+    connect(reply, static_cast<void (QNetworkReply::*)(QNetworkReply::NetworkError)>(&QNetworkReply::error),
+            this, [=](QNetworkReply::NetworkError code) { segmentError(reply, code); });
+}
+
+// Replies that were aborted or replaced are no longer in the list and get ignored
+int DownloadFile::findSegment(QNetworkReply* reply) const {
+    for (int i = 0; i < _segments.count(); i++) {
+        if (_segments.at(i).reply == reply)
+            return i;
+    }
+    return -1;
+}
+
+void DownloadFile::segmentData(QNetworkReply* reply) {
+    int i = findSegment(reply);
+    if (i < 0)
+        return;
+    DownloadSegment& seg = _segments[i];
+    if (!seg.checked) {
+        seg.checked = true;
+        if (reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() != 206) {
+            fallbackToSingle();
+            return;
+        }
+    }
+
+    QByteArray data = Bandwidth::instance()->read(reply, Bandwidth::Download);
+    if (data.isEmpty())
+        return;
+    qint64 at = seg.start + seg.done + seg.buffer.size();
+    // Is this our first receive?
+    if (at == 0 && data.startsWith("<?xml")) {
+        abortSegments();
+        updateStream(false, true);
+        _file.close();
+        _state = Failed;
+        emit restricted();
+        return;
+    }
+    // A segment never spills in to the next one
+    if (isSegmented() && data.size() > seg.end - at)
+        data.truncate((int)(seg.end - at));
+    // Data that continues the hashed part is hashed while it is still in memory
+    if (_hash != nullptr && at == _hashedAt) {
+        _hash->addData(data);
+        _hashedAt += data.size();
+    }
+    seg.buffer.append(data);
+    _buffered += data.size();
+    _received += data.size();
+    _unreported += data.size();
+    // Lots of small writes cost more than the download itself on a fast connection
+    if (_buffered >= DOWNLOAD_WRITE_BUFFER) {
+        for (int j = 0; j < _segments.count(); j++)
+            flushSegment(j);
+    }
+    reportProgress();
+}
+
+void DownloadFile::flushSegment(int i) {
+    DownloadSegment& seg = _segments[i];
+    if (seg.buffer.isEmpty())
+        return;
+    _file.seek(seg.start + seg.done);
+    _file.write(seg.buffer);
+    seg.done += seg.buffer.size();
+    _buffered -= seg.buffer.size();
+    seg.buffer.clear();
+    // Whatever later segments already wrote may now continue the hashed part
+    if (_hash != nullptr)
+        catchUpHash();
+    if (isSegmented() && _received - _journalAt >= DOWNLOAD_JOURNAL_STEP)
+        saveJournal();
+    updateStream();
+}
+
+void DownloadFile::reportProgress(bool force) {
+    if (_unreported == 0)
+        return;
+    if (!force && _reportTimer.isValid() && _reportTimer.elapsed() < DOWNLOAD_PROGRESS_INTERVAL)
+        return;
+    _reportTimer.start();
+    qint64 delta = _unreported;
+    _unreported = 0;
+    emit progressed(delta);
+}
+
+// Reads what was held back now that there is bandwidth for it
+void DownloadFile::resumeSegments() {
+    QList<QNetworkReply*> replies;
+    foreach (DownloadSegment seg, _segments) {
+        if (seg.reply != nullptr && seg.reply->bytesAvailable() > 0)
+            replies.append(seg.reply);
+    }
+    foreach (QNetworkReply* reply, replies) {
+        if (reply->isFinished())
+            segmentFinished(reply);
+        else
+            segmentData(reply);
+    }
+}
+
+void DownloadFile::segmentFinished(QNetworkReply* reply) {
+    // Aborted replies finish too, but the error handler deals with them
+    if (findSegment(reply) < 0 || reply->error() != QNetworkReply::NoError)
+        return;
+    segmentData(reply);
+    int i = findSegment(reply);
+    // Held back by the bandwidth limit; resumeSegments() comes back for the rest
+    if (i < 0 || reply->bytesAvailable() > 0)
+        return;
+    _segments[i].reply = nullptr;
+    reply->deleteLater();
+    flushSegment(i);
+
+    foreach (DownloadSegment seg, _segments) {
+        if (seg.reply != nullptr)
+            return;
+    }
+    reportProgress(true);
+    // Whether the size is right is for DownloadInfo to decide
+    if (isSegmented())
+        saveJournal();
+    verifyHash();
+    updateStream(true);
+    _file.close();
+    _state = Finished;
+    emit finished();
+}
+
+void DownloadFile::segmentError(QNetworkReply* reply, QNetworkReply::NetworkError code) {
+    if (findSegment(reply) < 0)
+        return;
+    QString error = reply->errorString();
+    abortSegments();
+    reportProgress(true);
+    updateStream(false, true);
+    _file.close();
+    _state = Failed;
+    emit failed(error, code == QNetworkReply::OperationCanceledError);
+}
+
+void DownloadFile::fallbackToSingle() {
+    // Everything received so far is taken back, including what was not reported yet
+    reportProgress(true);
+    qint64 lost = _received;
+    abortSegments();
+    // Anyone reading along may already have data that is about to be thrown away
+    if (lost > 0)
+        updateStream(false, true);
+    QFile::remove(journalName());
+    _file.resize(0);
+    _segments.clear();
+    DownloadSegment seg(0, expected(), 0, true);
+    _segments.append(seg);
+    _received = 0;
+    _buffered = 0;
+    _journalAt = 0;
+    setupHash();
+    if (lost > 0)
+        emit progressed(-lost);
+    startSegment(0);
+}
+
+void DownloadFile::setupHash() {
+    delete _hash;
+    _hash = nullptr;
+    _hashedAt = 0;
+    _checksumError.clear();
+    // The published checksum is for the full package, not a patch against it
+    if (_app->url().contains("+patch+"))
+        return;
+    _checksum = QByteArray::fromHex(_app->checksum().toLatin1());
+    if (_checksum.size() * 2 != _app->checksum().size())
+        return;
+    switch (_checksum.size()) {
+    case 16: _hash = new QCryptographicHash(QCryptographicHash::Md5); break;
+    case 20: _hash = new QCryptographicHash(QCryptographicHash::Sha1); break;
+    case 32: _hash = new QCryptographicHash(QCryptographicHash::Sha256); break;
+    case 64: _hash = new QCryptographicHash(QCryptographicHash::Sha512); break;
+    default: return;
+    }
+    // When resuming, the hash picks up from what is already on disk
+    catchUpHash();
+}
+
+qint64 DownloadFile::contiguousEnd() const {
+    qint64 pos = 0;
+    foreach (DownloadSegment seg, _segments) {
+        if (seg.start != pos)
+            break;
+        pos = seg.start + seg.done;
+        if (seg.done < seg.end - seg.start)
+            break;
+    }
+    return pos;
+}
+
+void DownloadFile::catchUpHash() {
+    qint64 target = contiguousEnd();
+    if (_hash == nullptr || target <= _hashedAt || !_file.isOpen())
+        return;
+    _file.flush();
+    _file.seek(_hashedAt);
+    while (_hashedAt < target) {
+        QByteArray data = _file.read(qMin(target - _hashedAt, (qint64)(1024 * 1024)));
+        if (data.isEmpty())
+            break;
+        _hash->addData(data);
+        _hashedAt += data.size();
+    }
+}
+
+void DownloadFile::verifyHash() {
+    if (_hash == nullptr || _received != expected())
+        return;
+    catchUpHash();
+    if (_hashedAt != expected())
+        return;
+    if (_hash->result() != _checksum)
+        _checksumError = QString("bytes 0-%1 hash to %2, expected %3")
+                .arg(_hashedAt - 1)
+                .arg(QString(_hash->result().toHex()))
+                .arg(QString(_checksum.toHex()));
+}
+
+void DownloadFile::abortSegments() {
+    for (int i = 0; i < _segments.count(); i++) {
+        QNetworkReply* reply = _segments[i].reply;
+        if (reply == nullptr)
+            continue;
+        // Clear first so the handlers know this was on purpose
+        _segments[i].reply = nullptr;
+        reply->abort();
+        reply->deleteLater();
+    }
+    // What was received is still good, so it is kept for a resume
+    if (_file.isOpen()) {
+        for (int i = 0; i < _segments.count(); i++)
+            flushSegment(i);
+        saveJournal();
+    }
+}
+
+void DownloadFile::abort() {
+    abortSegments();
+    if (_state == Running)
+        updateStream(false, true);
+    if (_file.isOpen())
+        _file.close();
+}
+
+bool DownloadFile::commit() {
+    if (_file.isOpen())
+        _file.close();
+    QFile::remove(journalName());
+    if (!_stream.isNull()) {
+        QMutexLocker locker(&_stream->mutex);
+        // Still being read, the last reader to close moves it
+        if (_stream->readers > 0) {
+            _stream->commitPending = true;
+            return true;
+        }
+    }
+    QFile::remove(finalName());
+    if (!QFile::rename(tempName(), finalName()))
+        return false;
+    emit committed(finalName());
+    return true;
+}
+
+void DownloadFile::discard() {
+    abort();
+    updateStream(false, true);
+    QFile::remove(tempName());
+    QFile::remove(journalName());
+    _segments.clear();
+    _received = 0;
+    _buffered = 0;
+    _unreported = 0;
+    _checksumError.clear();
+    _state = Queued;
+}
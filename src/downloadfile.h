@@ -0,0 +1,190 @@
+// Copyright (C) 2014 Sacha Refshauge
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 3.0.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 3.0 for more details.
+
+// A copy of the GPL 3.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official GIT repository and contact information can be found at
+// http://github.com/xsacha/Sachesi
+
+#pragma once
+
+#include <QFile>
+#include <QFileInfo>
+#include <QList>
+#include <QElapsedTimer>
+#include <QCryptographicHash>
+#include <QNetworkRequest>
+#include <QNetworkReply>
+#include <QNetworkAccessManager>
+#include "apps.h"
+
+// Files at least this big are fetched as several byte ranges at once
+#define DOWNLOAD_SEGMENT_MIN (64 * 1024 * 1024)
+#define DOWNLOAD_SEGMENTS 4
+// How much can arrive before the journal is brought up to date
+#define DOWNLOAD_JOURNAL_STEP (8 * 1024 * 1024)
+// Received data is gathered up to this much per file before it is written
+#define DOWNLOAD_WRITE_BUFFER (4 * 1024 * 1024)
+// How much each reply may hold before Qt stops reading from the socket
+#define DOWNLOAD_READ_BUFFER (1024 * 1024)
+// Progress is passed on no more often than this (ms)
+#define DOWNLOAD_PROGRESS_INTERVAL 100
+
+// One byte range of a file. 'end' is exclusive.
+struct DownloadSegment {
+    DownloadSegment(qint64 start = 0, qint64 end = 0, qint64 done = 0, bool checked = false)
+        : start(start), end(end), done(done), reply(nullptr), checked(checked) {}
+
+    qint64 start;
+    qint64 end;
+    qint64 done;
+    QNetworkReply* reply;
+    bool checked; // Whether the response was confirmed to be for this range
+    QByteArray buffer; // Received after 'done' but not written yet
+};
+
+// What a DownloadStream knows about the download it follows. Shared between threads.
+struct DownloadStreamState {
+    QMutex mutex;
+    QWaitCondition grown;
+    qint64 available; // Bytes from the start of the file that are on disk
+    bool done;
+    bool failed;
+    int readers;
+    // A commit that has to wait for the readers to let go of the file
+    bool commitPending;
+    QString tempName, finalName;
+};
+
+// Reads a file while it is still being downloaded. Reads past what has arrived block
+// until the data is there, so it can be handed to code that expects a finished file.
+class DownloadStream : public QIODevice {
+    Q_OBJECT
+public:
+    DownloadStream(QSharedPointer<DownloadStreamState> state, qint64 size, QObject* parent = 0);
+    ~DownloadStream();
+
+    bool open(OpenMode mode);
+    void close();
+    qint64 size() const { return _size; }
+    bool isSequential() const { return false; }
+    QString fileName() const { return _state->finalName; }
+    // Wakes up and fails a blocked read, from any thread
+    void cancel();
+
+signals:
+    // The last reader let go of a finished download and it was moved in to place
+    void committed(QString fileName);
+
+protected:
+    qint64 readData(char* data, qint64 maxlen);
+    qint64 writeData(const char* data, qint64 len);
+
+private:
+    QSharedPointer<DownloadStreamState> _state;
+    QFile _file;
+    qint64 _size;
+};
+
+// The state of one file of a download. DownloadInfo runs several of these at once.
+// Data goes to baseDir/.<name> and is renamed to baseDir/<name> by commit().
+// Large files are pre-allocated and split in to segments whose progress is kept in
+// baseDir/.<name>.journal, so that a resume only fetches what each segment is missing.
+class DownloadFile : public QObject {
+    Q_OBJECT
+public:
+    enum State {
+        Queued = 0,
+        Running,
+        Finished,
+        Failed,
+    };
+
+    DownloadFile(Apps* app, QString baseDir, QObject* parent = 0);
+    ~DownloadFile();
+
+    Apps* app() const { return _app; }
+    State state() const { return _state; }
+    qint64 expected() const { return _app->size(); }
+    // Bytes on disk, including anything from an earlier session
+    qint64 received() const { return _received; }
+    int progress() const;
+    QString tempName() const;
+    QString finalName() const;
+    QString journalName() const;
+    // What a resume would start from
+    qint64 partialSize() const;
+    bool isSegmented() const { return _segments.count() > 1; }
+    // Empty unless the finished file did not match the checksum from the update server
+    QString checksumError() const { return _checksumError; }
+
+    // A reader that follows the download. Has to be called before start(), which will
+    // then fetch the file from front to back instead of in segments.
+    DownloadStream* openStream();
+    // Resumes from whatever is already in the temporary file
+    void start(QNetworkAccessManager* manager);
+    void abort();
+    // Moves the temporary file in to place. While a stream still reads it, the move is left
+    // to the stream, which then emits committed() instead of this.
+    bool commit();
+    // Throws away the temporary file so the next start() begins from scratch
+    void discard();
+
+signals:
+    void progressed(qint64 delta);
+    void finished();
+    void failed(QString error, bool cancelled);
+    // The server sent an error page instead of the file
+    void restricted();
+    // The file is in place under finalName()
+    void committed(QString fileName);
+
+private:
+    bool loadJournal(QList<DownloadSegment>* segments) const;
+    void saveJournal();
+    void planSegments();
+    void startSegment(int i);
+    int findSegment(QNetworkReply* reply) const;
+    void segmentData(QNetworkReply* reply);
+    void segmentFinished(QNetworkReply* reply);
+    void resumeSegments();
+    void segmentError(QNetworkReply* reply, QNetworkReply::NetworkError code);
+    // The server ignored Range, so start over with one plain request
+    void fallbackToSingle();
+    void abortSegments();
+    void updateStream(bool done = false, bool failed = false);
+    // Writes out what a segment has gathered
+    void flushSegment(int i);
+    void reportProgress(bool force = false);
+    // Hashing follows the start of the file as far as it is complete
+    void setupHash();
+    qint64 contiguousEnd() const;
+    void catchUpHash();
+    void verifyHash();
+
+    Apps* _app;
+    QString _baseDir;
+    State _state;
+    QFile _file;
+    QNetworkAccessManager* _manager;
+    QList<DownloadSegment> _segments;
+    qint64 _received;
+    qint64 _journalAt;
+    qint64 _buffered;
+    qint64 _unreported;
+    QElapsedTimer _reportTimer;
+    QCryptographicHash* _hash;
+    QByteArray _checksum;
+    qint64 _hashedAt;
+    QString _checksumError;
+    QSharedPointer<DownloadStreamState> _stream;
+};
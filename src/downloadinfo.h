@@ -18,17 +18,35 @@
 #pragma once
 #include <QDir>
 #include <QFile>
-#include <QDesktopServices>
 #include <QNetworkRequest>
 #include <QNetworkReply>
 #include <QNetworkAccessManager>
-#include <QMessageBox>
+#include <QSettings>
+#include <QDebug>
+#include <algorithm>
+#include <functional>
 #include "apps.h"
-#include "ports.h"
-
-// Need to get creative with CURR_FILE when threading comes
-enum {
-    CURR_FILE = -1,
+#include "portscore.h"
+#include "downloadfile.h"
+#include "linkverifier.h"
+#include "deltaplanner.h"
+#include "downloadstore.h"
+
+// Qt only opens 6 connections per host, anything above this just queues
+#define MAX_PARALLEL_DOWNLOADS 6
+
+// How DownloadInfo settles anything it would otherwise have to ask about. The GUI shows
+// dialogs, sachesi-cli answers from its command line. Unset callbacks keep what was received.
+struct DownloadPolicy {
+    enum Action {
+        Keep = 0,
+        Discard, // Throw the file away and fetch it again
+        Abort,   // Give up on the whole download
+    };
+    std::function<Action(const QString& fileName, const QString& issue)> mismatch;
+    std::function<void(const QString& error)> error;
+    // Everything is in baseDir
+    std::function<void(const QString& baseDir)> finished;
 };
 
 class DownloadInfo : public QObject {
@@ -39,26 +57,45 @@ class DownloadInfo : public QObject {
     Q_PROPERTY(int     progress    MEMBER progress    NOTIFY sizeChanged)
     Q_PROPERTY(int     size        MEMBER size        NOTIFY sizeChanged)
     Q_PROPERTY(qint64  totalSize   MEMBER totalSize   NOTIFY appsChanged)
+    Q_PROPERTY(qint64  savedSize   MEMBER savedSize   NOTIFY sizeChanged)
     Q_PROPERTY(QString curName     READ   getName     NOTIFY idChanged)
     Q_PROPERTY(bool    verifying   READ   verifying   NOTIFY verifyingChanged)
     Q_PROPERTY(bool    running     MEMBER running     NOTIFY idChanged)
+    Q_PROPERTY(int     active      READ   active      NOTIFY idChanged)
+    Q_PROPERTY(int     parallel    READ   parallel    WRITE setParallel NOTIFY parallelChanged)
+    Q_PROPERTY(bool    extractWhileDownloading READ extractWhileDownloading WRITE setExtractWhileDownloading NOTIFY extractWhileDownloadingChanged)
 public:
     DownloadInfo(QObject* parent = 0)
         : QObject(parent)
         , baseDir("")
         , id(0), maxId(0)
         , progress(0), curProgress(0)
-        , size(0), totalSize(0)
+        , size(0), totalSize(0), savedSize(0)
         , starting(false)
         , toVerify(0)
         , running(false)
+        , _manager(new QNetworkAccessManager())
+        , _verifier(new LinkVerifier(_manager, this))
+        , _planner(_verifier)
     {
-        _manager = new QNetworkAccessManager();
+        QSettings settings("Qtness","Sachesi");
+        _parallel = qBound(1, settings.value("downloadParallel", 4).toInt(), MAX_PARALLEL_DOWNLOADS);
+        _extractWhileDownloading = settings.value("extractWhileDownloading", false).toBool();
+        _streamed = false;
     }
 
     Q_INVOKABLE void reset() {
-        if (_updateFile.isOpen())
-            _updateFile.close();
+        // Partial files are kept so that they can be resumed.
+        // This can be reached from one of the file's own signals, so don't delete it right away.
+        foreach (DownloadFile* file, _files) {
+            file->disconnect(this);
+            file->abort();
+            file->deleteLater();
+        }
+        _files.clear();
+        _streamed = false;
+        // Nothing that is still being verified matters any more
+        _verifier->cancel();
 
         starting = false;
         running = false;
@@ -66,6 +103,7 @@ public:
         maxId = 0;
         size = 0;
         totalSize = 0;
+        savedSize = 0;
         toVerify = 0;
         foreach(Apps* app, apps) {
             if (app != nullptr) {
@@ -81,10 +119,46 @@ public:
 
     Q_INVOKABLE void start() {
         starting = true;
-        if (_updateFile.isOpen()) {
-            _updateFile.close();
-            _updateFile.remove();
+    }
+
+    int active() const {
+        int count = 0;
+        foreach (DownloadFile* file, _files) {
+            if (file->state() == DownloadFile::Running)
+                count++;
         }
+        return count;
+    }
+
+    void setPolicy(const DownloadPolicy& policy) {
+        _policy = policy;
+    }
+
+    int parallel() const { return _parallel; }
+    void setParallel(int parallel) {
+        useParallel(parallel);
+        QSettings settings("Qtness","Sachesi");
+        settings.setValue("downloadParallel", _parallel);
+    }
+    // Same as setParallel, for this session only
+    void useParallel(int parallel) {
+        parallel = qBound(1, parallel, MAX_PARALLEL_DOWNLOADS);
+        if (parallel == _parallel)
+            return;
+        _parallel = parallel;
+        emit parallelChanged();
+        if (running)
+            scheduleFiles();
+    }
+
+    bool extractWhileDownloading() const { return _extractWhileDownloading; }
+    void setExtractWhileDownloading(bool extract) {
+        if (extract == _extractWhileDownloading)
+            return;
+        _extractWhileDownloading = extract;
+        QSettings settings("Qtness","Sachesi");
+        settings.setValue("extractWhileDownloading", _extractWhileDownloading);
+        emit extractWhileDownloadingChanged();
     }
 
     bool isStarting() {
@@ -100,21 +174,33 @@ public:
     void verifyDelta(int i) {
         toVerify++;
         emit verifyingChanged();
-        QString url = apps.at(i)->url();
-        QString oldVersion = apps.at(i)->installedVersion();
-        oldVersion.replace('.','_');
-        url.chop(4); // Remove extension
-        url.append(QString("+patch+%1.bar").arg(oldVersion));
-        QNetworkReply* reply = _manager->head(QNetworkRequest(url));
-
-        QObject::connect(reply, &QNetworkReply::finished, [=]() {
-            uint status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toUInt();
-            if (status == 200 || (status > 300 && status <= 308)) {
-                uint realSize = reply->header(QNetworkRequest::ContentLengthHeader).toUInt();
+        Apps* app = apps.at(i);
+        // Chains can only go through versions we know exist, which are the ones downloaded before
+        QStringList intermediates;
+        if (app->type() == "os")
+            intermediates = DeltaPlanner::localVersions(app, app->installedVersion(), app->version());
+
+        _planner.plan(app, intermediates, [=](const DeltaPlan& plan) {
+            if (plan.urls.count() == 2) {
+                // Patch to the intermediate version first, which goes in as a file of its own
+                QString hopUrl = plan.urls.first();
+                Apps* hop = new Apps(app, this);
+                hop->setUrl(hopUrl);
+                hop->setName(hopUrl.split('/').last());
+                hop->setVersion(plan.via);
+                hop->setSize(plan.sizes.first());
+                hop->setChecksum("");
+                apps.insert(apps.indexOf(app), hop);
+                maxId++;
+                // The second patch goes on top of the first
+                app->setInstalledVersion(plan.via);
+            }
+            if (plan.urls.last() != app->url()) {
                 // Adjust the expected size
-                totalSize += realSize - apps.at(i)->size();
-                apps.at(i)->setSize(realSize);
-                apps.at(i)->setUrl(url);
+                totalSize += plan.total - app->size();
+                savedSize += plan.saved();
+                app->setSize(plan.sizes.last());
+                app->setUrl(plan.urls.last());
                 emit sizeChanged();
                 emit appsChanged();
             }
@@ -123,54 +209,39 @@ public:
             // Verified. Now to complete
             if (toVerify == 0)
                 startDownload();
-            reply->deleteLater();
-        });
-        QObject::connect(reply, static_cast<void (QNetworkReply::*)(QNetworkReply::NetworkError)>(&QNetworkReply::error), [=]() {
-            toVerify--;
-            emit verifyingChanged();
-            // Verified. Now to complete
-            if (toVerify == 0)
-                startDownload();
-            reply->deleteLater();
         });
     }
 
     void verifyLink(QString url, QString type, bool delta) {
         toVerify++;
         emit verifyingChanged();
-        QNetworkReply* reply = _manager->head(QNetworkRequest(url));
-
-        QObject::connect(reply, &QNetworkReply::finished, [=]() {
-            uint status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toUInt();
-            if (status == 200 || (status > 300 && status <= 308)) {
-                uint realSize = reply->header(QNetworkRequest::ContentLengthHeader).toUInt();
-                // Adjust the expected size
-                foreach(Apps* app, apps) {
-                    if (app->type() == type.toLower()) {
-                        totalSize += realSize - app->size();
-                        app->setSize(realSize);
-                        emit sizeChanged();
-                        emit appsChanged();
-                    }
-                }
 
-                toVerify--;
-                emit verifyingChanged();
-                // Verified. Now to complete
-                if (toVerify == 0)
-                    download(delta);
-            } else {
+        _verifier->verify(url, [=](const VerifyResult& result) {
+            if (result.status == 0) {
                 reset();
-                QMessageBox::information(NULL, "Error", "The server did not have the " + type + " for the selected 'Download Device'.\n\nPlease try a different search result or a different download device.");
+                reportError("Encountered an error when attempting to verify the " + type +".\n Aborting download.");
+                return;
             }
-            reply->deleteLater();
-        });
-        QObject::connect(reply, static_cast<void (QNetworkReply::*)(QNetworkReply::NetworkError)>(&QNetworkReply::error), [=]() {
-            if (toVerify > 0) {
-                QMessageBox::information(NULL, "Error", "Encountered an error when attempting to verify the " + type +".\n Aborting download.");
+            if (!result.found()) {
                 reset();
+                reportError("The server did not have the " + type + " for the selected 'Download Device'.\n\nPlease try a different search result or a different download device.");
+                return;
             }
-            reply->deleteLater();
+            // Adjust the expected size
+            foreach(Apps* app, apps) {
+                if (app->type() == type.toLower()) {
+                    totalSize += result.length - app->size();
+                    app->setSize(result.length);
+                    emit sizeChanged();
+                    emit appsChanged();
+                }
+            }
+
+            toVerify--;
+            emit verifyingChanged();
+            // Verified. Now to complete
+            if (toVerify == 0)
+                download(delta);
         });
     }
 
@@ -180,7 +251,7 @@ public:
             for (int i = 0; i < apps.count(); i++) {
                 if (!apps.at(i)->isMarked() || apps.at(i)->installedVersion().isEmpty())
                     continue;
-                if (isVersionNewer(apps.at(i)->version(), apps.at(i)->installedVersion(), false))
+                if (apps.at(i)->packedVersion().isNewerThan(apps.at(i)->packedInstalledVersion(), false))
                     verifyDelta(i);
             }
         }
@@ -194,7 +265,8 @@ public:
         for (int i = 0; i < apps.count(); i++) {
             if (apps[i]->type() == "os" || apps[i]->type() == "radio") {
                 QFileInfo fileInfo(baseDir + "/" + apps[i]->name());
-                if (fileInfo.exists() && fileInfo.size() == apps[i]->size()) {
+                if ((fileInfo.exists() && fileInfo.size() == apps[i]->size())
+                        || DownloadStore::linkInto(apps[i], fileInfo.absoluteFilePath())) {
                     totalSize -= apps[i]->size();
                     delete apps[i];
                     apps.removeAt(i--);
@@ -210,119 +282,91 @@ public:
         }
         emit idChanged(); // For above, running=true and if any apps changed
         QDir(baseDir).mkpath(".");
-        downloadNextFile();
+
+        // Largest first, so that the long transfers are not left running on their own at the end
+        QList<Apps*> queue = apps;
+        std::stable_sort(queue.begin(), queue.end(), [](Apps* a, Apps* b) { return a->size() > b->size(); });
+        foreach (Apps* app, queue)
+            _files.append(new DownloadFile(app, baseDir));
+        id = 0;
+        scheduleFiles();
     }
 
-    void downloadNextFile() {
-        curSize = 0;
-        QNetworkRequest request(getUrl());
-        request.setAttribute(QNetworkRequest::HttpPipeliningAllowedAttribute, true);
-        // Set to a temporary filename
-        _updateFile.setFileName(baseDir + "/." + apps.at(id)->name());
+    // Keeps up to 'parallel' files running
+    void scheduleFiles() {
+        foreach (DownloadFile* file, _files) {
+            if (!running || active() >= _parallel)
+                break;
+            if (file->state() == DownloadFile::Queued)
+                startFile(file);
+        }
+        emit idChanged();
+    }
+
+    void startFile(DownloadFile* file) {
         // Obviously something is wrong if this file is bigger than what we want
-        if (_updateFile.size() > apps.at(id)->size()) {
-            if (QMessageBox::warning(nullptr, "Issue",
-                                     QString("Expected filesize of %1 did not match (Expected %2, Received %3). Ignore the warning or discard the file to try again?").arg(apps.at(id)->name()).arg(apps.at(id)->size()).arg(_updateFile.size()),
-                                     QMessageBox::Discard, QMessageBox::Ignore) == QMessageBox::Discard) {
-                _updateFile.remove();
+        if (file->partialSize() > file->expected()) {
+            switch (decide(file, QString("Expected filesize of %1 did not match (Expected %2, Received %3).").arg(file->app()->name()).arg(file->expected()).arg(file->partialSize()))) {
+            case DownloadPolicy::Discard:
+                file->discard();
+                break;
+            case DownloadPolicy::Abort:
+                reset();
+                return;
+            default:
+                break;
             }
         }
-        // In the unlikely event that we missed that we had already downloaded it
+        // If it turns out to be complete already, it is verified and committed like any other
         // Maybe the user copied the relevant files in to a new folder during download?
-        if (_updateFile.size() == apps.at(id)->size()) {
-            size += _updateFile.size();
-            _updateFile.rename(baseDir + "/" + apps.at(id)->name());
-            completedFile();
-            return;
+        size += file->partialSize();
+
+        connect(file, &DownloadFile::progressed, this, &DownloadInfo::progressSize, Qt::UniqueConnection);
+        connect(file, &DownloadFile::finished, this, &DownloadInfo::fileFinished, Qt::UniqueConnection);
+        connect(file, &DownloadFile::failed, this, &DownloadInfo::fileFailed, Qt::UniqueConnection);
+        connect(file, &DownloadFile::restricted, this, &DownloadInfo::fileRestricted, Qt::UniqueConnection);
+        connect(file, &DownloadFile::committed, this, &DownloadInfo::fileCompleted, Qt::UniqueConnection);
+        // Only one image can be extracted at a time, and the OS is the one worth waiting for
+        // Nobody listening (sachesi-cli) would leave the stream holding on to the file forever
+        if (_extractWhileDownloading && !_streamed && (file->app()->type() == "os" || file->app()->type() == "radio")
+                && receivers(SIGNAL(streamOpened(DownloadStream*,QString))) > 0) {
+            _streamed = true;
+            DownloadStream* stream = file->openStream();
+            // The stream may be the one to put the file in place, long after the download is over
+            connect(stream, &DownloadStream::committed, this, &DownloadInfo::fileCompleted);
+            emit streamOpened(stream, file->finalName());
         }
-        // It is possible that it already exists and, in this case, we would want to resume
-        if (_updateFile.size() > 0) {
-            size += _updateFile.size();
-            curSize += _updateFile.size();
-            request.setRawHeader("Range", QString("bytes=%1-").arg(_updateFile.size()).toLatin1());
-        }
-        _updateFile.open(QIODevice::WriteOnly | QIODevice::Append);
-        QNetworkReply* replydl = _manager->get(request);
-
-        connect(replydl, &QNetworkReply::readyRead, [=]() {
-            if (!running) {
-                replydl->abort();
-                replydl->deleteLater();
-                return;
-            }
-
-            QByteArray data = replydl->readAll();
-            // Is this our first receive?
-            if (size == 0)
-            {
-                if (data.startsWith("<?xml")) {
-                    QMessageBox::critical(nullptr, "Error", "You are restricted from downloading this file.");
-                    replydl->abort();
-                    replydl->deleteLater();
-                    reset();
-                    return;
-                }
-            }
-            progressSize(data.size());
-            _updateFile.write(data);
-        });
-        connect(replydl, &QNetworkReply::finished, [=]() {
-            replydl->deleteLater();
-
-            // Then why are we here?
-            if (!running)
-                return;
-
-            // This should always match otherwise I'm pretty sure something bad happened
-            if (_updateFile.size() == apps.at(id)->size())
-                _updateFile.rename(baseDir + "/" + apps.at(id)->name());
-            else {
-                if (QMessageBox::warning(nullptr, "Issue",
-                                         QString("Expected filesize of %1 did not match (Expected %2, Received %3). Ignore the warning or discard the file to try again?").arg(apps.at(id)->name()).arg(apps.at(id)->size()).arg(_updateFile.size()),
-                                         QMessageBox::Discard, QMessageBox::Ignore) == QMessageBox::Discard)
-                {
-                    // Discard and try again
-                    size -= _updateFile.size();
-                    _updateFile.close();
-                    _updateFile.remove();
-                    downloadNextFile();
-                    return;
-                }
-                // Pretend like that didn't happen
-            }
-
-            completedFile();
-        });
-        QObject::connect(replydl, static_cast<void (QNetworkReply::*)(QNetworkReply::NetworkError)>(&QNetworkReply::error), [=]() {
-            replydl->deleteLater();
-            reset();
-            if (replydl->error() == 5)
-                return; // User cancelled
-
-            qDebug() << "DL Error: "  << replydl->error() << replydl->errorString();
-        });
+        file->start(_manager);
     }
 
-    void completedFile() {
-        if (nextFile())
-        {
-            downloadNextFile();
-        } else {
-            /*if (size != totalSize)
-                QMessageBox::information(NULL, "Warning", QString("Your update completed successfully.\n"
-                                         "However, the update size does not match the download size. This is probably just be a bug that you can ignore.\n"
-                                         "Downloaded: %1\n"
-                                         "Expected: %2")
-                                         .arg(size)
-                                         .arg(totalSize));*/
-
-            QDesktopServices::openUrl(QUrl(QFileInfo(_updateFile).absolutePath()));
-            reset();
+    void completedFile(DownloadFile* file) {
+        Q_UNUSED(file);
+        id++;
+        emit idChanged();
+        if (id < _files.count()) {
+            scheduleFiles();
+            return;
         }
+        /*if (size != totalSize)
+            QMessageBox::information(NULL, "Warning", QString("Your update completed successfully.\n"
+                                     "However, the update size does not match the download size. This is probably just be a bug that you can ignore.\n"
+                                     "Downloaded: %1\n"
+                                     "Expected: %2")
+                                     .arg(size)
+                                     .arg(totalSize));*/
+
+        QString finishedDir = baseDir;
+        reset();
+        if (_policy.finished)
+            _policy.finished(finishedDir);
     }
 
     void setApps(QList<Apps*> newApps, QString& version) {
-        baseDir = getSaveDir() + "/" + version;
+        setAppsIn(newApps, getSaveDir() + "/" + version);
+    }
+
+    void setAppsIn(QList<Apps*> newApps, const QString& dir) {
+        baseDir = dir;
 
         // Check which apps user wanted
         foreach (Apps* newApp, newApps) {
@@ -330,50 +374,49 @@ public:
                 continue;
             // We have to verify OS/Radio first
             if (newApp->type() == "application") {
-                // Check which apps user has already downloaded
+                // Check which apps user has already downloaded, here or for another release
                 QFileInfo fileInfo(baseDir + "/" + newApp->name());
                 if (fileInfo.exists() && fileInfo.size() == newApp->size())
                     continue;
+                if (DownloadStore::linkInto(newApp, fileInfo.absoluteFilePath()))
+                    continue;
             }
             apps.append(new Apps(newApp, this));
             totalSize += newApp->size();
         }
 
         maxId = apps.count();
-        nextFile(0);
+        refresh();
         emit appsChanged();
     }
 
-    QString getName(int i = CURR_FILE) {
-        if (i == CURR_FILE)
-            i = id;
-        if (i >= 0 && i < maxId)
-            return apps[i]->friendlyName();
-        else
-            return "";
+    // The largest file still transferring is what gets shown
+    DownloadFile* currentFile() const {
+        foreach (DownloadFile* file, _files) {
+            if (file->state() == DownloadFile::Running)
+                return file;
+        }
+        return nullptr;
     }
 
-    QString getUrl(int i = CURR_FILE) {
-        if (i == CURR_FILE)
-            i = id;
-        if (i >= 0 && i < maxId)
-            return apps[i]->url();
-        else
-            return "";
+    QString getName() const {
+        DownloadFile* file = currentFile();
+        if (file != nullptr)
+            return file->app()->friendlyName();
+        if (!running && !apps.isEmpty())
+            return apps.first()->friendlyName();
+        return "";
     }
 
-    int getSize(int i = CURR_FILE) {
-        if (i == CURR_FILE)
-            i = id;
-        if (i >= 0 && i < maxId)
-            return apps[i]->size();
-        else
-            return 0;
+    // Names may have changed underneath us
+    void refresh() {
+        emit idChanged();
     }
+
     void progressSize(qint64 bytes) {
         size += bytes;
-        curSize += bytes;
-        curProgress = 100*curSize / apps.at(id)->size();
+        DownloadFile* file = currentFile();
+        curProgress = (file != nullptr) ? file->progress() : 0;
         if (totalSize == 0)
             progress = 0;
         else
@@ -381,23 +424,13 @@ public:
         emit sizeChanged();
     }
 
-    bool nextFile(int i = CURR_FILE) {
-        curSize = 0;
-        if (i == CURR_FILE)
-            id++;
-        else
-            id = i;
-
-        emit idChanged();
-
-        return (id < maxId);
-    }
-
     QString baseDir;
     QList<Apps*> apps;
     int id, maxId;
     int progress, curProgress;
-    qint64 curSize, size, totalSize;
+    qint64 size, totalSize;
+    // What the patches save over downloading the full packages
+    qint64 savedSize;
     bool starting;
     qint16 toVerify;
     bool running;
@@ -406,7 +439,83 @@ signals:
     void sizeChanged();
     void appsChanged();
     void verifyingChanged();
+    void parallelChanged();
+    void extractWhileDownloadingChanged();
+    // The receiver owns the stream
+    void streamOpened(DownloadStream* stream, QString fileName);
+    // A file is in place under its final name
+    void fileCompleted(QString fileName);
+
+private slots:
+    void fileFinished() {
+        DownloadFile* file = qobject_cast<DownloadFile*>(sender());
+        // This should always match otherwise I'm pretty sure something bad happened
+        QString issue;
+        if (file->received() != file->expected())
+            issue = QString("Expected filesize of %1 did not match (Expected %2, Received %3).").arg(file->app()->name()).arg(file->expected()).arg(file->received());
+        else if (!file->checksumError().isEmpty())
+            issue = QString("Checksum of %1 did not match: %2.").arg(file->app()->name()).arg(file->checksumError());
+
+        DownloadPolicy::Action action = issue.isEmpty() ? DownloadPolicy::Keep : decide(file, issue);
+        if (action == DownloadPolicy::Abort) {
+            reset();
+            return;
+        }
+        if (action == DownloadPolicy::Discard) {
+            // Discard and try again
+            size -= file->received();
+            file->discard();
+            startFile(file);
+            return;
+        }
+        // Only what is known to be right is shared with other releases.
+        // This is done before the move, which a reader that is still extracting can hold up.
+        // The link is to the same file either way.
+        if (issue.isEmpty())
+            DownloadStore::add(file->app(), file->tempName());
+        // Pretend like that didn't happen. fileCompleted follows once it is in place.
+        if (!file->commit()) {
+            QString name = file->finalName();
+            reset();
+            reportError(QString("Could not move %1 into place.").arg(name));
+            return;
+        }
+        completedFile(file);
+    }
+
+    void fileFailed(QString error, bool cancelled) {
+        reset();
+        if (cancelled)
+            return; // User cancelled
+        reportError(error);
+    }
+
+    void fileRestricted() {
+        reset();
+        reportError("You are restricted from downloading this file.");
+    }
+
 private:
-    QFile _updateFile;
+    DownloadPolicy::Action decide(DownloadFile* file, const QString& issue) {
+        if (_policy.mismatch)
+            return _policy.mismatch(file->finalName(), issue);
+        qWarning() << issue;
+        return DownloadPolicy::Keep;
+    }
+
+    void reportError(const QString& error) {
+        if (_policy.error)
+            _policy.error(error);
+        else
+            qWarning() << "DL Error: " << error;
+    }
+
+    DownloadPolicy _policy;
     QNetworkAccessManager* _manager;
+    LinkVerifier* _verifier;
+    DeltaPlanner _planner;
+    QList<DownloadFile*> _files;
+    int _parallel;
+    bool _extractWhileDownloading;
+    bool _streamed;
 };
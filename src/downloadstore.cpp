@@ -0,0 +1,73 @@
+// Copyright (C) 2014 Sacha Refshauge
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 3.0.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 3.0 for more details.
+
+// A copy of the GPL 3.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official GIT repository and contact information can be found at
+// http://github.com/xsacha/Sachesi
+
+#include "downloadstore.h"
+#include "portscore.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+QString DownloadStore::path() {
+    return getSaveDir() + "/.store";
+}
+
+QString DownloadStore::key(const AppInfo& app) {
+    QString fileName = app.url.split('/').last();
+    // A patch is only good for the version it patches, which is in its name
+    if (!app.checksum.isEmpty() && !fileName.contains("+patch+"))
+        return app.checksum.toLower();
+    return QString("%1-%2").arg(app.size).arg(fileName);
+}
+
+bool DownloadStore::contains(const AppInfo& app) {
+    if (app.size <= 0)
+        return false;
+    return QFileInfo(storeName(app)).size() == app.size;
+}
+
+bool DownloadStore::hardLink(const QString& from, const QString& to) {
+#ifdef _WIN32
+    return CreateHardLinkW((LPCWSTR)QDir::toNativeSeparators(to).utf16(), (LPCWSTR)QDir::toNativeSeparators(from).utf16(), NULL) != 0;
+#else
+    return ::link(QFile::encodeName(from).constData(), QFile::encodeName(to).constData()) == 0;
+#endif
+}
+
+bool DownloadStore::linkInto(const Apps* app, const QString& target) {
+    if (!contains(app))
+        return false;
+    QDir().mkpath(QFileInfo(target).absolutePath());
+    QFile::remove(target);
+    // A store on another drive (or on FAT) can't be linked to, so copy instead
+    return hardLink(storeName(app), target) || QFile::copy(storeName(app), target);
+}
+
+bool DownloadStore::add(const Apps* app, const QString& file) {
+    if (contains(app))
+        return true;
+    if (app->size() <= 0 || QFileInfo(file).size() != app->size())
+        return false;
+    QDir().mkpath(path());
+    QFile::remove(storeName(app));
+    // Only ever a link, a second full copy of every download would be a waste
+    return hardLink(file, storeName(app));
+}
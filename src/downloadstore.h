@@ -0,0 +1,44 @@
+// Copyright (C) 2014 Sacha Refshauge
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 3.0.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 3.0 for more details.
+
+// A copy of the GPL 3.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official GIT repository and contact information can be found at
+// http://github.com/xsacha/Sachesi
+
+#pragma once
+
+#include <QString>
+#include "apps.h"
+
+// Every finished download is also kept in <save dir>/.store, named after its content.
+// The same app turns up in a lot of releases, so a release folder can be filled in
+// with hard links to the store instead of downloading it again.
+class DownloadStore {
+public:
+    static QString path();
+    // The checksum when the server gave one, otherwise the size and file name
+    static QString key(const AppInfo& app);
+    static QString key(const Apps* app) { return key(app->info()); }
+    static QString storeName(const AppInfo& app) { return path() + "/" + key(app); }
+    static QString storeName(const Apps* app) { return storeName(app->info()); }
+
+    static bool contains(const AppInfo& app);
+    static bool contains(const Apps* app) { return contains(app->info()); }
+    // Puts the stored copy at 'target'. Fails if it isn't in the store or can't be linked.
+    static bool linkInto(const Apps* app, const QString& target);
+    // Adds a finished download to the store, unless it is already there
+    static bool add(const Apps* app, const QString& file);
+
+private:
+    static bool hardLink(const QString& from, const QString& to);
+};
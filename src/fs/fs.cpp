@@ -37,6 +37,10 @@ QFileSystem::QFileSystem(QString filename, QIODevice* file, qint64 offset, qint6
     , _path(path)
     , _filename(filename)
     , _imageExt(imageExt)
+    , _sinkType(SinkDirectory)
+    , _sink(nullptr)
+    , _manifest(false)
+    , _nodes(nullptr)
 {
     if (_file == nullptr) {
         _file = new QFile(filename);
@@ -47,6 +51,7 @@ QFileSystem::QFileSystem(QString filename, QIODevice* file, qint64 offset, qint6
 
 // Free anything we made here
 QFileSystem::~QFileSystem() {
+    delete _nodes;
     // TODO: Better tracking of whether we created this?
     // Assume offset of 0 means we decided to let QFileSystem make it
     if (_offset == 0) {
@@ -56,18 +61,21 @@ QFileSystem::~QFileSystem() {
     }
 }
 
-// A method to append numbers to a filename/folder until it is unique
+// A method to append numbers to a filename/folder until it is unique in _path.
+// Contents streamed to an archive never make the folder, so the archive name is what has to be free.
 QString QFileSystem::uniqueDir(QString name) {
-    int counter = 0;
-    while (QDir(name + (counter++ > 0 ? QString::number(counter + 1) : "")).exists());
-
-    return name + (counter > 1 ? QString::number(counter) : "");
+    QDir base(_path);
+    QString candidate = name;
+    for (int counter = 2; base.exists(candidate) || QFileInfo::exists(base.filePath(QFileSink::outputPath(_sinkType, candidate))); counter++)
+        candidate = name + QString::number(counter);
+    return candidate;
 }
 QString QFileSystem::uniqueFile(QString name) {
-    int counter = 0;
-    while (QFile::exists(name + (counter++ > 0 ? QString::number(counter + 1) : "")));
-
-    return name + (counter > 1 ? QString::number(counter) : "");
+    QDir base(_path);
+    QString candidate = name;
+    for (int counter = 2; base.exists(candidate); counter++)
+        candidate = name + QString::number(counter);
+    return candidate;
 }
 
 // A generic method of working out new name based on old name
@@ -83,7 +91,11 @@ QString QFileSystem::generateName(QString imageExt) {
 bool QFileSystem::extractImage() {
     curSize = 0;
     maxSize = _size;
-    return this->createImage(this->generateName(_imageExt));
+    // An image is a single file, so it always goes straight to disk
+    if (!openSink(SinkDirectory))
+        return false;
+    bool ret = this->createImage(this->generateName(_imageExt));
+    return closeSink() && ret;
 }
 
 // A generic method for extracting an entire image of maxSize
@@ -96,27 +108,188 @@ bool QFileSystem::extractContents() {
     curSize = 0;
     maxSize = _size;
     _path += "/" + this->generateName();
-    return this->createContents();
+    if (!openSink(_sinkType))
+        return false;
+    bool ret = this->createContents();
+    if (!closeSink())
+        return false;
+    if (_manifest && !writeManifest())
+        return false;
+    return ret;
+}
+
+bool QFileSystem::openSink(QFileSinkType type) {
+    _manifestRoot = QDir(_path).absolutePath();
+    _manifestLines.clear();
+    _sink = QFileSink::create(type, _path);
+    return _sink->open();
+}
+
+bool QFileSystem::closeSink() {
+    bool ret = _sink->close();
+    delete _sink;
+    _sink = nullptr;
+    return ret;
+}
+
+bool QFileSystem::makeOutputDir(QString path, int time, quint16 mode) {
+    return _sink->mkdir(path, time, mode);
+}
+
+bool QFileSystem::openOutput(QString fileName, qint64 size, int time, quint16 mode) {
+    _outputName = fileName;
+    if (_manifest)
+        _manifestHash.reset();
+    return _sink->beginFile(fileName, size, time, mode);
+}
+
+bool QFileSystem::writeOutput(const char* data, qint64 len) {
+    if (_manifest)
+        _manifestHash.addData(data, len);
+    return _sink->write(data, len);
+}
+
+// Records the hash of the file that has just been written, relative to the extraction folder
+bool QFileSystem::closeOutput() {
+    if (_manifest) {
+        QString relName = QDir(_manifestRoot).relativeFilePath(QFileInfo(_outputName).absoluteFilePath());
+        // Same layout as sha256sum/xxh64sum so the manifest can be checked with those tools
+        _manifestLines.append(QString::fromLatin1(_manifestHash.result()) + "  " + relName);
+    }
+    return _sink->endFile();
+}
+
+// Ends a file that could not be written completely. An archive entry still has to be
+// closed for the ones after it to be readable; its size is whatever was written.
+void QFileSystem::abortOutput() {
+    _sink->endFile();
+}
+
+bool QFileSystem::linkOutput(QString path, QString target, int time) {
+    return _sink->symlink(path, target, time);
+}
+
+bool QFileSystem::writeManifest() {
+    QFile manifest(_manifestRoot + "." + QFileHash::extension(_manifestHash.algorithm()));
+    if (!manifest.open(QIODevice::WriteOnly | QIODevice::Text))
+        return false;
+    _manifestLines.sort();
+    foreach (QString line, _manifestLines)
+        manifest.write(line.toUtf8() + "\n");
+    manifest.close();
+    return true;
+}
+
+const QNodeTable* QFileSystem::nodeTable() {
+    if (_nodes == nullptr) {
+        QNodeTable* table = new QNodeTable();
+        if (!buildNodeTable(table)) {
+            delete table;
+            return nullptr;
+        }
+        table->squeeze();
+        _nodes = table;
+    }
+    return _nodes;
+}
+
+// Reads straight from the extents of a node. Filesystems with compressed nodes override this.
+qint64 QFileSystem::readNode(quint32 index, char* data, qint64 pos, qint64 len) {
+    const QNodeTable* table = nodeTable();
+    if (table == nullptr || index >= table->count())
+        return -1;
+    const QFileNode& node = table->node(index);
+    if (pos >= (qint64)node.size)
+        return 0;
+    len = qMin(len, (qint64)node.size - pos);
+
+    const QFileExtent* extents = table->extents(index);
+    qint64 done = 0, extentPos = 0;
+    for (quint32 e = 0; e < node.extentCount && done < len; e++) {
+        qint64 extentLen = (qint64)extents[e].count * table->blockSize();
+        if (pos + done < extentPos + extentLen) {
+            qint64 within = pos + done - extentPos;
+            qint64 part = qMin(extentLen - within, len - done);
+            _file->seek(_offset + (qint64)extents[e].start * table->blockSize() + within);
+            qint64 read = _file->read(data + done, part);
+            if (read <= 0)
+                break;
+            done += read;
+            if (read < part)
+                break;
+        }
+        extentPos += extentLen;
+    }
+    return done;
+}
+
+bool QFileSystem::extractNode(quint32 index, QString path) {
+    const QNodeTable* table = nodeTable();
+    if (table == nullptr || index >= table->count())
+        return false;
+    const QFileNode& node = table->node(index);
+    if (table->isDir(index)) {
+        if (!makeOutputDir(path, node.time, node.mode))
+            return false;
+        for (quint32 c = node.firstChild; c != NODE_NONE; c = table->node(c).nextSibling) {
+            if (!extractNode(c, path + "/" + table->name(c)))
+                return false;
+        }
+        return true;
+    }
+    if (table->isLink(index))
+        return linkOutput(path, readLink(index), node.time);
+
+    if (!openOutput(path, node.size, node.time, node.mode))
+        return false;
+    // Compressed nodes can hold less than they report. The sink keeps what there is.
+    bool compressed = node.mode & QCFM_IS_COMPRESSED;
+    QByteArray buffer(FAST_BUFFER_LEN, 0);
+    for (qint64 pos = 0; pos < (qint64)node.size;) {
+        qint64 read = readNode(index, buffer.data(), pos, buffer.size());
+        if (read == 0 && compressed)
+            break;
+        if (read <= 0 || !writeOutput(buffer.constData(), read)) {
+            abortOutput();
+            return false;
+        }
+        if (!compressed)
+            increaseCurSize(read);
+        pos += read;
+    }
+    // Progress is measured against the image, so compressed nodes count what they take up in it
+    if (compressed) {
+        const QFileExtent* extents = table->extents(index);
+        for (quint32 e = 0; e < node.extentCount; e++)
+            increaseCurSize((qint64)extents[e].count * table->blockSize());
+    }
+    return closeOutput();
+}
+
+QByteArray QFileSystem::readNodeData(quint32 index) {
+    const QNodeTable* table = nodeTable();
+    if (table == nullptr || index >= table->count())
+        return QByteArray();
+    QByteArray data((int)table->node(index).size, 0);
+    qint64 read = readNode(index, data.data(), 0, data.size());
+    data.truncate(qMax(read, (qint64)0));
+    return data;
 }
 
 // A method to write writeSize bytes from a QIODevice to a new file, named filename
-bool QFileSystem::writeFile(QString fileName, qint64 offset, qint64 writeSize, bool absolute) {
+bool QFileSystem::writeFile(QString fileName, qint64 offset, qint64 writeSize, bool absolute, int time, quint16 mode) {
     _file->seek(offset);
-    QFile newFile;
-    if (absolute)
-        newFile.setFileName(fileName);
-    else
-        newFile.setFileName(_path + "/" + fileName);
-    if (!newFile.open(QIODevice::WriteOnly))
+    if (!openOutput(absolute ? fileName : (_path + "/" + fileName), writeSize, time, mode))
         return false;
     qint64 endSize = curSize + writeSize;
     while (endSize > curSize) {
-        int diff = newFile.write(_file->read(qMin(BUFFER_LEN, endSize - curSize)));
-        if (diff <= 0)
+        QByteArray tmp = _file->read(qMin(BUFFER_LEN, endSize - curSize));
+        if (tmp.size() <= 0 || !writeOutput(tmp)) {
+            abortOutput();
             return false;
-        increaseCurSize(diff);
+        }
+        increaseCurSize(tmp.size());
     }
-    newFile.close();
 
-    return true;
+    return closeOutput();
 }
@@ -24,6 +24,9 @@
 #include <QDebug>
 #include <QDesktopServices>
 #include <QUrl>
+#include "hash.h"
+#include "sink.h"
+#include "nodetable.h"
 
 // node.mode flags
 #define QCFM_IS_COMPRESSED      ((1 << 22) | (1 << 23) | (1 << 24))
@@ -96,12 +99,26 @@ public:
     QString uniqueDir(QString name);
     QString uniqueFile(QString name);
     virtual QString generateName(QString imageExt = "");
-    bool writeFile(QString fileName, qint64 offset, qint64 writeSize, bool absolute = false);
+    bool writeFile(QString fileName, qint64 offset, qint64 writeSize, bool absolute = false, int time = 0, quint16 mode = 0644);
     bool extractImage();
     virtual bool createImage(QString name);
     bool extractContents();
     virtual bool createContents() = 0;
 
+    // Hash each file as it is extracted and write <dir>.<algorithm> next to the extracted folder
+    void setManifest(QFileHash::Algorithm algorithm) {
+        _manifest = true;
+        _manifestHash.setAlgorithm(algorithm);
+    }
+    // Extract contents to a folder (default), or stream them in to a single <dir>.tar or <dir>.zip
+    void setSinkType(QFileSinkType type) { _sinkType = type; }
+
+    // Compact index of the whole tree, built on first use. Null if the image can't be read.
+    const QNodeTable* nodeTable();
+    // Random access to nodes of nodeTable() without extracting anything
+    virtual qint64 readNode(quint32 index, char* data, qint64 pos, qint64 len);
+    virtual QString readLink(quint32 index) { Q_UNUSED(index); return QString(); }
+
     qint64 curSize;
     qint64 maxSize;
 
@@ -109,8 +126,37 @@ signals:
     void sizeChanged(qint64 delta);
 
 protected:
+    // Every extracted file should go through these so that it ends up in the right sink and manifest
+    bool makeOutputDir(QString path, int time = 0, quint16 mode = 0755);
+    bool openOutput(QString fileName, qint64 size, int time = 0, quint16 mode = 0644);
+    bool writeOutput(const char* data, qint64 len);
+    bool writeOutput(const QByteArray& data) { return writeOutput(data.constData(), data.size()); }
+    bool closeOutput();
+    void abortOutput();
+    bool linkOutput(QString path, QString target, int time = 0);
+    virtual bool buildNodeTable(QNodeTable* table) { Q_UNUSED(table); return false; }
+    // Extracts a node of nodeTable() and everything below it to path, through the sink.
+    // Stops at the first file that can't be written.
+    bool extractNode(quint32 index, QString path);
+    // The whole data of a node of nodeTable(). Only for small files such as manifests.
+    QByteArray readNodeData(quint32 index);
+
     QIODevice* _file;
     qint64 _offset, _size;
     QString _path, _filename;
     QString _imageExt;
+
+private:
+    bool openSink(QFileSinkType type);
+    bool closeSink();
+    bool writeManifest();
+
+    QFileSinkType _sinkType;
+    QFileSink* _sink;
+    QString _outputName;
+    bool _manifest;
+    QFileHash _manifestHash;
+    QString _manifestRoot;
+    QStringList _manifestLines;
+    QNodeTable* _nodes;
 };
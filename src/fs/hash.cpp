@@ -0,0 +1,131 @@
+// Copyright (C) 2014 Sacha Refshauge
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 3.0.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 3.0 for more details.
+
+// A copy of the GPL 3.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official GIT repository and contact information can be found at
+// http://github.com/xsacha/Sachesi
+
+#include "hash.h"
+#include <QtEndian>
+#include <string.h>
+
+// XXH64 constants and helpers. Output matches xxh64sum.
+static const quint64 PRIME64_1 = 0x9E3779B185EBCA87ULL;
+static const quint64 PRIME64_2 = 0xC2B2AE3D27D4EB4FULL;
+static const quint64 PRIME64_3 = 0x165667B19E3779F9ULL;
+static const quint64 PRIME64_4 = 0x85EBCA77C2B2AE63ULL;
+static const quint64 PRIME64_5 = 0x27D4EB2F165667C5ULL;
+
+static inline quint64 rotl64(quint64 x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+static inline quint64 xxhAccumulate(quint64 acc, quint64 input) {
+    acc += input * PRIME64_2;
+    acc = rotl64(acc, 31);
+    return acc * PRIME64_1;
+}
+static inline quint64 xxhMerge(quint64 acc, quint64 val) {
+    acc ^= xxhAccumulate(0, val);
+    return acc * PRIME64_1 + PRIME64_4;
+}
+
+QFileHash::QFileHash(Algorithm algorithm)
+    : _algorithm(algorithm)
+    , _sha(QCryptographicHash::Sha256)
+{
+    reset();
+}
+
+void QFileHash::reset() {
+    _sha.reset();
+    _acc[0] = PRIME64_1 + PRIME64_2;
+    _acc[1] = PRIME64_2;
+    _acc[2] = 0;
+    _acc[3] = 0 - PRIME64_1;
+    _total = 0;
+    _memSize = 0;
+}
+
+void QFileHash::xxhRound(const unsigned char* stripe) {
+    for (int i = 0; i < 4; i++)
+        _acc[i] = xxhAccumulate(_acc[i], qFromLittleEndian<quint64>(stripe + i * 8));
+}
+
+void QFileHash::addData(const char* data, qint64 len) {
+    if (len <= 0)
+        return;
+    if (_algorithm == Sha256) {
+        _sha.addData(data, len);
+        return;
+    }
+
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(data);
+    const unsigned char* end = p + len;
+    _total += len;
+
+    // Finish off a stripe left over from the previous call
+    if (_memSize > 0) {
+        int fill = qMin((qint64)(32 - _memSize), len);
+        memcpy(_mem + _memSize, p, fill);
+        _memSize += fill;
+        p += fill;
+        if (_memSize < 32)
+            return;
+        xxhRound(_mem);
+        _memSize = 0;
+    }
+    for (; p + 32 <= end; p += 32)
+        xxhRound(p);
+    if (p < end) {
+        _memSize = end - p;
+        memcpy(_mem, p, _memSize);
+    }
+}
+
+QByteArray QFileHash::result() {
+    if (_algorithm == Sha256)
+        return _sha.result().toHex();
+
+    quint64 h;
+    if (_total >= 32) {
+        h = rotl64(_acc[0], 1) + rotl64(_acc[1], 7) + rotl64(_acc[2], 12) + rotl64(_acc[3], 18);
+        for (int i = 0; i < 4; i++)
+            h = xxhMerge(h, _acc[i]);
+    } else {
+        h = _acc[2] + PRIME64_5;
+    }
+    h += _total;
+
+    const unsigned char* p = _mem;
+    const unsigned char* end = _mem + _memSize;
+    for (; p + 8 <= end; p += 8) {
+        h ^= xxhAccumulate(0, qFromLittleEndian<quint64>(p));
+        h = rotl64(h, 27) * PRIME64_1 + PRIME64_4;
+    }
+    if (p + 4 <= end) {
+        h ^= (quint64)qFromLittleEndian<quint32>(p) * PRIME64_1;
+        h = rotl64(h, 23) * PRIME64_2 + PRIME64_3;
+        p += 4;
+    }
+    for (; p < end; p++) {
+        h ^= (*p) * PRIME64_5;
+        h = rotl64(h, 11) * PRIME64_1;
+    }
+    h ^= h >> 33;
+    h *= PRIME64_2;
+    h ^= h >> 29;
+    h *= PRIME64_3;
+    h ^= h >> 32;
+
+    return QByteArray::number(h, 16).rightJustified(16, '0');
+}
@@ -0,0 +1,56 @@
+// Copyright (C) 2014 Sacha Refshauge
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 3.0.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 3.0 for more details.
+
+// A copy of the GPL 3.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official GIT repository and contact information can be found at
+// http://github.com/xsacha/Sachesi
+
+#pragma once
+
+#include <QByteArray>
+#include <QString>
+#include <QCryptographicHash>
+
+// Incremental hash used while bytes are passing through to disk.
+// XXH64 is the default as it is far cheaper than the write itself.
+class QFileHash {
+public:
+    enum Algorithm {
+        XXH64 = 0,
+        Sha256 = 1,
+    };
+
+    explicit QFileHash(Algorithm algorithm = XXH64);
+
+    void setAlgorithm(Algorithm algorithm) { _algorithm = algorithm; reset(); }
+    void reset();
+    void addData(const char* data, qint64 len);
+    void addData(const QByteArray& data) { addData(data.constData(), data.size()); }
+    QByteArray result();
+
+    Algorithm algorithm() const { return _algorithm; }
+    static QString extension(Algorithm algorithm) {
+        return algorithm == Sha256 ? "sha256" : "xxh64";
+    }
+
+private:
+    void xxhRound(const unsigned char* stripe);
+
+    Algorithm _algorithm;
+    QCryptographicHash _sha;
+    // XXH64 state
+    quint64 _acc[4];
+    quint64 _total;
+    unsigned char _mem[32];
+    int _memSize;
+};
@@ -97,7 +97,8 @@ void IFS::extractDir(int offset, int numNodes, QString basedir, qint64 startPos)
     }*/
 }
 
-bool IFS::createContents() {
+// Finds where startup and imagefs begin. boot.bin ends where startup begins.
+bool IFS::findComponents(qint32* bootSize, qint32* startupSize) {
     QNXStream stream(_file);
     _file->seek(_offset + 1);
     qint8 type;
@@ -129,20 +130,35 @@ bool IFS::createContents() {
     stream >> startup_size;
     // imagefs @ boot_size + startup_size
     //extractBootDir(0xC, 1, _path, _offset + boot_size + startup_size);
+    *bootSize = boot_size;
+    *startupSize = startup_size;
+    return true;
+}
 
-
+bool IFS::createContents() {
     // Temporarily dump the components until a full extraction is available
-    QDir(_path).mkpath(".");
-    // -- Dump boot.bin --
-    if (boot_size > 0x1100) // Does it have a boot.bin? Some speciality images don't and start at 0x1008
-        QFileSystem::writeFile("boot.bin", _offset + 0x1100, boot_size - 0x1100);
-    // -- Dump startup.bin
-    QFileSystem::writeFile("startup.bin", _offset + boot_size + 0x100, startup_size - 0x100);
-    // -- Dump imagefs.bin
-    QFileSystem::writeFile("imagefs.bin", _offset + boot_size + startup_size, maxSize - boot_size - startup_size);
+    if (!extractNode(0, _path))
+        return false;
 
     // Display result
     QDesktopServices::openUrl(QUrl(_path));
     return true;
 }
+
+// The same three components that createContents dumps
+bool IFS::buildNodeTable(QNodeTable* table) {
+    qint32 boot_size, startup_size;
+    if (!findComponents(&boot_size, &startup_size))
+        return false;
+    table->addNode(NODE_NONE, "", 0, 0, 040755);
+    if (boot_size > 0x1100) {
+        table->addNode(0, "boot.bin", boot_size - 0x1100, 0, 0100644);
+        table->addExtent(0x1100, boot_size - 0x1100);
+    }
+    table->addNode(0, "startup.bin", startup_size - 0x100, 0, 0100644);
+    table->addExtent(boot_size + 0x100, startup_size - 0x100);
+    table->addNode(0, "imagefs.bin", _size - boot_size - startup_size, 0, 0100644);
+    table->addExtent(boot_size + startup_size, _size - boot_size - startup_size);
+    return true;
+}
 }
@@ -45,5 +45,10 @@ public:
     void extractDir(int offset, int numNodes, QString basedir, qint64 startPos);
     bool createContents();
 
+protected:
+    bool buildNodeTable(QNodeTable* table);
+
+private:
+    bool findComponents(qint32* bootSize, qint32* startupSize);
 };
 }
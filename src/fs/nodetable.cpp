@@ -0,0 +1,158 @@
+// Copyright (C) 2014 Sacha Refshauge
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 3.0.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 3.0 for more details.
+
+// A copy of the GPL 3.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official GIT repository and contact information can be found at
+// http://github.com/xsacha/Sachesi
+
+#include "nodetable.h"
+#include "fs.h"
+#include <QStringList>
+
+quint32 QNodeTable::intern(const QByteArray& name) {
+    QHash<QByteArray, quint32>::const_iterator it = _interned.constFind(name);
+    if (it != _interned.constEnd())
+        return it.value();
+    quint32 offset = _names.size();
+    _names.append(name);
+    _names.append('\0');
+    _interned.insert(name, offset);
+    return offset;
+}
+
+quint32 QNodeTable::addNode(quint32 parent, const QByteArray& name, quint64 size, quint32 time, quint32 mode, quint32 source) {
+    QFileNode node;
+    node.parent = parent;
+    node.name = intern(name);
+    node.firstChild = NODE_NONE;
+    node.nextSibling = NODE_NONE;
+    node.firstExtent = _extents.count();
+    node.extentCount = 0;
+    node.time = time;
+    node.mode = mode;
+    node.source = source;
+    node.size = size;
+
+    quint32 index = _nodes.count();
+    _nodes.append(node);
+    _lastChild.append(NODE_NONE);
+    // Keep children in the order they were found
+    if (parent != NODE_NONE) {
+        if (_lastChild[parent] == NODE_NONE)
+            _nodes[parent].firstChild = index;
+        else
+            _nodes[_lastChild[parent]].nextSibling = index;
+        _lastChild[parent] = index;
+    }
+    return index;
+}
+
+void QNodeTable::addExtent(quint32 start, quint32 count) {
+    QFileNode& node = _nodes.last();
+    if (node.extentCount > 0) {
+        QFileExtent& last = _extents.last();
+        // Consecutive blocks only grow the current run
+        if (start == last.start + last.count && last.count + count > last.count) {
+            last.count += count;
+            return;
+        }
+    }
+    QFileExtent extent;
+    extent.start = start;
+    extent.count = count;
+    _extents.append(extent);
+    node.extentCount++;
+}
+
+quint64 QNodeTable::childKey(quint32 parent, const char* name) {
+    return ((quint64)parent << 32) | qHash(QByteArray::fromRawData(name, qstrlen(name)));
+}
+
+void QNodeTable::squeeze() {
+    _interned.clear();
+    _lastChild.clear();
+    _lastChild.squeeze();
+    _nodes.squeeze();
+    _extents.squeeze();
+    _names.squeeze();
+    _childIndex.clear();
+    _childIndex.reserve(_nodes.count());
+    for (quint32 i = 1; i < (quint32)_nodes.count(); i++) {
+        const QFileNode& node = _nodes.at(i);
+        if (node.parent != NODE_NONE)
+            _childIndex.insert(childKey(node.parent, _names.constData() + node.name), i);
+    }
+}
+
+bool QNodeTable::isDir(quint32 index) const {
+    return _nodes.at(index).mode & QCFM_IS_DIRECTORY;
+}
+
+bool QNodeTable::isLink(quint32 index) const {
+    return !isDir(index) && (_nodes.at(index).mode & QCFM_IS_SYMLINK);
+}
+
+QString QNodeTable::name(quint32 index) const {
+    return QString::fromUtf8(_names.constData() + _nodes.at(index).name);
+}
+
+QString QNodeTable::path(quint32 index) const {
+    QStringList parts;
+    for (; index != NODE_NONE && _nodes.at(index).parent != NODE_NONE; index = _nodes.at(index).parent)
+        parts.prepend(name(index));
+    return parts.join("/");
+}
+
+QList<quint32> QNodeTable::children(quint32 index) const {
+    QList<quint32> list;
+    for (quint32 c = _nodes.at(index).firstChild; c != NODE_NONE; c = _nodes.at(c).nextSibling)
+        list.append(c);
+    return list;
+}
+
+quint32 QNodeTable::child(quint32 index, const QString& name) const {
+    QByteArray search = name.toUtf8();
+    if (!_childIndex.isEmpty()) {
+        quint64 key = childKey(index, search.constData());
+        for (QMultiHash<quint64, quint32>::const_iterator it = _childIndex.constFind(key); it != _childIndex.constEnd() && it.key() == key; ++it) {
+            if (qstrcmp(_names.constData() + _nodes.at(it.value()).name, search.constData()) == 0)
+                return it.value();
+        }
+        return NODE_NONE;
+    }
+    // Not squeezed yet
+    for (quint32 c = _nodes.at(index).firstChild; c != NODE_NONE; c = _nodes.at(c).nextSibling) {
+        if (qstrcmp(_names.constData() + _nodes.at(c).name, search.constData()) == 0)
+            return c;
+    }
+    return NODE_NONE;
+}
+
+quint32 QNodeTable::find(const QString& path) const {
+    if (_nodes.isEmpty())
+        return NODE_NONE;
+    quint32 index = 0;
+    foreach (QString part, path.split('/', QString::SkipEmptyParts)) {
+        index = child(index, part);
+        if (index == NODE_NONE)
+            break;
+    }
+    return index;
+}
+
+qint64 QNodeTable::memoryUsage() const {
+    return (qint64)_nodes.capacity() * sizeof(QFileNode)
+         + (qint64)_extents.capacity() * sizeof(QFileExtent)
+         + _names.capacity()
+         + (qint64)_childIndex.capacity() * (sizeof(quint64) + sizeof(quint32) + 2 * sizeof(void*));
+}
@@ -0,0 +1,95 @@
+// Copyright (C) 2014 Sacha Refshauge
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 3.0.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 3.0 for more details.
+
+// A copy of the GPL 3.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official GIT repository and contact information can be found at
+// http://github.com/xsacha/Sachesi
+
+#pragma once
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+#include <QHash>
+#include <QList>
+
+// No parent / no child / not found
+#define NODE_NONE 0xFFFFFFFF
+
+// A run of consecutive blocks, relative to the start of the filesystem
+struct QFileExtent {
+    quint32 start;
+    quint32 count;
+};
+
+// One file, directory or symlink. Everything is an index in to the owning QNodeTable.
+struct QFileNode {
+    quint32 parent;
+    quint32 name;        // Offset in to the name arena
+    quint32 firstChild;
+    quint32 nextSibling;
+    quint32 firstExtent;
+    quint32 extentCount;
+    quint32 time;
+    quint32 mode;        // As found in the image, including QCFM_* flags
+    quint32 source;      // Filesystem specific reference (QNX6 node number, RCFS node offset)
+    quint64 size;
+};
+
+// Flat description of a whole filesystem tree, shared by QNX6, RCFS and IFS.
+// Names are interned in a single arena and data is kept as extents rather than
+// sector lists, so a full OS tree costs a few MB. Node 0 is the root.
+class QNodeTable {
+public:
+    explicit QNodeTable(quint32 blockSize = 1)
+        : _blockSize(blockSize) {}
+
+    // Nodes are added parent first. Extents always belong to the last added node.
+    quint32 addNode(quint32 parent, const QByteArray& name, quint64 size, quint32 time, quint32 mode, quint32 source = 0);
+    void addExtent(quint32 start, quint32 count = 1);
+    // Drops everything only needed while building and indexes children by name
+    void squeeze();
+
+    void setBlockSize(quint32 blockSize) { _blockSize = blockSize; }
+    quint32 blockSize() const { return _blockSize; }
+    quint32 count() const { return _nodes.count(); }
+    const QFileNode& node(quint32 index) const { return _nodes.at(index); }
+    const QFileExtent* extents(quint32 index) const { return _extents.constData() + _nodes.at(index).firstExtent; }
+
+    bool isDir(quint32 index) const;
+    bool isLink(quint32 index) const;
+    QString name(quint32 index) const;
+    // Path relative to the root, without a leading slash
+    QString path(quint32 index) const;
+    QList<quint32> children(quint32 index) const;
+    quint32 child(quint32 index, const QString& name) const;
+    // Walks a '/' separated path from the root
+    quint32 find(const QString& path) const;
+
+    qint64 memoryUsage() const;
+
+private:
+    quint32 intern(const QByteArray& name);
+    static quint64 childKey(quint32 parent, const char* name);
+
+    quint32 _blockSize;
+    QVector<QFileNode> _nodes;
+    QVector<QFileExtent> _extents;
+    QByteArray _names;
+    // Only used while building
+    QHash<QByteArray, quint32> _interned;
+    QVector<quint32> _lastChild;
+    // Hash of parent and name to node, so a lookup doesn't walk every sibling.
+    // Hashes can collide, so names are still compared.
+    QMultiHash<quint64, quint32> _childIndex;
+};
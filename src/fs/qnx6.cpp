@@ -16,6 +16,12 @@
 // http://github.com/xsacha/Sachesi
 
 #include "qnx6.h"
+#include <QDateTime>
+#include <QThreadPool>
+#include <QRunnable>
+#include <QAtomicInt>
+#include <QtEndian>
+#include <string.h>
 
 namespace FS {
 
@@ -90,231 +96,152 @@ QPair<int, QString> QNX6::nodeInfo(QNXStream* stream, qint64 offset) {
     return ret;
 }
 
-// Specialised function which takes a directory and finds META-INF/MANIFEST.MF and grabs its data
-void QNX6::extractManifest(int nodenum) {
+// Expands the direct or tier 1/2 indirect pointers of a node in to the list of data sectors
+QList<int> QNX6::dataSectors(const qinode& ind) {
     QNXStream stream(_file);
-    foreach(int num, createNode(nodenum).sectors)
-    {
-        for (int i = 0; i < 0x1000; i += 0x20)
-        {
-            QPair<int, QString> info = nodeInfo(&stream, findSector(num) + i);
-            if (info.second == "META-INF") {
-                foreach(int num, createNode(info.first).sectors)
-                {
-                    for (int i = 0; i < 0x1000; i += 0x20) {
-                        info = nodeInfo(&stream, findSector(num) + i);
-                        if (info.second == "MANIFEST.MF") {
-                            qinode ind = createNode(info.first);
-                            QList<int> sections;
-                            if (ind.tiers == 0 && (ind.sectors[0] > 0)) {
-                                foreach(int sector, ind.sectors) {
-                                    if (sector != -1)
-                                        sections.append(sector);
-                                }
-                            } else if (ind.tiers > 0 ) {
-                                foreach (int sector, ind.sectors) {
-                                    if (sector == -1) break;
-                                    _file->seek(findSector(sector));
-                                    for (int j = 0; j < 0x400; j++)
-                                    {
-                                        stream >> sector;
-                                        if (sector > 0)
-                                            sections.append(sector);
-                                    }
-                                }
-                                if (ind.tiers == 2) {
-                                    QList<int> nodes = sections;
-                                    sections.clear();
-                                    foreach (int fn, nodes) {
-                                        if (fn == -1) break;
-                                        _file->seek(findSector(fn));
-                                        for (int tmpx = 0; tmpx < 1024; tmpx++) {
-                                            stream >> fn;
-                                            if (fn > 0) sections.append(fn);
-                                        }
-                                    }
-                                }
-                            }
-                            QByteArray manifestDump;
-                            if (ind.size != 0) {
-                                foreach(int section, sections)
-                                {
-                                    _file->seek(findSector(section));
-                                    int len = sectorSize;
-                                    if (section == sections.last() && (ind.size % sectorSize))
-                                        len = ind.size % sectorSize;
-                                    manifestDump.append(_file->read(len));
-                                }
-                            }
-
-                            QString name = "";
-                            QString version = "";
-                            QString arch = "";
-                            QString strSigned = "";
-                            foreach(QByteArray manifestString, manifestDump.split('\n')) {
-                                QString tmp = QString(manifestString).simplified();
-                                if (tmp.startsWith("Package-Name:")) {
-                                    name = tmp.split(": ").last().split('.').last();
-                                }
-                                else if (tmp.startsWith("Package-Version:")) {
-                                    version = tmp.split(": ").last();
-                                }
-                                else if (tmp.startsWith("Package-Architecture:")) {
-                                    arch = tmp.split(": ").last();
-                                }
-                                else if (tmp.startsWith("Package-Author-Certificate-Hash:")) {
-                                    strSigned = "+signed";
-                                }
-                                else if (tmp.startsWith("Archive-Asset-Name:")) {
-                                    manifestApps.append(tmp.split(": ").last());
-                                }
-                            }
-                            if (currentZip == nullptr && name != "") {
-                                currentZip = new QuaZip(QString("%1/%2-%3-nto+%4%5.bar").arg(_path).arg(name).arg(version).arg(arch).arg(strSigned));
-                                emit currentNameChanged(QString("%1-%2").arg(name).arg(version));
-                                currentZip->open(QuaZip::mdCreate);
-                            }
-                            // Leave now
-                            return;
-                        }
-                    }
+    QList<int> sections;
+    if (ind.tiers == 0 && (ind.sectors[0] > 0)) {
+        foreach(int sector, ind.sectors) {
+            if (sector != -1)
+                sections.append(sector);
+        }
+    } else if (ind.tiers > 0) {
+        foreach (int sector, ind.sectors) {
+            if (sector == -1) break;
+            _file->seek(findSector(sector));
+            for (int j = 0; j < sectorSize / 4; j++)
+            {
+                stream >> sector;
+                if (sector > 0)
+                    sections.append(sector);
+            }
+        }
+        if (ind.tiers == 2) {
+            QList<int> nodes = sections;
+            sections.clear();
+            foreach (int fn, nodes) {
+                if (fn == -1) break;
+                _file->seek(findSector(fn));
+                for (int j = 0; j < sectorSize / 4; j++) {
+                    stream >> fn;
+                    if (fn > 0)
+                        sections.append(fn);
                 }
-                return;
             }
         }
     }
+    return sections;
 }
 
-void QNX6::extractDir(int nodenum, QString basedir, int tier)
-{
-    QDir mainDir;
-    if (!extractApps)
-        mainDir.mkdir(basedir);
+// Reads META-INF/MANIFEST.MF of an app folder and opens the .bar it is packed back in to.
+// False if there is no manifest or it has no package name.
+bool QNX6::openAppBar(const QNodeTable* table, quint32 app) {
+    manifestApps.clear();
+    quint32 metaInf = table->child(app, "META-INF");
+    quint32 manifest = (metaInf == NODE_NONE) ? NODE_NONE : table->child(metaInf, "MANIFEST.MF");
+    if (manifest == NODE_NONE)
+        return false;
 
-    QNXStream stream(_file);
-    qinode ind = createNode(nodenum);
-    foreach(int num, ind.sectors)
-    {
-        for (int i = 0; i < 0x80; i++)
-        {
-            // TODO: Nice place to check if we want to quit
-            QPair<int, QString> info = nodeInfo(&stream, findSector(num) + (i * 0x20));
-            if (info.second == "." || info.second == "..")
-                continue;
+    QString name = "";
+    QString version = "";
+    QString arch = "";
+    QString strSigned = "";
+    foreach(QByteArray manifestString, readNodeData(manifest).split('\n')) {
+        QString tmp = QString(manifestString).simplified();
+        if (tmp.startsWith("Package-Name:")) {
+            name = tmp.split(": ").last().split('.').last();
+        }
+        else if (tmp.startsWith("Package-Version:")) {
+            version = tmp.split(": ").last();
+        }
+        else if (tmp.startsWith("Package-Architecture:")) {
+            arch = tmp.split(": ").last();
+        }
+        else if (tmp.startsWith("Package-Author-Certificate-Hash:")) {
+            strSigned = "+signed";
+        }
+        else if (tmp.startsWith("Archive-Asset-Name:")) {
+            manifestApps.append(tmp.split(": ").last());
+        }
+    }
+    if (name == "")
+        return false;
+    currentZip = new QuaZip(QString("%1/%2-%3-nto+%4%5.bar").arg(_path).arg(name).arg(version).arg(arch).arg(strSigned));
+    emit currentNameChanged(QString("%1-%2").arg(name).arg(version));
+    return currentZip->open(QuaZip::mdCreate);
+}
 
-            qinode ind2 = createNode(info.first);
+// Adds the files of an app folder to currentZip. Anything that isn't an asset in the
+// manifest is left out, apart from META-INF itself.
+bool QNX6::zipAppDir(const QNodeTable* table, quint32 dir, QString prefix, bool inMetaInf) {
+    QByteArray buffer(FAST_BUFFER_LEN, 0);
+    foreach (quint32 child, table->children(dir)) {
+        QString relName = prefix + table->name(child);
+        if (table->isDir(child)) {
+            if (!zipAppDir(table, child, relName + "/", prefix.isEmpty() && relName == "META-INF"))
+                return false;
+            continue;
+        }
+        if (!manifestApps.isEmpty() && !inMetaInf && !manifestApps.contains(relName))
+            continue;
 
-            if (ind2.perms & QCFM_IS_DIRECTORY)
-            {
-                if (extractApps) {
-                    if (info.second == "apps" && tier == 0) {
-                        mainDir.mkdir(basedir);
-                        extractDir(info.first, basedir, 1);
-                        continue;
-                    }
-                    else if (tier == 1) {
-                        currentZip = nullptr;
-                        extractManifest(info.first);
-                        if (currentZip != nullptr) {
-                            extractDir(info.first, "", 2);
-                            currentZip->close();
-                            manifestApps.clear();
-                            delete currentZip;
-                        }
-                        continue;
-                    } else if (tier == 2) {
-                        extractDir(info.first, info.second, 3);
-                        continue;
-                    }
-                }
-                extractDir(info.first, basedir + "/" + info.second, tier ? tier + 1 : 0);
-                continue;
-            }
-            if (extractApps) {
-                if (tier <= 1)
-                    continue;
-                QString thisFile = (tier == 2) ? info.second : (basedir + "/" + info.second);
-                if (!manifestApps.isEmpty() && !(tier == 3 && basedir == "META-INF") && !manifestApps.contains(thisFile))
-                    continue;
-            }
-            QList<int> sections;
-            if (ind2.tiers == 0 && (ind2.sectors[0] > 0)) {
-                foreach(int sector, ind2.sectors) {
-                    if (sector != -1)
-                        sections.append(sector);
-                }
-            } else if (ind2.tiers > 0 ) {
-                foreach (int sector, ind2.sectors) {
-                    if (sector == -1) break;
-                    _file->seek(findSector(sector));
-                    for (int j = 0; j < 0x400; j++)
-                    {
-                        stream >> sector;
-                        if (sector > 0)
-                            sections.append(sector);
-                    }
-                }
-                if (ind2.tiers == 2) {
-                    QList<int> nodes = sections;
-                    sections.clear();
-                    foreach (int fn, nodes) {
-                        if (fn == -1) break;
-                        _file->seek(findSector(fn));
-                        for (int tmpx = 0; tmpx < 1024; tmpx++) {
-                            stream >> fn;
-                            if (fn > 0)
-                                sections.append(fn);
-                        }
-                    }
-                }
+        const QFileNode& node = table->node(child);
+        QuaZipFile zipFile(currentZip);
+        QuaZipNewInfo newInfo(relName);
+        newInfo.setPermissions(QFileDevice::Permission(0x7774));
+        newInfo.dateTime.setTime_t(node.time);
+        if (!zipFile.open(QIODevice::WriteOnly, newInfo))
+            return false;
+        for (qint64 pos = 0; pos < (qint64)node.size;) {
+            qint64 read = readNode(child, buffer.data(), pos, buffer.size());
+            if (read <= 0 || zipFile.write(buffer.constData(), read) != read) {
+                zipFile.close();
+                return false;
             }
+            increaseCurSize(read);
+            pos += read;
+        }
+        zipFile.close();
+        if (zipFile.getZipError() != 0)
+            return false;
+    }
+    return true;
+}
 
-            QuaZipFile* zipFile = 0;
-            QFile* newFile = 0;
-            if (extractApps)
-            {
-                Q_ASSERT(currentZip != nullptr);
-                zipFile = new QuaZipFile(currentZip);
-                QuaZipNewInfo newInfo((tier == 2) ? info.second : (basedir + "/" + info.second));
-                newInfo.setPermissions(QFileDevice::Permission(0x7774));
-                newInfo.dateTime.setTime_t(ind.time);
-                zipFile->open(QIODevice::WriteOnly, newInfo);
-            } else {
-                newFile = new QFile(basedir + "/" + info.second);
-                newFile->open(QIODevice::WriteOnly);
-            }
-            if (ind2.size != 0) {
-                foreach(int section, sections)
-                {
-                    _file->seek(findSector(section));
-                    int len = sectorSize;
-                    if (section == sections.last() && (ind2.size % sectorSize))
-                        len = ind2.size % sectorSize;
-                    QByteArray tmp = _file->read(len);
-                    increaseCurSize(tmp.size());
-                    if (extractApps)
-                        zipFile->write(tmp);
-                    else
-                        newFile->write(tmp);
-                }
-            }
-            if (extractApps) {
-                Q_ASSERT(zipFile->isOpen());
-                zipFile->close();
-                delete zipFile;
-            }
-            else {
-                newFile->close();
-#ifdef _WIN32
-                fixFileTime(newFile->fileName(), ind.time);
-#endif
-                delete newFile;
+// Every folder called apps, outside of the apps themselves, has one folder per app. Each is packed in to a .bar.
+bool QNX6::extractAppBars(const QNodeTable* table, quint32 dir) {
+    foreach (quint32 child, table->children(dir)) {
+        if (!table->isDir(child))
+            continue;
+        if (table->name(child) != "apps") {
+            if (!extractAppBars(table, child))
+                return false;
+            continue;
+        }
+        foreach (quint32 app, table->children(child)) {
+            if (!table->isDir(app))
+                continue;
+            bool ok = true;
+            if (openAppBar(table, app))
+                ok = zipAppDir(table, app, "", false);
+            if (currentZip != nullptr) {
+                currentZip->close();
+                delete currentZip;
+                currentZip = nullptr;
             }
+            manifestApps.clear();
+            if (!ok)
+                return false;
         }
     }
+    return true;
 }
 
-bool QNX6::createContents() {
+// Finds the superblock, sector offset and long filename table. Required before reading any nodes.
+bool QNX6::readSuperblock() {
+    // This moves _offset to the first sector, so only do it once
+    if (_superblockRead)
+        return true;
     _file->seek(_offset+8);
     QNXStream stream(_file);
     READ_TMP(unsigned char, typeQNX); // 0x10 = no offset; 0x08 = has offset
@@ -348,6 +275,7 @@ bool QNX6::createContents() {
         }
     }
 
+    lfn.clear();
     for (qint64 s = _offset - 0xF10; true; s+=4)
     {
         _file->seek(s);
@@ -360,11 +288,437 @@ bool QNX6::createContents() {
                 lfn.append(next);
         }
     }
-    extractDir(1, _path, 0);
+    _superblockRead = true;
+    return true;
+}
+
+bool QNX6::createContents() {
+    const QNodeTable* table = nodeTable();
+    if (table == nullptr)
+        return false;
+    bool ret;
+    if (extractApps) {
+        QDir().mkpath(_path);
+        ret = extractAppBars(table, 0);
+    } else
+        ret = extractNode(0, _path);
     emit currentNameChanged("");
+    if (!ret)
+        return false;
     QDesktopServices::openUrl(QUrl(_path));
     return true;
 }
 
+// -- Node table, for random access without extracting --
+
+QList<QPair<int, QString> > QNX6::readDir(int nodenum) {
+    QNXStream stream(_file);
+    QList<QPair<int, QString> > entries;
+    foreach (int sector, dataSectors(createNode(nodenum))) {
+        for (int i = 0; i < sectorSize; i += 0x20) {
+            QPair<int, QString> info = nodeInfo(&stream, findSector(sector) + i);
+            if (info.first == 0 || info.second == "." || info.second == "..")
+                continue;
+            entries.append(info);
+        }
+    }
+    return entries;
+}
+
+bool QNX6::buildNodeTable(QNodeTable* table) {
+    if (!readSuperblock())
+        return false;
+    table->setBlockSize(sectorSize);
+    qinode root = createNode(1);
+    table->addNode(NODE_NONE, "", root.size, root.time, root.perms, 1);
+    addTableDir(table, 0, 1);
+    return true;
+}
+
+void QNX6::addTableDir(QNodeTable* table, quint32 parent, int nodenum) {
+    QList<QPair<quint32, int> > dirs;
+    typedef QPair<int, QString> NodeName;
+    foreach (NodeName info, readDir(nodenum)) {
+        qinode ind = createNode(info.first);
+        quint32 index = table->addNode(parent, info.second.toUtf8(), ind.size, ind.time, ind.perms, info.first);
+        if (ind.perms & QCFM_IS_DIRECTORY) {
+            dirs.append(qMakePair(index, info.first));
+            continue;
+        }
+        // Extents are relative to _offset, like findSector
+        foreach (int sector, dataSectors(ind))
+            table->addExtent(sector - sectorOffset);
+    }
+    for (int i = 0; i < dirs.count(); i++)
+        addTableDir(table, dirs.at(i).first, dirs.at(i).second);
+}
+
+// Small reads, such as lookups and link targets from a mount, are served whole sectors at a time from _blockCache
+qint64 QNX6::readNode(quint32 index, char* data, qint64 pos, qint64 len) {
+    if (len >= QNX6_DIRECT_READ)
+        return QFileSystem::readNode(index, data, pos, len);
+    const QNodeTable* table = nodeTable();
+    if (table == nullptr || index >= table->count())
+        return -1;
+    const QFileNode& node = table->node(index);
+    if (pos >= (qint64)node.size)
+        return 0;
+    len = qMin(len, (qint64)node.size - pos);
+
+    const QFileExtent* extents = table->extents(index);
+    quint32 e = 0;
+    qint64 extentBlock = 0;
+    qint64 done = 0;
+    while (done < len) {
+        qint64 block = (pos + done) / sectorSize;
+        int within = (pos + done) % sectorSize;
+        while (e < node.extentCount && block >= extentBlock + extents[e].count)
+            extentBlock += extents[e++].count;
+        if (e >= node.extentCount)
+            break;
+        quint32 sector = extents[e].start + (block - extentBlock);
+        QByteArray* cached = _blockCache.object(sector);
+        if (cached == nullptr) {
+            _file->seek(_offset + (qint64)sector * sectorSize);
+            cached = new QByteArray(_file->read(sectorSize));
+            _blockCache.insert(sector, cached, sectorSize);
+        }
+        qint64 part = qMin((qint64)(cached->size() - within), len - done);
+        if (part <= 0)
+            break;
+        memcpy(data + done, cached->constData() + within, part);
+        done += part;
+    }
+    return done;
+}
+
+// Symlink targets are stored as the data of the link node
+QString QNX6::readLink(quint32 index) {
+    const QNodeTable* table = nodeTable();
+    if (table == nullptr || !table->isLink(index))
+        return QString();
+    QByteArray target((int)qMin<quint64>(table->node(index).size, sectorSize), 0);
+    qint64 read = readNode(index, target.data(), 0, target.size());
+    if (read <= 0)
+        return QString();
+    target.truncate(read);
+    int end = target.indexOf('\0');
+    if (end >= 0)
+        target.truncate(end);
+    return QString::fromUtf8(target);
+}
+
+// -- Image writer --
+
+// Layout written by createImageFromFolder, relative to the start of the image:
+// boot header, superblock at 0x2000, sector 0 (the inode table) at 0x3000, then long
+// filenames, directories and indirect blocks. All file data follows in a single run.
+#define QNX6_WRITE_SECTOR     0x1000
+#define QNX6_WRITE_SUPERBLOCK 0x2000
+#define QNX6_WRITE_BASE       (QNX6_WRITE_SUPERBLOCK + QNX6_WRITE_SECTOR)
+#define QNX6_WRITE_POINTERS   (QNX6_WRITE_SECTOR / 4)
+#define QNX6_SHORT_NAME       27
+// LFN index sectors are listed in the superblock from 0xF0, up to the node 0 slot at 0xF80
+#define QNX6_MAX_LFN_INDEX    ((0xF80 - 0xF0) / 4 - 1)
+
+static quint16 unixMode(const QFileInfo& info) {
+    QFile::Permissions perms = info.permissions();
+    quint16 mode = 0;
+    if (perms & QFile::ReadOwner)  mode |= 0400;
+    if (perms & QFile::WriteOwner) mode |= 0200;
+    if (perms & QFile::ExeOwner)   mode |= 0100;
+    if (perms & QFile::ReadGroup)  mode |= 0040;
+    if (perms & QFile::WriteGroup) mode |= 0020;
+    if (perms & QFile::ExeGroup)   mode |= 0010;
+    if (perms & QFile::ReadOther)  mode |= 0004;
+    if (perms & QFile::WriteOther) mode |= 0002;
+    if (perms & QFile::ExeOther)   mode |= 0001;
+    if (info.isSymLink())
+        return mode | 0120000;
+    return mode | (info.isDir() ? 040000 : 0100000);
+}
+
+// Indirect blocks needed to point at count data sectors. Tier 2 tops out at 16 * 1024 * 1024 sectors.
+static quint32 indirectBlocks(quint32 count) {
+    if (count <= 16)
+        return 0;
+    quint32 blocks = (count + QNX6_WRITE_POINTERS - 1) / QNX6_WRITE_POINTERS;
+    if (blocks <= 16)
+        return blocks;
+    return blocks + (blocks + QNX6_WRITE_POINTERS - 1) / QNX6_WRITE_POINTERS;
+}
+
+// A sector of count consecutive sector pointers, padded with -1
+static QByteArray pointerBlock(quint32 first, quint32 count) {
+    QByteArray block(QNX6_WRITE_SECTOR, (char)0xFF);
+    for (quint32 i = 0; i < count; i++)
+        qToLittleEndian<quint32>(first + i, reinterpret_cast<uchar*>(block.data()) + i * 4);
+    return block;
+}
+
+static bool writeSectors(QFile& image, quint32 sector, const QByteArray& data) {
+    return image.seek(QNX6_WRITE_BASE + (qint64)sector * QNX6_WRITE_SECTOR) && image.write(data) == data.size();
+}
+
+// Fills the 16 node pointers for count sectors starting at first, writing any indirect
+// blocks from the sector indirect onwards. Returns the number of tiers or -1.
+static int writePointers(QFile& image, quint32 first, quint32 count, quint32 indirect, qint32* ptrs) {
+    for (int i = 0; i < 16; i++)
+        ptrs[i] = -1;
+    if (count <= 16) {
+        for (quint32 i = 0; i < count; i++)
+            ptrs[i] = first + i;
+        return 0;
+    }
+    quint32 blocks = (count + QNX6_WRITE_POINTERS - 1) / QNX6_WRITE_POINTERS;
+    quint32 tops = 0;
+    if (blocks > 16) {
+        tops = (blocks + QNX6_WRITE_POINTERS - 1) / QNX6_WRITE_POINTERS;
+        for (quint32 t = 0; t < tops; t++) {
+            ptrs[t] = indirect + t;
+            if (!writeSectors(image, indirect + t, pointerBlock(indirect + tops + t * QNX6_WRITE_POINTERS,
+                                                               qMin<quint32>(QNX6_WRITE_POINTERS, blocks - t * QNX6_WRITE_POINTERS))))
+                return -1;
+        }
+    }
+    for (quint32 b = 0; b < blocks; b++) {
+        if (tops == 0)
+            ptrs[b] = indirect + b;
+        if (!writeSectors(image, indirect + tops + b, pointerBlock(first + b * QNX6_WRITE_POINTERS,
+                                                                 qMin<quint32>(QNX6_WRITE_POINTERS, count - b * QNX6_WRITE_POINTERS))))
+            return -1;
+    }
+    return tops ? 2 : 1;
+}
+
+static void writeDirEntry(char* entry, quint32 node, const QByteArray& name, int lfn) {
+    qToLittleEndian<quint32>(node, reinterpret_cast<uchar*>(entry));
+    if (lfn >= 0) {
+        entry[4] = (char)0xFF;
+        qToLittleEndian<qint32>(lfn, reinterpret_cast<uchar*>(entry) + 8);
+    } else {
+        entry[4] = (char)name.size();
+        memcpy(entry + 5, name.constData(), name.size());
+    }
+}
+
+// Copies one file in to its extent of the image. Each job has its own handles so they can run side by side.
+class QNX6CopyJob : public QRunnable {
+public:
+    QNX6CopyJob(QString source, QByteArray data, QString image, qint64 pos, qint64 size, QAtomicInt* failed, QAtomicInteger<qint64>* copied)
+        : _source(source), _data(data), _image(image), _pos(pos), _size(size), _failed(failed), _copied(copied) {}
+
+    void run() {
+        QFile out(_image);
+        if (!out.open(QIODevice::ReadWrite) || !out.seek(_pos)) {
+            _failed->store(1);
+            return;
+        }
+        // Symlink targets are stored as the node data
+        if (_source.isEmpty()) {
+            if (out.write(_data) != _data.size())
+                _failed->store(1);
+            _copied->fetchAndAddRelaxed(_data.size());
+            return;
+        }
+        QFile in(_source);
+        if (!in.open(QIODevice::ReadOnly)) {
+            _failed->store(1);
+            return;
+        }
+        // Never write past the extent, even if the file grew since the scan
+        for (qint64 left = _size; left > 0;) {
+            QByteArray buffer = in.read(qMin(FAST_BUFFER_LEN, left));
+            if (buffer.isEmpty() || out.write(buffer) != buffer.size()) {
+                _failed->store(1);
+                return;
+            }
+            left -= buffer.size();
+            _copied->fetchAndAddRelaxed(buffer.size());
+        }
+    }
+
+private:
+    QString _source;
+    QByteArray _data;
+    QString _image;
+    qint64 _pos, _size;
+    QAtomicInt* _failed;
+    QAtomicInteger<qint64>* _copied;
+};
+
+// Builds the node table of a host folder. File extents count from the start of the data run.
+void QNX6::scanFolder(QNodeTable* table, quint32 parent, const QString& path, QHash<quint32, QByteArray>* links, quint32* cursor) {
+    QList<QPair<quint32, QString> > dirs;
+    QFileInfoList entries = QDir(path).entryInfoList(QDir::AllEntries | QDir::NoDotAndDotDot | QDir::Hidden | QDir::System, QDir::Name);
+    foreach (QFileInfo entry, entries) {
+        quint32 time = entry.lastModified().toTime_t();
+        QByteArray name = entry.fileName().toUtf8();
+        qint64 size = entry.size();
+        if (entry.isSymLink()) {
+            QByteArray target = QDir(entry.path()).relativeFilePath(entry.symLinkTarget()).toUtf8();
+            links->insert(table->addNode(parent, name, target.size(), time, unixMode(entry)), target);
+            size = target.size();
+        } else if (entry.isDir()) {
+            dirs.append(qMakePair(table->addNode(parent, name, 0, time, unixMode(entry)), entry.filePath()));
+            continue;
+        } else
+            table->addNode(parent, name, size, time, unixMode(entry));
+
+        quint32 count = (size + QNX6_WRITE_SECTOR - 1) / QNX6_WRITE_SECTOR;
+        if (count > 0) {
+            table->addExtent(*cursor, count);
+            *cursor += count;
+        }
+    }
+    for (int i = 0; i < dirs.count(); i++)
+        scanFolder(table, dirs.at(i).first, dirs.at(i).second, links, cursor);
+}
+
+bool QNX6::createImageFromFolder(const QString& folderPath, const QString& imagePath) {
+    QFileInfo rootInfo(folderPath);
+    if (!rootInfo.isDir())
+        return false;
+
+    QNodeTable table(QNX6_WRITE_SECTOR);
+    QHash<quint32, QByteArray> links;
+    quint32 dataCount = 0;
+    table.addNode(NODE_NONE, "", 0, rootInfo.lastModified().toTime_t(), unixMode(rootInfo));
+    scanFolder(&table, 0, folderPath, &links, &dataCount);
+    quint32 count = table.count();
+
+    // Long filenames get a sector each
+    QHash<quint32, int> lfnIndex;
+    QList<quint32> longNames;
+    for (quint32 i = 1; i < count; i++) {
+        int len = table.name(i).toUtf8().size();
+        if (len > QNX6_MAX_CHARS)
+            return false;
+        if (len > QNX6_SHORT_NAME) {
+            lfnIndex.insert(i, longNames.count());
+            longNames.append(i);
+        }
+    }
+    quint32 lfnIndexCount = (longNames.count() + QNX6_WRITE_POINTERS - 1) / QNX6_WRITE_POINTERS;
+    if (lfnIndexCount > QNX6_MAX_LFN_INDEX)
+        return false;
+
+    // Sector allocation. Everything but file data comes first, so file data stays in one run.
+    quint32 next = (count * 0x80 + QNX6_WRITE_SECTOR - 1) / QNX6_WRITE_SECTOR;
+    quint32 lfnIndexStart = next;
+    next += lfnIndexCount;
+    quint32 lfnStart = next;
+    next += longNames.count();
+    QVector<quint32> dirStart(count, 0), dirLength(count, 0), indirect(count, 0);
+    for (quint32 i = 0; i < count; i++) {
+        quint32 length;
+        if (table.isDir(i)) {
+            length = ((table.children(i).count() + 2) * 0x20 + QNX6_WRITE_SECTOR - 1) / QNX6_WRITE_SECTOR;
+            dirStart[i] = next;
+            dirLength[i] = length;
+            next += length;
+        } else
+            length = table.node(i).extentCount ? table.extents(i)->count : 0;
+        if (length > 16 * QNX6_WRITE_POINTERS * QNX6_WRITE_POINTERS)
+            return false;
+        indirect[i] = next;
+        next += indirectBlocks(length);
+    }
+    quint32 dataStart = next;
+
+    QFile image(imagePath);
+    if (!image.open(QIODevice::WriteOnly) || !image.resize(QNX6_WRITE_BASE + (qint64)(dataStart + dataCount) * QNX6_WRITE_SECTOR))
+        return false;
+
+    // Boot header and superblock, as found by readSuperblock
+    QByteArray header(QNX6_WRITE_BASE, 0);
+    uchar* h = reinterpret_cast<uchar*>(header.data());
+    memcpy(h, "\xEB\x10\x90\x00", 4);
+    h[8] = 0x10; // No sector offset
+    memcpy(h + 0x10, "\x22\x11\x19\x68", 4);
+    memcpy(h + QNX6_WRITE_SUPERBLOCK, "\xDD\xEE\xE6\x97", 4);
+    qToLittleEndian<quint16>(QNX6_WRITE_SECTOR, h + QNX6_WRITE_SUPERBLOCK + 48);
+    for (quint32 k = 0; k < lfnIndexCount; k++)
+        qToLittleEndian<quint32>(lfnIndexStart + k, h + QNX6_WRITE_SUPERBLOCK + 0xF0 + k * 4);
+    qToLittleEndian<qint32>(-1, h + QNX6_WRITE_SUPERBLOCK + 0xF0 + lfnIndexCount * 4);
+    if (image.write(header) != header.size())
+        return false;
+
+    // Long filenames
+    for (quint32 k = 0; k < lfnIndexCount; k++) {
+        if (!writeSectors(image, lfnIndexStart + k, pointerBlock(lfnStart + k * QNX6_WRITE_POINTERS,
+                                                               qMin<quint32>(QNX6_WRITE_POINTERS, longNames.count() - k * QNX6_WRITE_POINTERS))))
+            return false;
+    }
+    for (int k = 0; k < longNames.count(); k++) {
+        QByteArray name = table.name(longNames.at(k)).toUtf8();
+        QByteArray block(QNX6_WRITE_SECTOR, 0);
+        qToLittleEndian<quint16>(name.size(), reinterpret_cast<uchar*>(block.data()));
+        memcpy(block.data() + 2, name.constData(), name.size());
+        if (!writeSectors(image, lfnStart + k, block))
+            return false;
+    }
+
+    // Nodes, directories and indirect blocks. Node numbers are table indices + 1.
+    QByteArray inodes(count * 0x80, 0);
+    qint64 total = 0;
+    for (quint32 i = 0; i < count; i++) {
+        const QFileNode& node = table.node(i);
+        quint32 first, length;
+        quint64 size = node.size;
+        if (table.isDir(i)) {
+            first = dirStart[i];
+            length = dirLength[i];
+            size = (quint64)length * QNX6_WRITE_SECTOR;
+            QByteArray dir(length * QNX6_WRITE_SECTOR, 0);
+            writeDirEntry(dir.data(), i + 1, ".", -1);
+            writeDirEntry(dir.data() + 0x20, (i == 0) ? 1 : node.parent + 1, "..", -1);
+            int e = 2;
+            foreach (quint32 child, table.children(i))
+                writeDirEntry(dir.data() + 0x20 * e++, child + 1, table.name(child).toUtf8(), lfnIndex.value(child, -1));
+            if (!writeSectors(image, first, dir))
+                return false;
+        } else {
+            first = node.extentCount ? dataStart + table.extents(i)->start : 0;
+            length = node.extentCount ? table.extents(i)->count : 0;
+            total += node.size;
+        }
+
+        qint32 ptrs[16];
+        int tiers = writePointers(image, first, length, indirect[i], ptrs);
+        if (tiers < 0)
+            return false;
+        uchar* p = reinterpret_cast<uchar*>(inodes.data()) + i * 0x80;
+        qToLittleEndian<quint64>(size, p);
+        for (int t = 0x10; t < 0x20; t += 4)
+            qToLittleEndian<quint32>(node.time, p + t);
+        qToLittleEndian<quint16>(node.mode, p + 0x20);
+        for (int k = 0; k < 16; k++)
+            qToLittleEndian<qint32>(ptrs[k], p + 0x24 + k * 4);
+        p[0x64] = tiers;
+        p[0x65] = 1; // In use
+    }
+    if (!writeSectors(image, 0, inodes))
+        return false;
+    image.close();
+
+    // File data, in parallel
+    curSize = 0;
+    maxSize = total;
+    QThreadPool pool;
+    QAtomicInt failed(0);
+    QAtomicInteger<qint64> copied(0);
+    for (quint32 i = 0; i < count; i++) {
+        if (table.isDir(i) || table.node(i).extentCount == 0)
+            continue;
+        qint64 pos = QNX6_WRITE_BASE + (qint64)(dataStart + table.extents(i)->start) * QNX6_WRITE_SECTOR;
+        QString source = links.contains(i) ? QString() : folderPath + "/" + table.path(i);
+        pool.start(new QNX6CopyJob(source, links.value(i), imagePath, pos, table.node(i).size, &failed, &copied));
+    }
+    while (!pool.waitForDone(100))
+        increaseCurSize(copied.fetchAndStoreRelaxed(0));
+    increaseCurSize(copied.fetchAndStoreRelaxed(0));
+    return failed.load() == 0;
 }
 
+}
@@ -18,10 +18,16 @@
 #pragma once
 
 #include <QPair>
+#include <QCache>
 #include <quazip/quazip.h>
 #include <quazip/quazipfile.h>
 #include "fs.h"
 
+// Reads smaller than this go through the block cache. Bigger ones would only push everything else out of it.
+#define QNX6_DIRECT_READ (64 * 1024)
+// Block cache cost is in bytes
+#define QNX6_BLOCK_CACHE (16 * 1024 * 1024)
+
 namespace FS {
 
 struct qinode {
@@ -39,7 +45,9 @@ class QNX6 : public QFileSystem
 public:
     explicit QNX6(QString filename, QIODevice* file, qint64 offset, qint64 size, QString path)
         : QFileSystem(filename, file, offset, size, path, ".qnx6")
-        , currentZip(nullptr) {}
+        , currentZip(nullptr)
+        , _superblockRead(false)
+        , _blockCache(QNX6_BLOCK_CACHE) {}
 
     inline qint64 findSector(qint64 sector) {
         return _offset + ((sector - sectorOffset) * sectorSize);
@@ -49,26 +57,44 @@ public:
     }
     qint64 findIndexFromSig(unsigned char* signature, int startFrom, int distanceFrom, unsigned int maxBlocks = -1, int num = 4);
     qinode createNode(int node);
+    QList<int> dataSectors(const qinode& ind);
+    bool readSuperblock();
     // TODO: Read ./.rootfs.os.version or ./var/pps/system/installer/coreos/0
     //QString generateName(QString imageExt = "");
-    void extractManifest(int nodenum);
-    void extractDir(int offset, QString basedir, int numNodes);
 
     bool createContents();
 
+    QList<QPair<int, QString> > readDir(int nodenum);
+    qint64 readNode(quint32 index, char* data, qint64 pos, qint64 len);
+    QString readLink(quint32 index);
+
+    // Writes a host folder out as a new .qnx6 image that can be read back
+    bool createImageFromFolder(const QString& folderPath, const QString& imagePath);
+
     // TODO: These need to have a better method of passing from Splitter
     bool extractApps;
 
 signals:
     void currentNameChanged(QString name);
 
+protected:
+    bool buildNodeTable(QNodeTable* table);
+
 private:
+    void addTableDir(QNodeTable* table, quint32 parent, int nodenum);
+    void scanFolder(QNodeTable* table, quint32 parent, const QString& path, QHash<quint32, QByteArray>* links, quint32* cursor);
     QPair<int, QString> nodeInfo(QNXStream* stream, qint64 offset);
+    bool extractAppBars(const QNodeTable* table, quint32 dir);
+    bool openAppBar(const QNodeTable* table, quint32 app);
+    bool zipAppDir(const QNodeTable* table, quint32 dir, QString prefix, bool inMetaInf);
     quint16 sectorSize;
     quint16 sectorOffset;
     QList<int> lfn;
     QuaZip* currentZip;
     QList<QString> manifestApps;
+    bool _superblockRead;
+    // Only used by readNode, by sector relative to _offset
+    QCache<quint32, QByteArray> _blockCache;
 
 };
 
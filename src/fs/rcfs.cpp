@@ -28,7 +28,8 @@ namespace FS
 {
 
     RCFS::RCFS(QString filename, QIODevice *file, qint64 offset, qint64 size, QString path)
-        : QFileSystem(filename, file, offset, size, path, ""), _path(filename), _file(file), _offset(offset), _size(size), _name(path)
+        : QFileSystem(filename, file, offset, size, path, "")
+        , _chunkCache(16 * 1024 * 1024)
     {
         // Ensure the file is open
         if (_file && !_file->isOpen())
@@ -58,31 +59,23 @@ namespace FS
         QString cpu = "unk";
         QString version = "unk";
 
-        if (_file->readLine(4).startsWith("fs-"))
+        const QNodeTable *table = _file->readLine(4).startsWith("fs-") ? nodeTable() : nullptr;
+        if (table != nullptr)
         {
-            _file->seek(_offset + 0x1038);
-            QNXStream stream(_file);
-            READ_TMP(qint32, offset);
-            rinode dotnode = createNode(offset);
-            for (int i = 0; i < dotnode.size / 0x20; i++)
+            foreach (quint32 child, table->children(0))
             {
-                rinode slashdotnode = createNode(dotnode.offset + (i * 0x20));
-                if (slashdotnode.name == "etc")
+                QString childName = table->name(child);
+                if (childName == "etc" && table->isDir(child))
                 {
-                    for (int i = 0; i < slashdotnode.size / 0x20; i++)
+                    foreach (quint32 file, table->children(child))
                     {
-                        rinode node = createNode(slashdotnode.offset + (i * 0x20));
-                        if (node.name == "os.version" || node.name == "radio.version")
-                        {
-                            QByteArray versionData = extractFile(_offset + node.offset, node.size, node.mode);
-                            version = QString(versionData).simplified();
-                        }
+                        if (table->name(file) == "os.version" || table->name(file) == "radio.version")
+                            version = QString(readNodeData(file)).simplified();
                     }
                 }
-                if (slashdotnode.name.endsWith(".tdf"))
+                if (childName.endsWith(".tdf"))
                 {
-                    QByteArray boardData = extractFile(_offset + slashdotnode.offset, slashdotnode.size, slashdotnode.mode);
-                    foreach (QString config, QString(boardData).split('\n'))
+                    foreach (QString config, QString(readNodeData(child)).split('\n'))
                     {
                         if (config.startsWith("CPU="))
                         {
@@ -115,126 +108,140 @@ namespace FS
         return uniqueFile(name + imageExt);
     }
 
-    // Returning the array of data might be dangerous if it's huge. Consider taking a var instead
-    QByteArray RCFS::extractFile(qint64 node_offset, int node_size, int node_mode)
+    bool RCFS::createContents()
     {
-        QByteArray ret;
-        _file->seek(node_offset);
-        QNXStream stream(_file);
-        if (node_mode & QCFM_IS_LZO_COMPRESSED)
-        {
-            READ_TMP(int, next);
-            int chunks = (next - 4) / 4;
-            QList<int> sizes, offsets;
-            offsets.append(next);
-            for (int s = 0; s < chunks; s++)
-            {
-                stream >> next;
-                offsets.append(next);
-                sizes.append(offsets[s + 1] - offsets[s]);
-            }
-            char *buffer = new char[node_size];
-            foreach (int size, sizes)
-            {
-                char *readData = new char[size];
-                _file->read(readData, size);
-                size_t write_len = 0x4000;
-                lzo1x_decompress_safe(reinterpret_cast<const unsigned char *>(readData), size, reinterpret_cast<unsigned char *>(buffer), &write_len, nullptr);
-                ret.append(buffer, write_len);
-                delete[] readData;
-            }
-            delete[] buffer;
-        }
-        else
-        {
-            for (qint64 i = node_size; i > 0;)
-            {
-                QByteArray data = _file->read(qMin(BUFFER_LEN, i));
-                i -= data.size();
-                ret.append(data);
-            }
-        }
-        return ret;
+        if (!extractNode(0, _path))
+            return false;
+
+        // Display result
+        QDesktopServices::openUrl(QUrl(_path));
+        return true;
     }
 
-    void RCFS::extractDir(int offset, int numNodes, QString basedir, qint64 _offset)
+    // -- Node table, for random access without extracting --
+
+    int RCFS::rootNode()
     {
+        _file->seek(_offset + 0x1038);
         QNXStream stream(_file);
-        QDir mainDir(basedir);
-        for (int i = 0; i < numNodes; i++)
+        READ_TMP(qint32, offset);
+        return offset;
+    }
+
+    QList<int> RCFS::readDir(const rinode &dir)
+    {
+        QList<int> children;
+        for (int i = 0; i < dir.size / 0x20; i++)
+            children.append(dir.offset + (i * 0x20));
+        return children;
+    }
+
+    bool RCFS::buildNodeTable(QNodeTable *table)
+    {
+        int root = rootNode();
+        rinode dot = createNode(root);
+        if (!(dot.mode & QCFM_IS_DIRECTORY))
+            return false;
+        table->addNode(NODE_NONE, "", dot.size, dot.time, dot.mode, root);
+        addTableDir(table, 0, dot);
+        return true;
+    }
+
+    void RCFS::addTableDir(QNodeTable *table, quint32 parent, const rinode &dir)
+    {
+        QList<QPair<quint32, rinode> > dirs;
+        foreach (int offset, readDir(dir))
         {
-            rinode node = createNode(offset + (i * 0x20));
-            node.path_to = basedir;
-            QString absName = node.path_to + "/" + node.name;
+            rinode node = createNode(offset);
+            quint32 index = table->addNode(parent, node.name.toUtf8(), node.size, node.time, node.mode, offset);
             if (node.mode & QCFM_IS_DIRECTORY)
+                dirs.append(qMakePair(index, node));
+            else if (node.mode & QCFM_IS_SYMLINK)
+                table->addExtent(node.offset, 0);
+            else if (node.mode & QCFM_IS_LZO_COMPRESSED)
             {
-                mainDir.mkpath(node.name);
-                if (node.size > 0)
-                    extractDir(node.offset, node.size / 0x20, absName, _offset);
+                // The last entry of the chunk table is the end of the compressed data
+                QNXStream stream(_file);
+                _file->seek(_offset + node.offset);
+                READ_TMP(int, tableSize);
+                _file->seek(_offset + node.offset + tableSize - 4);
+                READ_TMP(int, end);
+                table->addExtent(node.offset, end);
             }
             else
-            {
-                _file->seek(node.offset + _offset);
-                if (node.mode & QCFM_IS_SYMLINK)
-                {
-#ifdef _WIN32
-                    QString lnkName = absName + ".lnk";
-                    QFile::link(node.path_to + "/" + _file->readLine(QNX6_MAX_CHARS), lnkName);
-                    fixFileTime(lnkName, node.time);
-#else
-                    QFile::link(node.path_to + "/" + _file->readLine(QNX6_MAX_CHARS), absName);
-#endif
-                    continue;
-                }
-                if (node.mode & QCFM_IS_LZO_COMPRESSED)
-                {
-                    QFile newFile(absName);
-                    newFile.open(QFile::WriteOnly);
-                    READ_TMP(int, next);
-                    int chunks = (next - 4) / 4;
-                    QList<int> sizes, offsets;
-                    offsets.append(next);
-                    for (int s = 0; s < chunks; s++)
-                    {
-                        stream >> next;
-                        offsets.append(next);
-                        sizes.append(offsets[s + 1] - offsets[s]);
-                    }
-                    char *buffer = new char[node.size];
-                    foreach (int size, sizes)
-                    {
-                        char *readData = new char[size];
-                        _file->read(readData, size);
-                        size_t write_len = 0x4000;
-                        lzo1x_decompress_safe(reinterpret_cast<const unsigned char *>(readData), size, reinterpret_cast<unsigned char *>(buffer), &write_len, nullptr);
-                        newFile.write(buffer, (qint64)write_len);
-                        increaseCurSize(size); // Uncompressed size
-                        delete[] readData;
-                    }
-                    delete[] buffer;
-                    newFile.close();
-                }
-                else
-                {
-                    writeFile(absName, node.size, true);
-                }
-#ifdef _WIN32
-                fixFileTime(absName, node.time);
-#endif
-            }
+                table->addExtent(node.offset, node.size);
         }
+        for (int i = 0; i < dirs.count(); i++)
+            addTableDir(table, dirs.at(i).first, dirs.at(i).second);
     }
 
-    bool RCFS::createContents()
+    QString RCFS::readLink(quint32 index)
     {
-        _file->seek(_offset + 0x1038);
-        QNXStream stream(_file);
-        READ_TMP(qint32, offset);
-        extractDir(offset, 1, _path, _offset);
+        const QNodeTable *table = nodeTable();
+        if (table == nullptr || !table->isLink(index))
+            return QString();
+        _file->seek(_offset + table->extents(index)->start);
+        return QString(_file->readLine(QNX6_MAX_CHARS));
+    }
 
-        // Display result
-        QDesktopServices::openUrl(QUrl(_path));
-        return true;
+    qint64 RCFS::readNode(quint32 index, char *data, qint64 pos, qint64 len)
+    {
+        const QNodeTable *table = nodeTable();
+        if (table == nullptr || index >= table->count())
+            return -1;
+        const QFileNode &node = table->node(index);
+        if (!(node.mode & QCFM_IS_LZO_COMPRESSED))
+            return QFileSystem::readNode(index, data, pos, len);
+        if (pos >= (qint64)node.size)
+            return 0;
+        len = qMin(len, (qint64)node.size - pos);
+        qint64 dataOffset = table->extents(index)->start;
+
+        // Compressed files are a table of chunk offsets followed by 0x4000 byte LZO chunks
+        if (!_chunkTables.contains(index))
+        {
+            _file->seek(_offset + dataOffset);
+            QNXStream stream(_file);
+            READ_TMP(int, next);
+            QVector<int> offsets;
+            offsets.append(next);
+            for (int s = 0; s < (next - 4) / 4; s++)
+            {
+                stream >> next;
+                offsets.append(next);
+            }
+            _chunkTables.insert(index, offsets);
+        }
+        QVector<int> offsets = _chunkTables.value(index);
+
+        qint64 done = 0;
+        while (done < len)
+        {
+            int chunk = (pos + done) / 0x4000;
+            int within = (pos + done) % 0x4000;
+            if (chunk + 1 >= offsets.count())
+                break;
+            qint64 key = dataOffset + offsets[chunk];
+            if (!_chunkCache.contains(key))
+            {
+                int size = offsets[chunk + 1] - offsets[chunk];
+                _file->seek(_offset + key);
+                QByteArray compressed = _file->read(size);
+                QByteArray *decompressed = new QByteArray(0x4000, 0);
+                size_t write_len = 0x4000;
+                lzo1x_decompress_safe(reinterpret_cast<const unsigned char *>(compressed.constData()), compressed.size(),
+                                      reinterpret_cast<unsigned char *>(decompressed->data()), &write_len, nullptr);
+                decompressed->resize((int)write_len);
+                _chunkCache.insert(key, decompressed, 0x4000);
+            }
+            QByteArray *block = _chunkCache.object(key);
+            qint64 part = qMin((qint64)(block->size() - within), len - done);
+            if (part <= 0)
+                break;
+            memcpy(data + done, block->constData() + within, part);
+            done += part;
+        }
+        return done;
     }
 
     bool RCFS::createImageFromFolder(const QString &folderPath, const QString &imagePath)
@@ -17,6 +17,9 @@
 
 #pragma once
 
+#include <QHash>
+#include <QCache>
+#include <QVector>
 #include "fs.h"
 
 namespace FS {
@@ -41,14 +44,22 @@ public:
 
     rinode createNode(int offset);
     QString generateName(QString imageExt = "");
-    QByteArray extractFile(qint64 node_offset, int node_size, int node_mode);
-    void extractDir(int offset, int numNodes, QString basedir, qint64 startPos);
 
     bool createContents();
+
+    int rootNode();
+    QList<int> readDir(const rinode& dir);
+    qint64 readNode(quint32 index, char* data, qint64 pos, qint64 len);
+    QString readLink(quint32 index);
+
     bool createImageFromFolder(const QString& folderPath, const QString& imagePath);
     bool decompressRCFS(const QString &inputPath, const QString &outputPath);
 
+protected:
+    bool buildNodeTable(QNodeTable* table);
+
 private:
+    void addTableDir(QNodeTable* table, quint32 parent, const rinode& dir);
     void writeDirectoryContents(QNXStream& stream, const QDir& dir, int baseOffset);
     void writeDirectoryEntry(QNXStream& stream, const QFileInfo& entry, int baseOffset);
     void writeFileEntry(QNXStream& stream, const QFileInfo& entry, int baseOffset);
@@ -58,11 +69,9 @@ private:
     void processCompressedContent(QFile &inputFile, QFile &outputFile, const rinode &node);
     void copyFileContent(QFile &inputFile, QFile &outputFile, qint64 size);
 
-    QString _path;
-    QIODevice* _file;
-    qint64 _offset;
-    qint64 _size;
-    QString _name;
+    // Only used by readNode. Chunk cache cost is in bytes.
+    QHash<quint32, QVector<int> > _chunkTables;
+    QCache<qint64, QByteArray> _chunkCache;
 };
 
 }
@@ -0,0 +1,293 @@
+// Copyright (C) 2014 Sacha Refshauge
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 3.0.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 3.0 for more details.
+
+// A copy of the GPL 3.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official GIT repository and contact information can be found at
+// http://github.com/xsacha/Sachesi
+
+#include "sink.h"
+#include "fs.h"
+#include <string.h>
+
+// Tar blocks are always 512 bytes
+#define TAR_BLOCK 512
+
+QString QFileSink::entryName(QString path) const {
+    path = QDir::cleanPath(path);
+    if (path == _root)
+        return "";
+    if (path.startsWith(_root + "/"))
+        return path.mid(_root.length() + 1);
+    return path;
+}
+
+QFileSink* QFileSink::create(QFileSinkType type, QString root) {
+    switch (type) {
+    case SinkTar:
+        return new FS::TarSink(root);
+    case SinkZip:
+        return new FS::ZipSink(root);
+    case SinkDirectory:
+    default:
+        return new FS::DirSink(root);
+    }
+}
+
+QString QFileSink::outputPath(QFileSinkType type, QString root) {
+    switch (type) {
+    case SinkTar:
+        return root + ".tar";
+    case SinkZip:
+        return root + ".zip";
+    case SinkDirectory:
+    default:
+        return root;
+    }
+}
+
+namespace FS {
+
+// -- Directory --
+
+bool DirSink::mkdir(QString path, int time, quint16 mode) {
+    Q_UNUSED(time);
+    Q_UNUSED(mode);
+    return QDir().mkpath(path);
+}
+
+bool DirSink::beginFile(QString path, qint64 size, int time, quint16 mode) {
+    Q_UNUSED(size);
+    Q_UNUSED(mode);
+    _time = time;
+    _current.setFileName(path);
+    return _current.open(QIODevice::WriteOnly);
+}
+
+bool DirSink::write(const char* data, qint64 len) {
+    return _current.write(data, len) == len;
+}
+
+bool DirSink::endFile() {
+    _current.close();
+#ifdef _WIN32
+    if (_time != 0)
+        fixFileTime(_current.fileName(), _time);
+#endif
+    return true;
+}
+
+bool DirSink::symlink(QString path, QString target, int time) {
+    QString linkTo = QFileInfo(path).path() + "/" + target;
+#ifdef _WIN32
+    QString lnkName = path + ".lnk";
+    bool ret = QFile::link(linkTo, lnkName);
+    fixFileTime(lnkName, time);
+    return ret;
+#else
+    Q_UNUSED(time);
+    return QFile::link(linkTo, path);
+#endif
+}
+
+// -- Tar --
+
+// Octal numeric field, falling back to the base-256 extension for large values
+static void tarNumber(char* field, int len, qint64 value) {
+    QByteArray octal = QByteArray::number(value, 8);
+    if (octal.size() < len) {
+        octal = octal.rightJustified(len - 1, '0');
+        memcpy(field, octal.constData(), len - 1);
+        field[len - 1] = 0;
+        return;
+    }
+    memset(field, 0, len);
+    field[0] = (char)0x80;
+    for (int i = len - 1; i > 0 && value > 0; i--, value >>= 8)
+        field[i] = (char)(value & 0xFF);
+}
+
+bool TarSink::open() {
+    _tar.setFileName(outputPath(SinkTar, _root));
+    return _tar.open(QIODevice::WriteOnly);
+}
+
+bool TarSink::close() {
+    if (!_tar.isOpen())
+        return true;
+    // End of archive is two empty blocks
+    bool ret = _tar.write(QByteArray(TAR_BLOCK * 2, 0)) == TAR_BLOCK * 2;
+    _tar.close();
+    return ret;
+}
+
+bool TarSink::pad() {
+    int remainder = _tar.pos() % TAR_BLOCK;
+    if (remainder == 0)
+        return true;
+    return _tar.write(QByteArray(TAR_BLOCK - remainder, 0)) == TAR_BLOCK - remainder;
+}
+
+bool TarSink::writeLongName(char type, QByteArray name) {
+    name.append('\0');
+    if (!writeHeader("././@LongLink", type, name.size(), 0, 0))
+        return false;
+    if (_tar.write(name) != name.size())
+        return false;
+    return pad();
+}
+
+// Fills one header block. Names and link targets past 100 bytes are cut off here;
+// writeHeader puts the full ones in a long name entry first.
+static void tarHeader(char* header, const QByteArray& name, char type, qint64 size, int time, quint16 mode, const QByteArray& link) {
+    memset(header, 0, TAR_BLOCK);
+    memcpy(header, name.constData(), qMin(name.size(), 100));
+    tarNumber(header + 100, 8, mode & 07777);
+    tarNumber(header + 108, 8, 0); // uid
+    tarNumber(header + 116, 8, 0); // gid
+    tarNumber(header + 124, 12, size);
+    tarNumber(header + 136, 12, time);
+    header[156] = type;
+    memcpy(header + 157, link.constData(), qMin(link.size(), 100));
+    memcpy(header + 257, "ustar", 6);
+    memcpy(header + 263, "00", 2);
+
+    // Checksum is calculated with the checksum field as spaces
+    memset(header + 148, ' ', 8);
+    unsigned int checksum = 0;
+    for (int i = 0; i < TAR_BLOCK; i++)
+        checksum += (unsigned char)header[i];
+    tarNumber(header + 148, 7, checksum);
+}
+
+bool TarSink::writeHeader(QString name, char type, qint64 size, int time, quint16 mode, QString link) {
+    QByteArray nameData = name.toUtf8();
+    QByteArray linkData = link.toUtf8();
+    // GNU long name extension for anything that doesn't fit
+    if (nameData.size() > 100 && !writeLongName('L', nameData))
+        return false;
+    if (linkData.size() > 100 && !writeLongName('K', linkData))
+        return false;
+
+    char header[TAR_BLOCK];
+    tarHeader(header, nameData, type, size, time, mode, linkData);
+    _headerPos = _tar.pos();
+    return _tar.write(header, TAR_BLOCK) == TAR_BLOCK;
+}
+
+bool TarSink::mkdir(QString path, int time, quint16 mode) {
+    QString name = entryName(path);
+    if (name.isEmpty())
+        return true;
+    return writeHeader(name + "/", '5', 0, time, mode);
+}
+
+bool TarSink::beginFile(QString path, qint64 size, int time, quint16 mode) {
+    _name = entryName(path).toUtf8();
+    _time = time;
+    _mode = mode;
+    _declared = size;
+    _written = 0;
+    return writeHeader(entryName(path), '0', size, time, mode);
+}
+
+bool TarSink::write(const char* data, qint64 len) {
+    _written += len;
+    return _tar.write(data, len) == len;
+}
+
+bool TarSink::endFile() {
+    // Compressed nodes don't always report their real size. Fix up the header in place.
+    if (_written != _declared) {
+        qint64 end = _tar.pos();
+        // Only the one header block is rewritten. Any long name entry before it stays as it is.
+        char header[TAR_BLOCK];
+        tarHeader(header, _name, '0', _written, _time, _mode, QByteArray());
+        if (!_tar.seek(_headerPos) || _tar.write(header, TAR_BLOCK) != TAR_BLOCK || !_tar.seek(end))
+            return false;
+    }
+    return pad();
+}
+
+bool TarSink::symlink(QString path, QString target, int time) {
+    return writeHeader(entryName(path), '2', 0, time, 0777, target);
+}
+
+// -- Zip (stored) --
+
+bool ZipSink::open() {
+    _zip = new QuaZip(outputPath(SinkZip, _root));
+    // Full OS trees are well past the 4GB limit
+    _zip->setZip64Enabled(true);
+    return _zip->open(QuaZip::mdCreate);
+}
+
+bool ZipSink::close() {
+    if (_zip == nullptr)
+        return true;
+    endFile();
+    _zip->close();
+    bool ret = _zip->getZipError() == 0;
+    delete _zip;
+    _zip = nullptr;
+    return ret;
+}
+
+bool ZipSink::addEntry(QString name, int time, quint16 mode, QByteArray data) {
+    if (!openEntry(name, time, mode))
+        return false;
+    if (!data.isEmpty() && !write(data))
+        return false;
+    return endFile();
+}
+
+bool ZipSink::mkdir(QString path, int time, quint16 mode) {
+    QString name = entryName(path);
+    if (name.isEmpty())
+        return true;
+    return addEntry(name + "/", time, mode | QCFM_IS_DIRECTORY);
+}
+
+bool ZipSink::beginFile(QString path, qint64 size, int time, quint16 mode) {
+    Q_UNUSED(size);
+    return openEntry(entryName(path), time, mode);
+}
+
+bool ZipSink::openEntry(QString name, int time, quint16 mode) {
+    QuaZipNewInfo newInfo(name);
+    newInfo.dateTime.setTime_t(time);
+    // Unix mode lives in the upper half of the external attributes
+    newInfo.externalAttr = (quint32)mode << 16;
+    _zipFile = new QuaZipFile(_zip);
+    // Method 0 = stored. The point is one sequential write, not compression.
+    return _zipFile->open(QIODevice::WriteOnly, newInfo, nullptr, 0, 0, 0);
+}
+
+bool ZipSink::write(const char* data, qint64 len) {
+    return _zipFile->write(data, len) == len;
+}
+
+bool ZipSink::endFile() {
+    if (_zipFile == nullptr)
+        return true;
+    _zipFile->close();
+    bool ret = _zipFile->getZipError() == 0;
+    delete _zipFile;
+    _zipFile = nullptr;
+    return ret;
+}
+
+bool ZipSink::symlink(QString path, QString target, int time) {
+    return addEntry(entryName(path), time, 0120777, target.toUtf8());
+}
+
+}
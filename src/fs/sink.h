@@ -0,0 +1,131 @@
+// Copyright (C) 2014 Sacha Refshauge
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 3.0.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 3.0 for more details.
+
+// A copy of the GPL 3.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official GIT repository and contact information can be found at
+// http://github.com/xsacha/Sachesi
+
+#pragma once
+
+#include <QFile>
+#include <QDir>
+#include <QString>
+#include <quazip/quazip.h>
+#include <quazip/quazipfile.h>
+
+enum QFileSinkType {
+    SinkDirectory = 0,
+    SinkTar = 1,
+    SinkZip = 2,
+};
+
+// Destination for extracted files. Filesystems pass paths under root() and
+// the sink decides whether these become host files or archive entries.
+// Modes are the unix st_mode found in the image nodes.
+class QFileSink {
+public:
+    explicit QFileSink(QString root)
+        : _root(QDir::cleanPath(root)) {}
+    virtual ~QFileSink() {}
+
+    virtual bool open() { return true; }
+    virtual bool close() { return true; }
+    virtual bool mkdir(QString path, int time, quint16 mode) = 0;
+    virtual bool beginFile(QString path, qint64 size, int time, quint16 mode) = 0;
+    virtual bool write(const char* data, qint64 len) = 0;
+    bool write(const QByteArray& data) { return write(data.constData(), data.size()); }
+    virtual bool endFile() = 0;
+    virtual bool symlink(QString path, QString target, int time) = 0;
+
+    QString root() const { return _root; }
+    // The archive name of an entry, relative to root
+    QString entryName(QString path) const;
+
+    static QFileSink* create(QFileSinkType type, QString root);
+    // What a sink of this type writes for root: the folder itself, <root>.tar or <root>.zip
+    static QString outputPath(QFileSinkType type, QString root);
+
+protected:
+    QString _root;
+};
+
+namespace FS {
+
+// One host file per image file. This is how extraction has always worked.
+class DirSink : public QFileSink {
+public:
+    explicit DirSink(QString root)
+        : QFileSink(root), _time(0) {}
+
+    bool mkdir(QString path, int time, quint16 mode);
+    bool beginFile(QString path, qint64 size, int time, quint16 mode);
+    bool write(const char* data, qint64 len);
+    bool endFile();
+    bool symlink(QString path, QString target, int time);
+
+private:
+    QFile _current;
+    int _time;
+};
+
+// A single ustar stream written sequentially to <root>.tar
+class TarSink : public QFileSink {
+public:
+    explicit TarSink(QString root)
+        : QFileSink(root), _headerPos(0), _declared(0), _written(0) {}
+
+    bool open();
+    bool close();
+    bool mkdir(QString path, int time, quint16 mode);
+    bool beginFile(QString path, qint64 size, int time, quint16 mode);
+    bool write(const char* data, qint64 len);
+    bool endFile();
+    bool symlink(QString path, QString target, int time);
+
+private:
+    bool writeHeader(QString name, char type, qint64 size, int time, quint16 mode, QString link = "");
+    bool writeLongName(char type, QByteArray name);
+    bool pad();
+
+    QFile _tar;
+    qint64 _headerPos;
+    qint64 _declared, _written;
+    QByteArray _name; // UTF-8, as it went in to the header
+    int _time;
+    quint16 _mode;
+};
+
+// A store-only (uncompressed) zip written to <root>.zip
+class ZipSink : public QFileSink {
+public:
+    explicit ZipSink(QString root)
+        : QFileSink(root), _zip(nullptr), _zipFile(nullptr) {}
+    ~ZipSink() { close(); }
+
+    bool open();
+    bool close();
+    bool mkdir(QString path, int time, quint16 mode);
+    bool beginFile(QString path, qint64 size, int time, quint16 mode);
+    bool write(const char* data, qint64 len);
+    bool endFile();
+    bool symlink(QString path, QString target, int time);
+
+private:
+    bool openEntry(QString name, int time, quint16 mode);
+    bool addEntry(QString name, int time, quint16 mode, QByteArray data = QByteArray());
+
+    QuaZip* _zip;
+    QuaZipFile* _zipFile;
+};
+
+}
@@ -19,6 +19,7 @@
 
 #include "installer.h"
 #include "ports.h"
+#include "bandwidth.h"
 #include <QAbstractListModel>
 #include <QDebug>
 #include <QMessageBox>
@@ -138,6 +139,7 @@ BarInfo InstallNet::checkInstallableInfo(QString name, bool blitz)
         }
         else if (newLine.startsWith("Package-Version:")) {
             barInfo.version = newLine.split(':').last().simplified();
+            barInfo.packedVersion = PackedVersion(barInfo.version);
         }
         else if (newLine.startsWith("Package-Id:")) {
             barInfo.packageid = newLine.split(':').last().simplified();
@@ -153,7 +155,7 @@ BarInfo InstallNet::checkInstallableInfo(QString name, bool blitz)
 
     // Check if we are about to make a huge mistake!
     if (barInfo.type == OSType) {
-        if (!_allowDowngrades && isVersionNewer(device->os, barInfo.version, true)) {
+        if (!_allowDowngrades && PackedVersion(device->os).isNewerThan(barInfo.packedVersion, true)) {
             setNewLine(QString("OS %1 skipped. Newer version is installed(%2)").arg(barInfo.version).arg(device->os));
             barInfo.type = NotInstallableType;
             return barInfo;
@@ -177,7 +179,7 @@ BarInfo InstallNet::checkInstallableInfo(QString name, bool blitz)
             }
         }
     } else if (barInfo.type == RadioType) {
-        if (!_allowDowngrades && isVersionNewer(device->radio, barInfo.version, true)) {
+        if (!_allowDowngrades && PackedVersion(device->radio).isNewerThan(barInfo.packedVersion, true)) {
             setNewLine(QString("Radio %1 skipped. Newer version is installed(%2)").arg(barInfo.version).arg(device->radio));
             barInfo.type = NotInstallableType;
             return barInfo;
@@ -322,15 +324,10 @@ void InstallNet::install(QList<QUrl> files)
         if (info.name == "EXIT")
             return setNewLine("Install aborted.");
         else if (info.type == AppType) {
-            foreach(Apps* app, _appList) {
-                if (!_allowDowngrades && info.packageid == app->packageId()) {
-                    if (isVersionNewer(app->version(), info.version, true)) {
-                        setNewLine(QString("%1 was skipped. Version %2 already installed").arg(QFileInfo(info.name).completeBaseName()).arg(app->version()));
-                        info.type = NotInstallableType;
-                    }
-
-                    break;
-                }
+            const Apps* installed = installedApp(info.packageid);
+            if (!_allowDowngrades && installed != nullptr && installed->packedVersion().isNewerThan(info.packedVersion, true)) {
+                setNewLine(QString("%1 was skipped. Version %2 already installed").arg(QFileInfo(info.name).completeBaseName()).arg(installed->version()));
+                info.type = NotInstallableType;
             }
         }
         if (info.type != NotInstallableType)
@@ -956,6 +953,7 @@ void InstallNet::restoreReply()
                     // About to get the apps
                     _appList.clear();
                     _appRemList.clear();
+                    _installedApps.clear();
                 } else if (name == "Application") {
                     Apps* newApp = new Apps();
                     while(!xml.atEnd())
@@ -996,9 +994,12 @@ void InstallNet::restoreReply()
                         } else if (xml.isEndElement() && xml.name() == "Application")
                             break;
                     }
-                    if (newApp->type() != "")
+                    if (newApp->type() != "") {
                         _appList.append(newApp);
-                    else
+                        // The first listing of a package is the one that counts
+                        if (!_installedApps.contains(newApp->packageId()))
+                            _installedApps.insert(newApp->packageId(), newApp);
+                    } else
                         _appRemList.append(newApp);
                     if (newApp->type() == "os") {
                         _knownConnectedOSType = newApp->name().split("os.").last().remove(".desktop").replace("verizon", "factory").replace("qc8974.factory_sfi","qc8960.factory_sfi_hybrid_qc8974");
@@ -1172,12 +1173,13 @@ void InstallNet::restoreReply()
                 setCurInstallName(QFileInfo(info.name).completeBaseName());
             }
 
+            QIODevice* upload = Bandwidth::wrap(compressedFile, Bandwidth::Install);
             if (info.type == RadioType)
-                reply = manager->post(setData("update.cgi?type=radio", "octet-stream"), compressedFile);
+                reply = manager->post(setData("update.cgi?type=radio", "octet-stream"), upload);
             else
-                reply = manager->post(setData("update.cgi?type=bar", "octet-stream"), compressedFile);
+                reply = manager->post(setData("update.cgi?type=bar", "octet-stream"), upload);
 
-            compressedFile->setParent(reply);
+            upload->setParent(reply);
             connect(reply, SIGNAL(error(QNetworkReply::NetworkError)),
                     this, SLOT(restoreError(QNetworkReply::NetworkError)));
             connect(reply, SIGNAL(uploadProgress(qint64,qint64)), this, SLOT(installProgress(qint64,qint64)));
@@ -1251,8 +1253,9 @@ void InstallNet::restoreReply()
                             request = setData("update.cgi?type=bar", "octet-stream");
                         request.setHeader(QNetworkRequest::ContentLengthHeader, compressedFile->size());
                         request.setAttribute(QNetworkRequest::DoNotBufferUploadDataAttribute, true);
-                        reply = manager->post(request, compressedFile);
-                        compressedFile->setParent(reply);
+                        QIODevice* upload = Bandwidth::wrap(compressedFile, Bandwidth::Install);
+                        reply = manager->post(request, upload);
+                        upload->setParent(reply);
                         connect(reply, SIGNAL(uploadProgress(qint64,qint64)), this, SLOT(installProgress(qint64,qint64)));
                     }
                 }
@@ -1327,10 +1330,9 @@ void InstallNet::restoreReply()
             newInfo.setPermissions(QFileDevice::Permission(0x7774));
             _zipFile->open(QIODevice::WriteOnly, newInfo);
             connect(reply, SIGNAL(downloadProgress(qint64,qint64)),this, SLOT(backupProgress(qint64, qint64)));
-            connect(reply, &QNetworkReply::readyRead, [=]() {
-                _zipFile->write(reply->readAll());
-            });
-            connect(reply, SIGNAL(finished()), this, SLOT(backupFileFinish()));
+            Bandwidth::instance()->stream(reply, Bandwidth::Backup,
+                                          [=](const QByteArray& data) { _zipFile->write(data); },
+                                          [=]() { backupFileFinish(); });
             connect(reply, SIGNAL(error(QNetworkReply::NetworkError)),
                     this, SLOT(restoreError(QNetworkReply::NetworkError)));
         } else {
@@ -1413,10 +1415,9 @@ void InstallNet::restoreReply()
                     QuaZipNewInfo newInfo("Archive/" + _back.curMode() + ".tar");
                     newInfo.setPermissions(QFileDevice::Permission(0x7774));
                     _zipFile->open(QIODevice::WriteOnly, newInfo);
-                    connect(reply, &QNetworkReply::readyRead, [=]() {
-                        _zipFile->write(reply->readAll());
-                    });
-                    connect(reply, SIGNAL(finished()), this, SLOT(backupFileFinish()));
+                    Bandwidth::instance()->stream(reply, Bandwidth::Backup,
+                                                  [=](const QByteArray& data) { _zipFile->write(data); },
+                                                  [=]() { backupFileFinish(); });
                     connect(reply, SIGNAL(downloadProgress(qint64,qint64)),this, SLOT(backupProgress(qint64, qint64)));
                 }
                 else {
@@ -1464,8 +1465,9 @@ void InstallNet::restoreSendFile() {
     QNetworkRequest request = setData("backup.cgi?action=restore&type="+_back.curMode()+"&size="+_back.curMaxSize(), "octet-stream");
     request.setHeader(QNetworkRequest::ContentLengthHeader, _zipFile->size());
     request.setAttribute(QNetworkRequest::DoNotBufferUploadDataAttribute, true);
-    reply = manager->post(request, _zipFile);
-    _zipFile->setParent(reply);
+    QIODevice* upload = Bandwidth::wrap(_zipFile, Bandwidth::Backup);
+    reply = manager->post(request, upload);
+    upload->setParent(reply);
     connect(reply, SIGNAL(error(QNetworkReply::NetworkError)),
             this, SLOT(restoreError(QNetworkReply::NetworkError)));
     connect(reply, SIGNAL(uploadProgress(qint64,qint64)), this, SLOT(restoreProgress(qint64, qint64)));
@@ -47,6 +47,7 @@ struct BarInfo {
     QString version;
     QString packageid;
     BarType type;
+    PackedVersion packedVersion;
 };
 
 class SslNetworkAccessManager : public QNetworkAccessManager
@@ -134,6 +135,8 @@ public:
     QQmlListProperty<Apps> appList();
     QQmlListProperty<Apps> backAppList();
     QList<Apps*> appQList() { return _appList; }
+    // The installed copy of a package, or nullptr if it isn't installed
+    const Apps* installedApp(const QString& packageId) const { return _installedApps.value(packageId, nullptr); }
     int appCount() const { return _appList.count(); }
     BackupInfo* back();
     QString backStatus() const;
@@ -276,4 +279,6 @@ private:
     QuaZipFile* _zipFile;
     QList<Apps*> _appList;
     QList<Apps*> _appRemList;
+    // packageId -> entry of _appList
+    QHash<QString, Apps*> _installedApps;
 };
@@ -0,0 +1,178 @@
+// Copyright (C) 2014 Sacha Refshauge
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 3.0.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 3.0 for more details.
+
+// A copy of the GPL 3.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official GIT repository and contact information can be found at
+// http://github.com/xsacha/Sachesi
+
+#include "linkverifier.h"
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QTextStream>
+#include <QTimer>
+
+LinkVerifier::LinkVerifier(QNetworkAccessManager* manager, QObject* parent)
+    : QObject(parent)
+    , _manager(manager)
+    , _cacheDirty(false)
+{
+    loadCache();
+}
+
+LinkVerifier::~LinkVerifier() {
+    cancel();
+    saveCache();
+}
+
+QString LinkVerifier::cachePath() {
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/verified.txt";
+}
+
+// One line per link: status, length, time checked and the url
+void LinkVerifier::loadCache() {
+    QFile file(cachePath());
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+        return;
+    QTextStream in(&file);
+    while (!in.atEnd()) {
+        QStringList parts = in.readLine().split(' ');
+        if (parts.count() != 4)
+            continue;
+        VerifyResult result = { parts[0].toInt(), parts[1].toLongLong(), parts[2].toLongLong() };
+        _cache.insert(parts[3], result);
+    }
+}
+
+void LinkVerifier::saveCache() {
+    if (!_cacheDirty)
+        return;
+    QDir().mkpath(QFileInfo(cachePath()).absolutePath());
+    QSaveFile file(cachePath());
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text))
+        return;
+    qint64 now = QDateTime::currentDateTime().toTime_t();
+    QTextStream out(&file);
+    for (QHash<QString, VerifyResult>::const_iterator it = _cache.constBegin(); it != _cache.constEnd(); ++it) {
+        // Expired entries are left behind
+        if (now - it->checked > VERIFY_MAX_AGE_FOUND)
+            continue;
+        out << it->status << " " << it->length << " " << it->checked << " " << it.key() << "\n";
+    }
+    out.flush();
+    if (file.commit())
+        _cacheDirty = false;
+}
+
+bool LinkVerifier::cached(const QString& url, VerifyResult* result) const {
+    QHash<QString, VerifyResult>::const_iterator it = _cache.constFind(url);
+    if (it == _cache.constEnd())
+        return false;
+    qint64 age = QDateTime::currentDateTime().toTime_t() - it->checked;
+    if (age < 0 || age > (it->found() ? VERIFY_MAX_AGE_FOUND : VERIFY_MAX_AGE_MISSING))
+        return false;
+    *result = it.value();
+    return true;
+}
+
+void LinkVerifier::verify(const QString& url, Callback callback) {
+    bool known = _callbacks.contains(url);
+    _callbacks.insert(url, callback);
+    // Already queued or running, it gets answered with the rest
+    if (known)
+        return;
+
+    VerifyResult result;
+    if (cached(url, &result)) {
+        if (_ready.isEmpty())
+            QTimer::singleShot(0, this, SLOT(deliverCached()));
+        _ready.append(url);
+        return;
+    }
+    _queue.append(url);
+    startNext();
+}
+
+void LinkVerifier::startNext() {
+    while (!_queue.isEmpty() && _running.count() < VERIFY_CONCURRENCY) {
+        QString url = _queue.takeFirst();
+        QNetworkReply* reply = _manager->head(QNetworkRequest(url));
+        _running.insert(reply, url);
+
+        QTimer* timeout = new QTimer(reply);
+        timeout->setSingleShot(true);
+        connect(timeout, &QTimer::timeout, this, [=]() {
+            VerifyResult result = { 0, 0, 0 };
+            finish(reply, result, false);
+        });
+        timeout->start(VERIFY_TIMEOUT);
+
+        connect(reply, &QNetworkReply::finished, this, [=]() {
+            VerifyResult result;
+            result.status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+            result.length = reply->header(QNetworkRequest::ContentLengthHeader).toLongLong();
+            result.checked = QDateTime::currentDateTime().toTime_t();
+            // Anything without an HTTP answer is worth asking again next time
+            finish(reply, result, result.status != 0);
+        });
+    }
+}
+
+void LinkVerifier::finish(QNetworkReply* reply, const VerifyResult& result, bool cache) {
+    if (!_running.contains(reply))
+        return;
+    QString url = _running.take(reply);
+    reply->disconnect(this);
+    reply->abort();
+    reply->deleteLater();
+    if (cache) {
+        _cache.insert(url, result);
+        _cacheDirty = true;
+    }
+    startNext();
+    deliver(url, result);
+    if (_running.isEmpty())
+        saveCache();
+}
+
+void LinkVerifier::deliver(const QString& url, const VerifyResult& result) {
+    // Callbacks may verify more links or cancel, so work on a copy
+    QList<Callback> callbacks = _callbacks.values(url);
+    _callbacks.remove(url);
+    // QMultiHash gives the most recent first
+    for (int i = callbacks.count() - 1; i >= 0; i--)
+        callbacks.at(i)(result);
+}
+
+void LinkVerifier::deliverCached() {
+    QStringList ready = _ready;
+    _ready.clear();
+    foreach (QString url, ready)
+        deliver(url, _cache.value(url));
+}
+
+void LinkVerifier::cancel() {
+    _ready.clear();
+    _queue.clear();
+    _callbacks.clear();
+    QList<QNetworkReply*> replies = _running.keys();
+    _running.clear();
+    foreach (QNetworkReply* reply, replies) {
+        reply->disconnect(this);
+        reply->abort();
+        reply->deleteLater();
+    }
+}
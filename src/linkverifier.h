@@ -0,0 +1,80 @@
+// Copyright (C) 2014 Sacha Refshauge
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 3.0.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 3.0 for more details.
+
+// A copy of the GPL 3.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official GIT repository and contact information can be found at
+// http://github.com/xsacha/Sachesi
+
+#pragma once
+
+#include <QObject>
+#include <QHash>
+#include <QList>
+#include <QStringList>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <functional>
+
+// How many HEAD requests are in flight at once. Qt keeps this many connections open per host.
+#define VERIFY_CONCURRENCY 6
+// A probe that takes longer than this (ms) is given up on
+#define VERIFY_TIMEOUT 15000
+// How long a result is trusted (seconds). Files that exist don't go away, missing ones might appear.
+#define VERIFY_MAX_AGE_FOUND (30 * 24 * 60 * 60)
+#define VERIFY_MAX_AGE_MISSING (24 * 60 * 60)
+
+struct VerifyResult {
+    int status;     // HTTP status, or 0 if there was no answer
+    qint64 length;  // Content-Length
+    qint64 checked; // When, in seconds since epoch
+    bool found() const { return status == 200 || (status > 300 && status <= 308); }
+};
+
+// Checks that download links exist and how big they are, with HEAD requests.
+// Requests for the same link are answered together and results are cached on disk,
+// so verifying a release that was already verified doesn't touch the network.
+class LinkVerifier : public QObject {
+    Q_OBJECT
+public:
+    typedef std::function<void(const VerifyResult&)> Callback;
+
+    LinkVerifier(QNetworkAccessManager* manager, QObject* parent = 0);
+    ~LinkVerifier();
+
+    // The callback is always called later, from the event loop, unless cancel() comes first
+    void verify(const QString& url, Callback callback);
+    // Forgets every callback and stops all probes
+    void cancel();
+    int pending() const { return _callbacks.count(); }
+
+    static QString cachePath();
+
+private slots:
+    void deliverCached();
+
+private:
+    void startNext();
+    void finish(QNetworkReply* reply, const VerifyResult& result, bool cache);
+    void deliver(const QString& url, const VerifyResult& result);
+    bool cached(const QString& url, VerifyResult* result) const;
+    void loadCache();
+    void saveCache();
+
+    QNetworkAccessManager* _manager;
+    QStringList _queue;
+    QStringList _ready; // Answered from the cache, waiting for the event loop
+    QHash<QNetworkReply*, QString> _running;
+    QMultiHash<QString, Callback> _callbacks;
+    QHash<QString, VerifyResult> _cache;
+    bool _cacheDirty;
+};
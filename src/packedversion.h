@@ -0,0 +1,77 @@
+// Copyright (C) 2014 Sacha Refshauge
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 3.0.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 3.0 for more details.
+
+// A copy of the GPL 3.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official GIT repository and contact information can be found at
+// http://github.com/xsacha/Sachesi
+
+#pragma once
+
+#include <QString>
+
+// A dotted version such as 10.3.2.2876, packed 32 bits per part in to two integers so two
+// versions compare without splitting strings. Parse it once where a version is read, then
+// compare as often as needed. Every part gets the full range toInt() had, so app versions
+// with large build numbers still order correctly. A part toInt() would have refused,
+// including one past INT_MAX, counts as 0 just as it did there.
+// Only the first four parts count. Fewer than four parts make it invalid.
+class PackedVersion {
+public:
+    Q_DECL_CONSTEXPR PackedVersion() : _high(0), _low(0), _valid(false) {}
+    Q_DECL_CONSTEXPR PackedVersion(quint32 major, quint32 minor, quint32 patch, quint32 build)
+        : _high(((quint64)major << 32) | minor), _low(((quint64)patch << 32) | build), _valid(true) {}
+    explicit PackedVersion(const QString& version) : _high(0), _low(0), _valid(false) {
+        int part = 0;
+        quint64 number = 0;
+        bool digits = true;
+        for (int i = 0; i <= version.length(); i++) {
+            if (i == version.length() || version.at(i) == '.') {
+                if (part < 4 && digits && number <= 0x7FFFFFFF) {
+                    quint64& half = (part < 2) ? _high : _low;
+                    half |= number << (part % 2 ? 0 : 32);
+                }
+                part++;
+                number = 0;
+                digits = true;
+            } else if (version.at(i).isDigit()) {
+                // Stop growing once it is too big, it is 0 either way
+                if (number <= 0x7FFFFFFF)
+                    number = number * 10 + version.at(i).digitValue();
+            } else {
+                digits = false;
+            }
+        }
+        _valid = part >= 4;
+    }
+
+    Q_DECL_CONSTEXPR bool isValid() const { return _valid; }
+    QString toString() const {
+        return QString("%1.%2.%3.%4").arg(_high >> 32).arg(_high & 0xFFFFFFFF).arg(_low >> 32).arg(_low & 0xFFFFFFFF);
+    }
+
+    // The same rule as isVersionNewer: an invalid version is never newer
+    Q_DECL_CONSTEXPR bool isNewerThan(const PackedVersion& other, bool orSame) const {
+        return _valid && (_high > other._high || (_high == other._high && (_low > other._low || (orSame && _low == other._low))));
+    }
+
+    Q_DECL_CONSTEXPR bool operator==(const PackedVersion& other) const { return _high == other._high && _low == other._low && _valid == other._valid; }
+    Q_DECL_CONSTEXPR bool operator!=(const PackedVersion& other) const { return !(*this == other); }
+    Q_DECL_CONSTEXPR bool operator<(const PackedVersion& other) const {
+        return _high < other._high || (_high == other._high && (_low < other._low || (_low == other._low && _valid < other._valid)));
+    }
+
+private:
+    quint64 _high; // major and minor
+    quint64 _low;  // patch and build
+    bool _valid;
+};
@@ -71,22 +71,6 @@ QString capPath(bool temp) {
 #endif
 }
 
-bool isVersionNewer(QString first, QString second, bool orSame) {
-    QStringList firstVer = first.split('.');
-    QStringList secondVer = second.split('.');
-    if (firstVer.count() < 4)
-        return false;
-    for (int i = 0; i < 4; i++) {
-        int newBuild = firstVer.at(i).toInt();
-        int oldBuild = secondVer.at(i).toInt();
-        if (newBuild > oldBuild)
-            return true;
-        if (newBuild < oldBuild)
-            return false;
-    }
-    return orSame;
-}
-
 #ifndef BLACKBERRY
 QFileDialog* selectFiles(QString title, QString dir, QString nameString, QString nameExt) {
     QFileDialog* finder = new QFileDialog();
@@ -103,23 +87,6 @@ QFileDialog* selectFiles(QString title, QString dir, QString nameString, QString
 }
 #endif
 
-QString getSaveDir() {
-#ifdef BLACKBERRY
-#if QT_VERSION < QT_VERSION_CHECK(5, 0, 0)
-    return "/accounts/1000/shared/misc/Sachesi/";
-#else
-    return QStandardPaths::standardLocations(QStandardPaths::GenericDataLocation).first() + "/Sachesi/";
-#endif
-#else
-    QString writable = QDir::currentPath() + "/";
-
-    if (QFileInfo(writable).isWritable())
-        return writable;
-
-    return QStandardPaths::writableLocation(QStandardPaths::DownloadLocation);
-#endif
-}
-
 bool checkCurPath()
 {
     QDir dir;
@@ -29,6 +29,8 @@
 #endif
 #include <QSettings>
 #include <QUrl>
+#include "packedversion.h"
+#include "portscore.h"
 
 #if QT_VERSION < QT_VERSION_CHECK(5, 0, 0)
 #include <QUrl>
@@ -80,11 +82,9 @@ QString capPath(bool temp = false);
 #ifndef BLACKBERRY
 QFileDialog* selectFiles(QString title, QString dir, QString nameString, QString nameExt);
 #endif
-QString getSaveDir();
 bool checkCurPath();
 void openFile(QString name);
 void writeDisplayFile(QString type, QString writeText);
-bool isVersionNewer(QString first, QString second, bool orSame);
 
 // These may not be entirely necessary but there have been issues in the past
 #define qSafeFree(x) \
@@ -0,0 +1,61 @@
+// Copyright (C) 2014 Sacha Refshauge
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 3.0.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 3.0 for more details.
+
+// A copy of the GPL 3.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official GIT repository and contact information can be found at
+// http://github.com/xsacha/Sachesi
+
+#include "portscore.h"
+#include "packedversion.h"
+#include <QDir>
+#include <QFileInfo>
+#include <QSettings>
+#include <QStandardPaths>
+#include <QUrl>
+
+QString getSaveDir() {
+#ifdef BLACKBERRY
+#if QT_VERSION < QT_VERSION_CHECK(5, 0, 0)
+    return "/accounts/1000/shared/misc/Sachesi/";
+#else
+    return QStandardPaths::standardLocations(QStandardPaths::GenericDataLocation).first() + "/Sachesi/";
+#endif
+#else
+    QString writable = QDir::currentPath() + "/";
+
+    if (QFileInfo(writable).isWritable())
+        return writable;
+
+    return QStandardPaths::writableLocation(QStandardPaths::DownloadLocation);
+#endif
+}
+
+// For one-off comparisons. Anything compared repeatedly should keep its PackedVersion.
+bool isVersionNewer(QString first, QString second, bool orSame) {
+    return PackedVersion(first).isNewerThan(PackedVersion(second), orSame);
+}
+
+QString serverUrl(const QString& url) {
+    // Read once: it is only for testing against a local server
+    static QString server = QSettings("Qtness","Sachesi").value("serverOverride").toString();
+    if (server.isEmpty())
+        return url;
+    QUrl original(url);
+    QString redirected = server;
+    if (redirected.endsWith('/'))
+        redirected.chop(1);
+    redirected += "/" + original.host() + original.path();
+    if (original.hasQuery())
+        redirected += "?" + original.query();
+    return redirected;
+}
@@ -0,0 +1,28 @@
+// Copyright (C) 2014 Sacha Refshauge
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 3.0.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 3.0 for more details.
+
+// A copy of the GPL 3.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official GIT repository and contact information can be found at
+// http://github.com/xsacha/Sachesi
+
+#pragma once
+
+// The parts of ports.h that only need QtCore, so tools without a GUI can share them
+
+#include <QString>
+
+QString getSaveDir();
+bool isVersionNewer(QString first, QString second, bool orSame);
+// Sends a request for one of the BlackBerry servers to 'serverOverride' from the settings
+// instead, if it is set. The original host becomes the first part of the path.
+QString serverUrl(const QString& url);
@@ -30,6 +30,7 @@
 #endif
 #include "carrierinfo.h"
 #include "translator.h"
+#include "bandwidth.h"
 #ifdef BOOTLOADER_ACCESS
 #include "boot.h"
 #endif
@@ -113,6 +114,7 @@ Q_DECL_EXPORT int main(int argc, char *argv[])
     context->setContextProperty("p", &p); // MainNet
     context->setContextProperty("scanner", &scanner);
     context->setContextProperty("download", p.currentDownload);
+    context->setContextProperty("bandwidth", Bandwidth::instance());
     context->setContextProperty("carrierinfo",  &info);
     context->setContextProperty("translator",  &translator);
 
@@ -121,6 +123,8 @@ Q_DECL_EXPORT int main(int argc, char *argv[])
     qmlRegisterType<BackupInfo>("BackupTools", 1, 0, "BackupInfo");
 #endif
     qmlRegisterType<Apps>();
+    qmlRegisterType<AppModel>();
+    qmlRegisterType<ScanResultModel>();
     qmlRegisterType<DeviceInfo>();
     qmlRegisterType<DiscoveredRelease>();
 
@@ -0,0 +1,185 @@
+// Copyright (C) 2014 Sacha Refshauge
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 3.0.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 3.0 for more details.
+
+// A copy of the GPL 3.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official GIT repository and contact information can be found at
+// http://github.com/xsacha/Sachesi
+
+#include "linkgenerator.h"
+#include "ports.h"
+
+LinkGenerator::LinkGenerator(QNetworkAccessManager* manager, QObject* parent)
+    : QObject(parent)
+    , _verifier(new LinkVerifier(manager, this))
+    , _done(0)
+{
+    QSettings settings("Qtness","Sachesi");
+    _radioSpread = qBound(0, settings.value("linkRadioSpread", LINK_RADIO_SPREAD).toInt(), LINK_MAX_RADIO_SPREAD);
+}
+
+static void addType(QList<QPair<QString, QStringList> >* types, const QString& type, const QStringList& devices) {
+    if (type.isEmpty())
+        return;
+    for (int i = 0; i < types->count(); i++) {
+        if ((*types)[i].first == type) {
+            (*types)[i].second.append(devices);
+            return;
+        }
+    }
+    types->append(qMakePair(type, devices));
+}
+
+// dev[] lists the device names of each row and then their HWIDs. The rows don't line up
+// with DeviceFamily: Dev Alpha mixes OMAP and Q10 boards, and Ontario runs the Q30 builds.
+static DeviceFamily deviceFamily(int row, int device) {
+    static const DeviceFamily rows[] = { Z30Family, OMAPFamily, Z10Family, Z3Family, Q30Family, Q10Family, UnknownFamily, Q30Family };
+    if (row == 6)
+        return device < 2 ? OMAPFamily : Q10Family; // Alpha A and B, Alpha C
+    return row < (int)(sizeof(rows) / sizeof(rows[0])) ? rows[row] : UnknownFamily;
+}
+
+QList<QPair<QString, QStringList> > LinkGenerator::osTypes() {
+    QList<QPair<QString, QStringList> > types;
+    int rows = sizeof(dev) / sizeof(dev[0]) / 2;
+    for (int r = 0; r < rows; r++) {
+        for (int d = 0; d < dev[r*2].count(); d++) {
+            DeviceFamily family = deviceFamily(r, d);
+            addType(&types, getFamilyFromDevice(family, false).first, QStringList() << dev[r*2].at(d));
+            // Some Q30 builds use their own OS
+            addType(&types, getFamilyFromDevice(family, true).first, QStringList() << dev[r*2].at(d));
+        }
+    }
+    return types;
+}
+
+QList<QPair<QString, QStringList> > LinkGenerator::radioTypes() {
+    QList<QPair<QString, QStringList> > types;
+    int rows = sizeof(dev) / sizeof(dev[0]) / 2;
+    for (int r = 0; r < rows; r++) {
+        for (int d = 0; d < dev[r*2].count(); d++)
+            addType(&types, getFamilyFromDevice(deviceFamily(r, d), false).second, QStringList() << dev[r*2].at(d));
+    }
+    return types;
+}
+
+static QString barUrl(const QString& baseUrl, const QString& hwType, const QString& version) {
+    return baseUrl + "/" + hwType + "-" + version + "-nto+armle-v7+signed.bar";
+}
+
+QList<LinkCandidate> LinkGenerator::candidates(const QString& baseUrl, const QString& osVersion, int radioSpread) {
+    QList<LinkCandidate> list;
+    QStringList parts = osVersion.split('.');
+    if (parts.count() != 4)
+        return list;
+    LinkCandidate link;
+    link.status = 0;
+    link.size = -1;
+
+    typedef QPair<QString, QStringList> Type;
+    foreach (Type type, osTypes()) {
+        link.version = osVersion;
+        link.kind = "Debrick";
+        link.hwType = type.first + ".desktop";
+        link.url = barUrl(baseUrl, link.hwType, link.version);
+        list.append(link);
+        link.kind = "Core";
+        link.hwType = type.first;
+        link.url = barUrl(baseUrl, link.hwType, link.version);
+        list.append(link);
+    }
+
+    // The radio is usually a build or so after the OS, but not always
+    int build = parts.last().toInt();
+    QString prefix = QStringList(parts.mid(0, 3)).join(".") + ".";
+    foreach (Type type, radioTypes()) {
+        for (int offset = -radioSpread; offset <= radioSpread; offset++) {
+            if (build + offset < 0)
+                continue;
+            link.kind = "Radio";
+            link.hwType = type.first;
+            link.version = prefix + QString::number(build + offset);
+            link.url = barUrl(baseUrl, link.hwType, link.version);
+            list.append(link);
+        }
+    }
+    return list;
+}
+
+void LinkGenerator::generate(const QString& baseUrl, const QString& osVersion, const QString& srVersion) {
+    cancel();
+    _osVersion = osVersion;
+    _srVersion = srVersion;
+    _candidates = candidates(baseUrl, osVersion, _radioSpread);
+    _done = 0;
+    emit progressChanged();
+    if (_candidates.isEmpty()) {
+        emit finished(report());
+        return;
+    }
+    // The verifier runs a few at a time and answers repeats from its cache
+    for (int i = 0; i < _candidates.count(); i++) {
+        _verifier->verify(_candidates.at(i).url, [this, i](const VerifyResult& result) {
+            _candidates[i].status = result.status;
+            _candidates[i].size = (result.status == 200 && result.length > 0) ? result.length : -1;
+            _done++;
+            emit progressChanged();
+            if (_done == _candidates.count())
+                emit finished(report());
+        });
+    }
+}
+
+void LinkGenerator::cancel() {
+    _verifier->cancel();
+    _candidates.clear();
+    _done = 0;
+}
+
+QString LinkGenerator::report() const {
+    QString text = QString("Confirmed OS and Radio links for SR %1 (OS %2)\n").arg(_srVersion).arg(_osVersion);
+    QString osText, radioText, lastOs;
+    typedef QPair<QString, QStringList> Type;
+    QList<Type> osList = osTypes(), radioList = radioTypes();
+    foreach (const LinkCandidate& link, _candidates) {
+        if (!link.found())
+            continue;
+        QString line = link.url;
+        if (link.size > 0)
+            line += QString(" (%1 MB)").arg(link.size / 1024.0 / 1024.0, 0, 'f', 1);
+        if (link.kind == "Radio") {
+            QStringList devices;
+            foreach (Type type, radioList)
+                if (type.first == link.hwType)
+                    devices = type.second;
+            radioText.append(QString("\n%1 %2: %3\n%4\n").arg(link.hwType).arg(link.version).arg(devices.join(", ")).arg(line));
+        } else {
+            // Debrick and Core of the same OS go under one heading
+            QString hwType = link.hwType;
+            hwType.remove(".desktop");
+            if (hwType != lastOs) {
+                lastOs = hwType;
+                foreach (Type type, osList)
+                    if (type.first == hwType)
+                        osText.append(QString("\n%1: %2\n").arg(hwType).arg(type.second.join(", ")));
+            }
+            osText.append(link.kind + ": " + line + "\n");
+        }
+    }
+    if (osText.isEmpty() && radioText.isEmpty())
+        return text + "\nNone of the links were found.\n";
+    if (!osText.isEmpty())
+        text.append("\n* Operating Systems *\n" + osText);
+    if (!radioText.isEmpty())
+        text.append("\n\n* Radios *\n" + radioText);
+    return text;
+}
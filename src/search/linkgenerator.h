@@ -0,0 +1,74 @@
+// Copyright (C) 2014 Sacha Refshauge
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 3.0.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 3.0 for more details.
+
+// A copy of the GPL 3.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official GIT repository and contact information can be found at
+// http://github.com/xsacha/Sachesi
+
+#pragma once
+
+#include <QObject>
+#include <QList>
+#include <QStringList>
+#include "linkverifier.h"
+
+// Radios are tried from this many builds below the OS build to this many above, unless changed in the settings
+#define LINK_RADIO_SPREAD 3
+#define LINK_MAX_RADIO_SPREAD 20
+
+// A file that may be part of a release
+struct LinkCandidate {
+    QString hwType; // eg. qc8960.factory_sfi
+    QString kind; // Debrick, Core or Radio
+    QString version;
+    QString url;
+    int status; // HTTP status of the check, 0 until checked
+    qint64 size; // -1 when the server didn't say
+    bool found() const { return status == 200 || (status > 300 && status <= 308); }
+};
+
+// Works out every OS and radio file a release could have, from the device table and the
+// families in getFamilyFromDevice, and checks which of them are on the server.
+class LinkGenerator : public QObject {
+    Q_OBJECT
+public:
+    LinkGenerator(QNetworkAccessManager* manager, QObject* parent = 0);
+
+    // The OS names and radio names every device family uses, with the devices that use them
+    static QList<QPair<QString, QStringList> > osTypes();
+    static QList<QPair<QString, QStringList> > radioTypes();
+    static QList<LinkCandidate> candidates(const QString& baseUrl, const QString& osVersion, int radioSpread);
+
+    bool running() const { return _done < _candidates.count(); }
+    int done() const { return _done; }
+    int total() const { return _candidates.count(); }
+    int radioSpread() const { return _radioSpread; }
+
+    // Checks every candidate and then emits finished() with a list of the ones that exist
+    void generate(const QString& baseUrl, const QString& osVersion, const QString& srVersion);
+    void cancel();
+
+signals:
+    void progressChanged();
+    void finished(QString report);
+
+private:
+    QString report() const;
+
+    LinkVerifier* _verifier;
+    QList<LinkCandidate> _candidates;
+    int _done;
+    int _radioSpread;
+    QString _osVersion;
+    QString _srVersion;
+};
@@ -31,18 +31,46 @@ MainNet::MainNet(InstallNet *installer, QObject* parent)
 {
     manager = new QNetworkAccessManager();
     currentDownload = new DownloadInfo();
+    _scanEngine = new ScanEngine(this);
+    _updateApps = new AppModel(this);
+    connect(_updateApps, &AppModel::countsChanged, this, &MainNet::updateCheckedCountChanged);
+    _parseId = 0;
+    _parseThread = new QThread(this);
+    _parser = new UpdateParser();
+    _parser->moveToThread(_parseThread);
+    connect(_parseThread, &QThread::finished, _parser, &QObject::deleteLater);
+    connect(_parser, &UpdateParser::parsed, this, &MainNet::showFirmwareData);
+    _parseThread->start();
+    connect(currentDownload, &DownloadInfo::streamOpened, this, &MainNet::extractStream);
+    DownloadPolicy policy;
+    policy.mismatch = [](const QString& fileName, const QString& issue) {
+        Q_UNUSED(fileName);
+        return QMessageBox::warning(nullptr, "Issue", issue + " Ignore the warning or discard the file to try again?",
+                                    QMessageBox::Discard, QMessageBox::Ignore) == QMessageBox::Discard
+                ? DownloadPolicy::Discard : DownloadPolicy::Keep;
+    };
+    policy.error = [](const QString& error) {
+        QMessageBox::information(nullptr, "Error", error);
+    };
+    policy.finished = [](const QString& baseDir) {
+        QDesktopServices::openUrl(QUrl(baseDir));
+    };
+    currentDownload->setPolicy(policy);
     if (_i != nullptr)
         connect(_i, SIGNAL(appListChanged()), this, SLOT(newDeviceConnected()));
 }
 
 MainNet::~MainNet()
 {
+    _parseThread->quit();
+    _parseThread->wait();
 }
 
 void MainNet::splitConnectStart() {
     connect(splitter, SIGNAL(finished()), splitThread, SLOT(quit()));
     connect(splitter, SIGNAL(finished()), this, SLOT(cancelSplit()));
     connect(splitter, SIGNAL(progressChanged(int)), this, SLOT(setSplitProgress(int)));
+    connect(splitter, SIGNAL(error(QString)), this, SLOT(splitError(QString)));
     connect(splitThread, SIGNAL(finished()), splitter, SLOT(deleteLater()));
     connect(splitThread, SIGNAL(finished()), splitThread, SLOT(deleteLater()));
     splitThread->start();
@@ -169,8 +197,35 @@ void MainNet::cancelSplit()
     emit splittingChanged();
 }
 
+void MainNet::splitError(QString error)
+{
+    _error = error;
+    emit errorChanged();
+}
+
+// Extracts a download as it arrives. Everything that can be extracted is.
+void MainNet::extractStream(DownloadStream* stream, QString fileName)
+{
+    if (_splitting != SplittingIdle) {
+        delete stream;
+        return;
+    }
+    _splitting = ExtractingImage; emit splittingChanged();
+    splitThread = new QThread;
+    splitter = new Splitter(stream, fileName);
+    splitter->extractTypes = FS_RCFS | FS_QNX6 | FS_IFS;
+    _splitStream = stream;
+    stream->moveToThread(splitThread);
+    splitter->moveToThread(splitThread);
+    connect(splitThread, SIGNAL(started()), splitter, SLOT(processExtractStream()));
+    splitConnectStart();
+}
+
 void MainNet::abortSplit()
 {
+    // The splitter may be waiting on data that is never going to come
+    if (!_splitStream.isNull())
+        _splitStream->cancel();
     emit splitter->killSplit();
     cancelSplit();
 }
@@ -248,6 +303,19 @@ void MainNet::decompressRCFS(const QUrl &fileUrl, const QString &outputPath) {
     }
 }
 
+void MainNet::createQNX6Image(const QUrl &folderUrl)
+{
+    QString folderPath = folderUrl.toLocalFile();
+    if (folderPath.isEmpty())
+        return;
+    _splitting = CreatingImage; emit splittingChanged();
+    splitThread = new QThread;
+    splitter = new Splitter(folderPath);
+    splitter->moveToThread(splitThread);
+    connect(splitThread, SIGNAL(started()), splitter, SLOT(processCreateQNX6()));
+    splitConnectStart();
+}
+
 void MainNet::grabLinks(int downloadDevice)
 {
     _downloadDevice = downloadDevice;
@@ -297,7 +365,7 @@ if (_i != nullptr) {
         }
     }
     // Refresh the names in QML
-    currentDownload->nextFile(0);
+    currentDownload->refresh();
 }
 }
 
@@ -316,14 +384,14 @@ QString MainNet::convertLinks(QString prepend)
     }
 
     QString updated;
-    foreach (Apps* app, _updateAppList) {
-        if (!app->isMarked())
+    foreach (const AppInfo& app, _updateApps->apps()) {
+        if (!app.isMarked)
             continue;
-        QString item = app->url();
+        QString item = app.url;
         if (convert) {
-            if (results.first != "" && app->type() == "os")
+            if (results.first != "" && app.type == "os")
                 item = fixVariantName(item, results.first, 0);
-            else if (results.second != "" && app->type() == "radio")
+            else if (results.second != "" && app.type == "radio")
                 item = fixVariantName(item, results.second, 1);
         }
 
@@ -340,7 +408,9 @@ void MainNet::downloadLinks(int downloadDevice)
     _downloadDevice = downloadDevice;
     // Have we been here before? Starting but ids already generated. Maybe links were verified, so skip this
     if (currentDownload->maxId == 0) {
-        currentDownload->setApps(_updateAppList, _versionRelease);
+        QList<Apps*> marked = _updateApps->toApps();
+        currentDownload->setApps(marked, _versionRelease);
+        qDeleteAll(marked);
         fixApps();
         // Did we find any apps?
         if (currentDownload->maxId == 0) {
@@ -353,7 +423,7 @@ void MainNet::downloadLinks(int downloadDevice)
     }
 }
 
-QString MainNet::NPCFromLocale(int carrier, int country) {
+QString MainNet::npcFromLocale(int carrier, int country) {
     QString homeNPC;
     homeNPC.sprintf("%03d%03d%d", carrier, country, carrier ? 30 : 60);
     return homeNPC;
@@ -373,9 +443,7 @@ unsigned int MainNet::variantCount(unsigned int device) {
 
 void MainNet::updateDetailRequest(QString delta, QString carrier, QString country, int device, int variant, int mode)
 {
-    QString up;
-    QString requestUrl = "https://csssl.berryinfra.xyz/cse/updateDetails/2.2/";
-    QString version = "2.2.1";
+    QString requestUrl = serverUrl(UPDATE_DETAILS_URL);
 
     // Blackberry doesn't return results on these servers anymore, so their usefulness is gone
     /*    switch (server)
@@ -415,18 +483,7 @@ void MainNet::updateDetailRequest(QString delta, QString carrier, QString countr
         break;
     }*/
 
-    QString homeNPC = NPCFromLocale(carrier.toInt(), country.toInt());
-
-    switch (mode)
-    {
-    case 1:
-        up = "repair";
-        break;
-    case 0:
-    default:
-        up = "upgrade";
-        break;
-    }
+    QString homeNPC = npcFromLocale(carrier.toInt(), country.toInt());
 
     // We either selected 'Any' (if there was more than one variant) or we picked a specific variant.
     int start = (variant != 0) ? (variant - 1) : 0;
@@ -436,196 +493,125 @@ void MainNet::updateDetailRequest(QString delta, QString carrier, QString countr
         setMultiscan(true);
 
     for (int i = start; i < end; i++) {
-        QString query = QString("<?xml version=\"1.0\" encoding=\"UTF-8\"?>"
-                                "<updateDetailRequest version=\"%1\" authEchoTS=\"%2\">"
-                                "<clientProperties>"
-                                "<hardware>"
-                                "<pin>0x2FFFFFB3</pin><bsn>1128121361</bsn><imei>004401139269240</imei><id>0x%3</id>"
-                                "</hardware>"
-                                "<network>"
-                                "<homeNPC>0x%4</homeNPC><iccid>89014104255505565333</iccid>"
-                                "</network>"
-                                "<software>"
-                                "<currentLocale>en_US</currentLocale><legalLocale>en_US</legalLocale>"
-                                "</software>"
-                                "</clientProperties>"
-                                "<updateDirectives><allowPatching type=\"REDBEND\">true</allowPatching><upgradeMode>%5</upgradeMode><provideDescriptions>false</provideDescriptions><provideFiles>true</provideFiles><queryType>NOTIFICATION_CHECK</queryType></updateDirectives>"
-                                "<pollType>manual</pollType>"
-                                "<resultPackageSetCriteria>"
-                                "%6"
-                                "<releaseIndependent><packageType operation=\"include\">application</packageType></releaseIndependent>"
-                                "</resultPackageSetCriteria>"
-                                "%7"
-                                "</updateDetailRequest>")
-                .arg(version) // API Version
-                .arg(QDateTime::currentMSecsSinceEpoch()) // Current time, in case it cares one day
-                .arg(hwidFromVariant(device, i)) // Search Device HWID
-                .arg(homeNPC) // Country + Carrier
-                .arg(up) // Upgrade or Repair?
-                // 2.3.0 doesn't support 'latest'. Does this mean we need to do availableBundles lookup first?
-                .arg((version == "2.3.0") ? "" : "<softwareRelease softwareReleaseVersion=\"latest\" />")
-                .arg(delta); // User installed applications (to support REDBEND patching)
+        QString query = ScanEngine::detailQuery(hwidFromVariant(device, i), homeNPC, mode, delta);
 
         _error = ""; emit errorChanged();
-        // Pass the variant in the request so it can be retrieved out-of-order
         QNetworkRequest request;
         request.setRawHeader("Content-Type", "text/xml;charset=UTF-8");
         request.setUrl(QUrl(requestUrl));
-        request.setAttribute(QNetworkRequest::CustomVerbAttribute, nameFromVariant(device, i));
-        QNetworkReply* reply = manager->post(request, query.toUtf8());
-        connect(reply, SIGNAL(error(QNetworkReply::NetworkError)),
-                this, SLOT(serverError(QNetworkReply::NetworkError)));
-        connect(reply, SIGNAL(finished()), this, SLOT(serverReply()));
+        // Keep the variant with the request so it can be retrieved out-of-order
+        QString variantName = nameFromVariant(device, i);
+        // The response is read on the parser's thread as it comes in
+        int id = _parseId++;
+        ResponseCache::instance()->post(manager, request, query.toUtf8(), this, [=](const CachedReply& reply) {
+            if (reply.error != QNetworkReply::NoError) {
+                QMetaObject::invokeMethod(_parser, "restart", Qt::QueuedConnection, Q_ARG(int, id));
+                serverError(reply.error, reply.errorString);
+                return;
+            }
+            if (!reply.streamed) {
+                QMetaObject::invokeMethod(_parser, "restart", Qt::QueuedConnection, Q_ARG(int, id));
+                QMetaObject::invokeMethod(_parser, "feed", Qt::QueuedConnection, Q_ARG(int, id), Q_ARG(QByteArray, reply.data));
+            }
+            QMetaObject::invokeMethod(_parser, "finish", Qt::QueuedConnection, Q_ARG(int, id), Q_ARG(QString, variantName));
+        }, [=](const QByteArray& chunk) {
+            QMetaObject::invokeMethod(_parser, "feed", Qt::QueuedConnection, Q_ARG(int, id), Q_ARG(QByteArray, chunk));
+        });
     }
 }
 
-void MainNet::serverReply()
+void MainNet::showFirmwareData(int id, QString variant, UpdateResult result)
 {
-    QNetworkReply *reply = (QNetworkReply *)sender();
-    QByteArray data = reply->readAll();
-    //for (int i = 0; i < data.size(); i += 3000) qDebug() << data.mid(i, 3000);
-    showFirmwareData(data, reply->request().attribute(QNetworkRequest::CustomVerbAttribute).toString());
-    sender()->deleteLater();
-}
-
-void MainNet::showFirmwareData(QByteArray data, QString variant)
-{
-    QXmlStreamReader xml(data);
-    QString ver = "";
-    QString os = "";
-    QString radio = "";
-    QString addr = "";
-    QString currentaddr = "";
-    QList<Apps*> newApps;
-    while(!xml.atEnd() && !xml.hasError()) {
-        if(xml.tokenType() == QXmlStreamReader::StartElement) {
-            if (xml.name() == "package")
-            {
-                Apps* newApp = new Apps();
-
-                // Remember: this name *can* change
-                newApp->setFriendlyName(xml.attributes().value("name").toString());
-                // Remember: this name *can* change
-                newApp->setName(xml.attributes().value("path").toString().split('/').last());
-                // Remember: this size *can* change
-                newApp->setSize(xml.attributes().value("downloadSize").toString().toInt());
-                newApp->setVersion(xml.attributes().value("version").toString());
-                newApp->setPackageId(xml.attributes().value("id").toString());
-                newApp->setChecksum(xml.attributes().value("checksum").toString());
-                QString type = xml.attributes().value("type").toString();
-                if (type == "system:os" || type == "system:desktop") {
-                    os = newApp->version();
-                    newApp->setType("os");
-                    newApp->setIsMarked(true);
-                    newApp->setIsAvailable(true);
-                    if (_i != nullptr && _i->device != nullptr) {
-                        newApp->setIsInstalled(isVersionNewer(_i->device->os, newApp->version(), true));
-                        newApp->setInstalledVersion(_i->device->os);
-                    }
-                } else if (type == "system:radio") {
-                    radio = newApp->version();
-                    newApp->setType("radio");
-                    newApp->setIsMarked(true);
-                    newApp->setIsAvailable(true);
-                    if (_i != nullptr && _i->device != nullptr) {
-                        newApp->setIsInstalled(isVersionNewer(_i->device->radio, newApp->version(), true));
-                        newApp->setInstalledVersion(_i->device->radio);
-                    }
-                } else {
-                    newApp->setType("application");
-                    if (_i != nullptr) {
-                        foreach(Apps* app, _i->appQList()) {
-                            bool isSameApp = newApp->packageId().compare(app->packageId()) == 0;
-                            if (isSameApp) {
-                                newApp->setIsInstalled(isVersionNewer(app->version(), newApp->version(), true));
-                                newApp->setInstalledVersion(app->version());
-                                break;
-                            }
-                        }
-                    }
-                }
-                // For lack of a better name, the url
-                newApp->setUrl(currentaddr + "/" + newApp->name());
-                newApp->setName(newApp->name().split("/").last());
-
-                newApps.append(newApp);
-            }
-            else if (xml.name() == "friendlyMessage")
-            {
-                _error = xml.readElementText().split(QChar('.'))[0]; emit errorChanged();
-            }
-            else if (xml.name() == "fileSet")
-            {
-                currentaddr = xml.attributes().value("url").toString();
-                if (addr == "")
-                    addr = currentaddr;
+    Q_UNUSED(id);
+    QString ver = result.release;
+    QString os = result.os;
+    QString radio = result.radio;
+    if (!result.message.isEmpty()) {
+        _error = result.message; emit errorChanged();
+    }
+    QVector<AppInfo> newApps;
+    newApps.reserve(result.packages.count());
+    PackedVersion deviceOs, deviceRadio;
+    if (_i != nullptr && _i->device != nullptr) {
+        deviceOs = PackedVersion(_i->device->os);
+        deviceRadio = PackedVersion(_i->device->radio);
+    }
+    foreach (const PackageInfo& package, result.packages) {
+        AppInfo newApp;
+        newApp.friendlyName = package.friendlyName;
+        newApp.name = package.name;
+        newApp.size = package.size;
+        newApp.version = package.version;
+        newApp.packageId = package.packageId;
+        newApp.checksum = package.checksum;
+        newApp.type = package.type;
+        newApp.url = package.url;
+        if (package.type == "os") {
+            newApp.isMarked = true;
+            if (_i != nullptr && _i->device != nullptr) {
+                newApp.isInstalled = deviceOs.isNewerThan(PackedVersion(newApp.version), true);
+                newApp.installedVersion = _i->device->os;
             }
-            else if (xml.name() == "softwareReleaseMetadata")
-            {
-                ver = xml.attributes().value("softwareReleaseVersion").toString();
+        } else if (package.type == "radio") {
+            newApp.isMarked = true;
+            if (_i != nullptr && _i->device != nullptr) {
+                newApp.isInstalled = deviceRadio.isNewerThan(PackedVersion(newApp.version), true);
+                newApp.installedVersion = _i->device->radio;
             }
-            else if (xml.name() == "bundle")
-            {
-                QString newver = xml.attributes().value("version").toString();
-                if (ver == "" || (ver.split(".").last().toInt() < newver.split(".").last().toInt()))
-                    ver = newver;
+        } else if (_i != nullptr) {
+            const Apps* installed = _i->installedApp(newApp.packageId);
+            if (installed != nullptr) {
+                newApp.isInstalled = installed->packedVersion().isNewerThan(PackedVersion(newApp.version), true);
+                newApp.installedVersion = installed->version();
             }
-            // No longer check for descriptions
-            /*else if (xml.name() == "description" && desc == "")
-            {
-                desc = xml.readElementText();
-            }*/
         }
-        xml.readNext();
+        newApps.append(newApp);
     }
     // Check if the version string is newer.
+    PackedVersion packedVer(ver);
     bool isNewer = (!_multiscan || _multiscanVersion == "");
     if (!isNewer && ver != "") {
-        isNewer = isVersionNewer(ver, _multiscanVersion, false);
+        isNewer = packedVer.isNewerThan(_multiscanNewest, false);
     }
     if (isNewer) {
         // Update software release versions
-        if (_multiscan)
+        if (_multiscan) {
             _multiscanVersion = ver;
+            _multiscanNewest = packedVer;
+        }
         _versionRelease = ver;
         if (ver == "") {
             _updateMessage = "";
         } else {
-            // Delete old list
-            if (_updateAppList.count()) {
-                foreach (Apps* app, _updateAppList) {
-                    app->disconnect(SIGNAL(isMarkedChanged()));
-                    app->deleteLater();
-                }
-                _updateAppList.clear();
-            }
-            // Put this new list up for display
-            _updateAppList = newApps;
-            // Connect every isMarkedChanged to the list signal and check if it should be marked
-            foreach (Apps* app, _updateAppList) {
-                connect(app, SIGNAL(isMarkedChanged()), this, SIGNAL(updateCheckedCountChanged()));
-
+            // Check which ones should be marked
+            QString releaseDir = getSaveDir() + "/" + _versionRelease + "/";
+            for (int i = 0; i < newApps.count(); i++) {
+                AppInfo& app = newApps[i];
                 // No need to check OS and Radio as they are variable
-                if (app->type() == "application") {
-                    bool exists = QFile(getSaveDir() + "/" + _versionRelease + "/" + app->name()).size() == app->size();
-                    app->setIsAvailable(!exists);
+                if (app.type == "application") {
+                    bool exists = QFileInfo(releaseDir + app.name).size() == app.size;
+                    app.isAvailable = !exists;
+                    // Downloaded for another release, so it won't need the network
+                    app.isCached = !exists && DownloadStore::contains(app);
                 }
-                app->setIsMarked(app->isAvailable() && !app->isInstalled());
+                app.isMarked = app.isNeeded();
             }
             // Server uses some funny order.
             // Put in order of largest to smallest with OS and Radio first and already downloaded last.
-            std::sort(_updateAppList.begin(), _updateAppList.end(),
-                      [=](const Apps* i, const Apps* j) {
-                if (i->type() != "application" && j->type() == "application")
+            std::sort(newApps.begin(), newApps.end(),
+                      [=](const AppInfo& i, const AppInfo& j) {
+                if (i.type != "application" && j.type == "application")
                     return true;
-                if (j->type() != "application" && i->type() == "application")
+                if (j.type != "application" && i.type == "application")
                     return false;
-                if (i->isMarked() != j->isMarked())
-                    return i->isMarked();
+                if (i.isMarked != j.isMarked)
+                    return i.isMarked;
 
-                return (i->size() > j->size());
+                return (i.size > j.size);
             }
             );
+            // Put this new list up for display
+            _updateApps->setApps(newApps);
 
             _updateMessage = QString("<b>Update %1 available for %2!</b><br>%3 %4")
                     .arg(ver)
@@ -635,9 +621,7 @@ void MainNet::showFirmwareData(QByteArray data, QString variant)
 
             _error = ""; emit errorChanged();
         }
-        // TODO: Putting it here makes user see the values changed. However, putting it below crashes
         emit updateMessageChanged();
-        emit updateCheckedCountChanged();
     }
     setScanning(_scanning-1);
     // All scans complete
@@ -648,29 +632,28 @@ void MainNet::showFirmwareData(QByteArray data, QString variant)
 
 void MainNet::newDeviceConnected()
 {
-    foreach(Apps* newApp, _updateAppList) {
-        foreach(Apps* app, _i->appQList()) {
-            bool isSameApp = newApp->packageId().compare(app->packageId()) == 0;
-            if (isSameApp) {
-                newApp->setIsInstalled(isVersionNewer(app->version(), newApp->version(), true));
-                newApp->setInstalledVersion(app->version());
-                break;
-            } else {
-                newApp->setIsInstalled(false);
-                newApp->setInstalledVersion("");
-            }
-        }
+    for (int i = 0; i < _updateApps->count(); i++) {
+        AppInfo newApp = _updateApps->at(i);
+        const Apps* app = _i->installedApp(newApp.packageId);
+        QString installedVersion = app != nullptr ? app->version() : QString();
+        bool installed = app != nullptr && app->packedVersion().isNewerThan(PackedVersion(newApp.version), true);
+        // Only the rows that changed are redrawn
+        if (newApp.isInstalled == installed && newApp.installedVersion == installedVersion)
+            continue;
+        newApp.isInstalled = installed;
+        newApp.installedVersion = installedVersion;
+        _updateApps->update(i, newApp);
     }
 }
 
-void MainNet::serverError(QNetworkReply::NetworkError err)
+void MainNet::serverError(QNetworkReply::NetworkError err, QString errorString)
 {
     setScanning(_scanning-1);
     // Only show error if we are doing single scan or multiscan version is empty.
     if (!_multiscan || (_multiscanVersion == "" && _scanning == 0)) {
         QString errormsg = QString("Error %1 (%2)")
                 .arg(err)
-                .arg( ((QNetworkReply*)sender())->errorString() );
+                .arg(errorString);
         _error = errormsg;
         emit errorChanged();
         _updateMessage = ""; emit updateMessageChanged();
@@ -681,7 +664,7 @@ void MainNet::serverError(QNetworkReply::NetworkError err)
 
 void MainNet::setMultiscan(const bool &multiscan) {
     _multiscan = multiscan; emit multiscanChanged();
-    _multiscanVersion = ""; emit updateMessageChanged();
+    _multiscanVersion = ""; _multiscanNewest = PackedVersion(); emit updateMessageChanged();
 }
 void MainNet::setScanning(const int &scanning) { _scanning = scanning; emit scanningChanged(); }
 void MainNet::setSplitProgress(const int &progress) { if (_splitProgress > 1000) _splitProgress = 0; else _splitProgress = progress; emit splitProgressChanged(); }
@@ -20,8 +20,12 @@
 #include <QtNetwork>
 #include <QObject>
 #include "apps.h"
+#include "appmodel.h"
 #include "splitter.h"
 #include "downloadinfo.h"
+#include "scanengine.h"
+#include "responsecache.h"
+#include "updateparser.h"
 
 #ifdef BLACKBERRY
 class InstallNet;
@@ -36,16 +40,17 @@ enum SplitType {
     ExtractingImage = 3,
     ExtractingApps = 4,
     FetchingCap = 5,
+    CreatingImage = 6,
 };
 
 class MainNet : public QObject {
     Q_OBJECT
     Q_PROPERTY(QString softwareRelease MEMBER _softwareRelease NOTIFY softwareReleaseChanged) // from reverse lookup
     Q_PROPERTY(QString updateMessage MEMBER _updateMessage NOTIFY updateMessageChanged)
-    Q_PROPERTY(QQmlListProperty<Apps> updateAppList READ updateAppList NOTIFY updateMessageChanged)
-    Q_PROPERTY(int     updateAppCount READ updateAppCount NOTIFY updateMessageChanged)
+    Q_PROPERTY(AppModel* updateAppList READ updateAppList CONSTANT)
+    Q_PROPERTY(int     updateAppCount READ updateAppCount NOTIFY updateCheckedCountChanged)
     Q_PROPERTY(int     updateCheckedCount READ updateCheckedCount NOTIFY updateCheckedCountChanged)
-    Q_PROPERTY(int     updateAppNeededCount READ updateAppNeededCount NOTIFY updateMessageChanged)
+    Q_PROPERTY(int     updateAppNeededCount READ updateAppNeededCount NOTIFY updateCheckedCountChanged)
     Q_PROPERTY(int     updateCheckedNeededCount READ updateCheckedNeededCount NOTIFY updateCheckedCountChanged)
     Q_PROPERTY(QString error MEMBER _error NOTIFY errorChanged)
     Q_PROPERTY(QString multiscanVersion MEMBER _multiscanVersion NOTIFY updateMessageChanged)
@@ -55,6 +60,7 @@ class MainNet : public QObject {
     Q_PROPERTY(int     maxId MEMBER _maxId NOTIFY maxIdChanged)
     Q_PROPERTY(int     splitting MEMBER _splitting NOTIFY splittingChanged)
     Q_PROPERTY(int     splitProgress MEMBER _splitProgress WRITE setSplitProgress NOTIFY splitProgressChanged)
+    Q_PROPERTY(ScanEngine* scanEngine READ scanEngine CONSTANT)
 
 public:
     MainNet(InstallNet* installer = nullptr, QObject* parent = 0);
@@ -62,17 +68,21 @@ public:
     Q_INVOKABLE void updateDetailRequest(QString delta, QString carrier, QString country, int device, int variant, int mode/*, int server, int version*/);
     Q_INVOKABLE void createRCFSImageFromFolder(const QUrl &folderUrl, const QString &outputPath);
     Q_INVOKABLE void decompressRCFS(const QUrl &fileUrl, const QString &outputPath);
+    Q_INVOKABLE void createQNX6Image(const QUrl &folderUrl);
     Q_INVOKABLE void downloadLinks(int downloadDevice = 0);
     Q_INVOKABLE void splitAutoloader(QUrl, int options);
     Q_INVOKABLE void combineAutoloader(QList<QUrl> selectedFiles);
     Q_INVOKABLE void extractImage(int type, int options);
     Q_INVOKABLE void grabLinks(int downloadDevice);
     Q_INVOKABLE void abortSplit();
+    void extractStream(DownloadStream* stream, QString fileName);
     void splitConnectStart();
 
     Q_INVOKABLE QString nameFromVariant(unsigned int device, unsigned int variant);
     Q_INVOKABLE QString hwidFromVariant(unsigned int device, unsigned int variant);
     Q_INVOKABLE unsigned int variantCount(unsigned int device);
+    Q_INVOKABLE QString npcFromLocale(int carrier, int country);
+    ScanEngine* scanEngine() const { return _scanEngine; }
     bool    hasBootAccess()  const { return
 #ifdef BOOTLOADER_ACCESS
                 true;
@@ -82,33 +92,12 @@ public:
                                    }
     void    setMultiscan(const bool &multiscan);
     void    setScanning(const int &scanning);
-    QQmlListProperty<Apps> updateAppList() {
-        return QQmlListProperty<Apps>(this, _updateAppList);
-    }
+    AppModel* updateAppList() const { return _updateApps; }
 
-    int updateAppCount() const { return _updateAppList.count(); }
-    int updateAppNeededCount() const {
-        int count = 0;
-        foreach (Apps* app, _updateAppList) {
-            if (app->isAvailable() && !app->isInstalled())
-                count++;
-        }
-        return count;
-    }
-    int updateCheckedCount() const {
-        int checked = 0;
-        foreach (Apps* app, _updateAppList)
-            if (app->isMarked())
-                checked++;
-        return checked;
-    }
-    int updateCheckedNeededCount() const {
-        int checked = 0;
-        foreach (Apps* app, _updateAppList)
-            if (app->isMarked() && (app->isAvailable() && !app->isInstalled()))
-                checked++;
-        return checked;
-    }
+    int updateAppCount() const { return _updateApps->count(); }
+    int updateAppNeededCount() const { return _updateApps->neededCount(); }
+    int updateCheckedCount() const { return _updateApps->checkedCount(); }
+    int updateCheckedNeededCount() const { return _updateApps->checkedNeededCount(); }
     DownloadInfo* currentDownload;
 public slots:
     void setSplitProgress(const int &progress);
@@ -125,10 +114,10 @@ signals:
     void splittingChanged();
     void splitProgressChanged();
 private slots:
-    void serverReply();
-    void showFirmwareData(QByteArray data, QString variant);
-    void serverError(QNetworkReply::NetworkError error);
+    void showFirmwareData(int id, QString variant, UpdateResult result);
+    void serverError(QNetworkReply::NetworkError error, QString errorString);
     void cancelSplit();
+    void splitError(QString error);
 // Blackberry
 	void extractImageSlot(const QStringList& selectedFiles);
 
@@ -139,17 +128,22 @@ private:
     QString convertLinks(QString prepend);
     QString fixVariantName(QString name, QString replace, int type);
     void fixApps();
-    QString NPCFromLocale(int country, int carrier);
 
     QThread* splitThread;
     Splitter* splitter;
+    QPointer<DownloadStream> _splitStream;
+    ScanEngine* _scanEngine;
+    QThread* _parseThread;
+    UpdateParser* _parser;
+    int _parseId;
     QNetworkAccessManager *manager;
-    QList<Apps*> _updateAppList;
+    AppModel* _updateApps;
     QString _updateMessage;
     QString _softwareRelease;
     QString _versionRelease;
     QString _error;
     QString _multiscanVersion;
+    PackedVersion _multiscanNewest;
     bool _multiscan;
     int _scanning;
     QFile _currentFile;
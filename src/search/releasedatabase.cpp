@@ -0,0 +1,141 @@
+// Copyright (C) 2014 Sacha Refshauge
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 3.0.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 3.0 for more details.
+
+// A copy of the GPL 3.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official GIT repository and contact information can be found at
+// http://github.com/xsacha/Sachesi
+
+#include "releasedatabase.h"
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QStringList>
+
+ReleaseDatabase* ReleaseDatabase::instance() {
+    static ReleaseDatabase* database = new ReleaseDatabase();
+    return database;
+}
+
+ReleaseDatabase::ReleaseDatabase()
+    : _logLines(0)
+{
+    load();
+}
+
+QString ReleaseDatabase::fileName() {
+    return QStandardPaths::writableLocation(QStandardPaths::DataLocation) + "/releases.log";
+}
+
+static QByteArray toLine(const ReleaseRecord& release) {
+    return QString("%1\t%2\t%3\t%4\t%5\n")
+            .arg(release.osVersion).arg(release.srVersion).arg(release.servers)
+            .arg(release.baseUrl).arg(release.seen).toUtf8();
+}
+
+void ReleaseDatabase::load() {
+    QFile log(fileName());
+    if (!log.open(QIODevice::ReadOnly))
+        return;
+    while (!log.atEnd()) {
+        QByteArray line = log.readLine();
+        _logLines++;
+        // A line cut short by a crash is ignored
+        if (!line.endsWith('\n'))
+            continue;
+        QStringList fields = QString::fromUtf8(line.constData(), line.size() - 1).split('\t');
+        if (fields.count() < 5)
+            continue;
+        ReleaseRecord release;
+        release.osVersion = fields.at(0);
+        release.srVersion = fields.at(1);
+        release.servers = fields.at(2).toInt();
+        release.baseUrl = fields.at(3);
+        release.seen = fields.at(4).toLongLong();
+        PackedVersion os(release.osVersion);
+        if (os.isValid())
+            _index.insert(os, release);
+    }
+}
+
+bool ReleaseDatabase::append(const ReleaseRecord& release) {
+    QDir().mkpath(QFileInfo(fileName()).absolutePath());
+    QFile log(fileName());
+    if (!log.open(QIODevice::WriteOnly | QIODevice::Append))
+        return false;
+    log.write(toLine(release));
+    _logLines++;
+    return true;
+}
+
+void ReleaseDatabase::record(ReleaseRecord release) {
+    PackedVersion os(release.osVersion);
+    if (!os.isValid() || release.srVersion.isEmpty())
+        return;
+    if (_index.contains(os)) {
+        const ReleaseRecord& known = _index[os];
+        if (known.srVersion == release.srVersion) {
+            release.servers |= known.servers;
+            if (release.baseUrl.isEmpty())
+                release.baseUrl = known.baseUrl;
+        }
+        // Nothing new, so nothing to write
+        if (known.srVersion == release.srVersion && known.servers == release.servers && known.baseUrl == release.baseUrl)
+            return;
+    }
+    release.seen = QDateTime::currentMSecsSinceEpoch();
+    _index.insert(os, release);
+    append(release);
+    if (_logLines > RELEASE_DB_COMPACT_MIN && _logLines > 2 * _index.count())
+        compact();
+}
+
+// One line per release, written next to the log and moved over it
+void ReleaseDatabase::compact() {
+    QSaveFile log(fileName());
+    if (!log.open(QIODevice::WriteOnly))
+        return;
+    foreach (const ReleaseRecord& release, _index)
+        log.write(toLine(release));
+    if (log.commit())
+        _logLines = _index.count();
+}
+
+QList<ReleaseRecord> ReleaseDatabase::find(const QString& osPrefix, int servers) const {
+    QList<ReleaseRecord> found;
+    // The prefix covers a contiguous span of packed versions
+    QStringList parts = osPrefix.split('.', QString::SkipEmptyParts);
+    if (parts.count() > 4)
+        return found;
+    quint16 start[4] = {0, 0, 0, 0};
+    for (int i = 0; i < parts.count(); i++)
+        start[i] = (quint16)qMin(parts.at(i).toUInt(), 0xFFFFu);
+    PackedVersion low(start[0], start[1], start[2], start[3]);
+    quint64 span = parts.isEmpty() ? 0 : (Q_UINT64_C(1) << (16 * (4 - parts.count())));
+    QMap<PackedVersion, ReleaseRecord>::const_iterator it = parts.isEmpty() ? _index.constBegin() : _index.lowerBound(low);
+    for (; it != _index.constEnd(); ++it) {
+        if (span && it.key().value() - low.value() >= span)
+            break;
+        if (servers == 0 || (it.value().servers & servers))
+            found.append(it.value());
+    }
+    return found;
+}
+
+void ReleaseDatabase::clear() {
+    _index.clear();
+    _logLines = 0;
+    QFile::remove(fileName());
+}
@@ -0,0 +1,64 @@
+// Copyright (C) 2014 Sacha Refshauge
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 3.0.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 3.0 for more details.
+
+// A copy of the GPL 3.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official GIT repository and contact information can be found at
+// http://github.com/xsacha/Sachesi
+
+#pragma once
+
+#include <QString>
+#include <QList>
+#include <QMap>
+#include "packedversion.h"
+
+// The log is rewritten once it has this many lines and more than twice as many as releases
+#define RELEASE_DB_COMPACT_MIN 1000
+
+// A software release the lookup servers gave for an OS build
+struct ReleaseRecord {
+    QString osVersion;
+    QString srVersion;
+    int servers; // 1 = production, 2 = beta, 4 = alpha
+    QString baseUrl; // Empty if the links weren't there
+    qint64 seen; // Last time it changed (ms since epoch)
+
+    ReleaseRecord() : servers(0), seen(0) {}
+};
+
+// Every release found by a lookup, kept across sessions. Stored as an append-only log of
+// tab separated records in the data folder, where a later line replaces an earlier one for
+// the same OS. The whole log is read once in to an index sorted by OS version.
+class ReleaseDatabase {
+public:
+    static ReleaseDatabase* instance();
+    static QString fileName();
+
+    // Adds to what is known about the OS: servers are added up and a link is only replaced by another
+    void record(ReleaseRecord release);
+    bool contains(const QString& osVersion) const { return _index.contains(PackedVersion(osVersion)); }
+    ReleaseRecord value(const QString& osVersion) const { return _index.value(PackedVersion(osVersion)); }
+    // Releases whose OS starts with 'osPrefix' (eg. "10.3"), on any of 'servers' if not 0. Oldest OS first.
+    QList<ReleaseRecord> find(const QString& osPrefix = QString(), int servers = 0) const;
+    int count() const { return _index.count(); }
+    void clear();
+
+private:
+    ReleaseDatabase();
+    void load();
+    bool append(const ReleaseRecord& release);
+    void compact();
+
+    QMap<PackedVersion, ReleaseRecord> _index;
+    int _logLines;
+};
@@ -0,0 +1,170 @@
+// Copyright (C) 2014 Sacha Refshauge
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 3.0.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 3.0 for more details.
+
+// A copy of the GPL 3.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official GIT repository and contact information can be found at
+// http://github.com/xsacha/Sachesi
+
+#include "responsecache.h"
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QRegExp>
+#include <QSaveFile>
+#include <QSharedPointer>
+#include <QSettings>
+#include <QStandardPaths>
+#include <QTimer>
+
+ResponseCache* ResponseCache::instance() {
+    static ResponseCache* cache = new ResponseCache();
+    return cache;
+}
+
+ResponseCache::ResponseCache(QObject* parent)
+    : QObject(parent)
+{
+    QSettings settings("Qtness","Sachesi");
+    _ttl = settings.value("responseCacheTtl", RESPONSE_CACHE_TTL).toInt();
+    _maxStale = settings.value("responseCacheMaxStale", RESPONSE_CACHE_MAX_STALE).toInt();
+    _staleWhileRevalidate = settings.value("responseCacheStale", true).toBool();
+}
+
+QString ResponseCache::cachePath() {
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/responses";
+}
+
+QString ResponseCache::fingerprint(const QUrl& url, const QByteArray& body) {
+    // Everything but the time the request was made, and the layout of the XML
+    QString normalized = QString::fromUtf8(body);
+    normalized.remove(QRegExp("\\s*authEchoTS=\"[^\"]*\""));
+    normalized.replace(QRegExp(">\\s+<"), "><");
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(url.toString().toUtf8());
+    hash.addData("\n", 1);
+    hash.addData(normalized.trimmed().toUtf8());
+    return hash.result().toHex();
+}
+
+bool ResponseCache::load(const QString& key, QByteArray* data, qint64* age) const {
+    QFile file(cachePath() + "/" + key + ".xml");
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+    *age = QFileInfo(file).lastModified().secsTo(QDateTime::currentDateTime());
+    *data = file.readAll();
+    return !data->isEmpty();
+}
+
+void ResponseCache::store(const QString& key, const QByteArray& data) {
+    QDir(cachePath()).mkpath(".");
+    QSaveFile file(cachePath() + "/" + key + ".xml");
+    if (!file.open(QIODevice::WriteOnly))
+        return;
+    file.write(data);
+    file.commit();
+}
+
+void ResponseCache::clear() {
+    QDir(cachePath()).removeRecursively();
+}
+
+QNetworkReply* ResponseCache::fetch(QNetworkAccessManager* manager, const QNetworkRequest& request, const QByteArray& body,
+                                    const QString& key, QPointer<QObject> context, ChunkCallback chunk) {
+    QNetworkReply* reply = manager->post(request, body);
+    QSharedPointer<QByteArray> buffer(new QByteArray());
+    connect(reply, &QNetworkReply::readyRead, this, [=]() {
+        QByteArray data = reply->readAll();
+        buffer->append(data);
+        if (chunk && !context.isNull())
+            chunk(data);
+    });
+    connect(reply, &QNetworkReply::finished, this, [=]() {
+        reply->deleteLater();
+        _revalidating.remove(key);
+        QByteArray rest = reply->readAll();
+        buffer->append(rest);
+        if (!rest.isEmpty() && chunk && !context.isNull())
+            chunk(rest);
+        int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+        if (reply->error() == QNetworkReply::NoError && status == 200 && !buffer->isEmpty())
+            store(key, *buffer);
+        // The reply has been read empty, so keep it for whoever is waiting
+        reply->setProperty("cachedData", *buffer);
+    });
+    return reply;
+}
+
+QNetworkReply* ResponseCache::post(QNetworkAccessManager* manager, const QNetworkRequest& request, const QByteArray& body,
+                                   QObject* context, Callback callback, ChunkCallback chunk) {
+    QString key = fingerprint(request.url(), body);
+    QByteArray data;
+    qint64 age = 0;
+    bool found = load(key, &data, &age);
+
+    bool fresh = found && age < _ttl;
+    bool usable = found && _staleWhileRevalidate && age < _maxStale;
+    if (fresh || usable) {
+        if (!fresh && !_revalidating.contains(key)) {
+            _revalidating.insert(key);
+            fetch(manager, request, body, key, nullptr, ChunkCallback());
+        }
+        Ready ready;
+        ready.context = context;
+        ready.callback = callback;
+        ready.reply.data = data;
+        ready.reply.error = QNetworkReply::NoError;
+        ready.reply.cached = true;
+        ready.reply.streamed = true;
+        ready.chunk = chunk;
+        _ready.append(ready);
+        if (_ready.count() == 1)
+            QTimer::singleShot(0, this, SLOT(deliverCached()));
+        return nullptr;
+    }
+
+    QNetworkReply* reply = fetch(manager, request, body, key, context, chunk);
+    // Connected after fetch(), so the answer is already stored when this runs
+    connect(reply, &QNetworkReply::finished, context, [=]() {
+        CachedReply result;
+        result.error = reply->error();
+        result.errorString = reply->errorString();
+        result.data = reply->property("cachedData").toByteArray();
+        result.cached = false;
+        result.streamed = true;
+        // Better an old answer than none at all
+        if (result.error != QNetworkReply::NoError && result.error != QNetworkReply::OperationCanceledError && found) {
+            result.data = data;
+            result.error = QNetworkReply::NoError;
+            result.cached = true;
+            result.streamed = false;
+        }
+        callback(result);
+    });
+    return reply;
+}
+
+void ResponseCache::deliverCached() {
+    // Callbacks may post again, which adds to the list
+    QList<Ready> ready = _ready;
+    _ready.clear();
+    foreach (Ready r, ready) {
+        if (r.context.isNull())
+            continue;
+        // A cached answer arrives in one piece
+        if (r.chunk)
+            r.chunk(r.reply.data);
+        r.callback(r.reply);
+    }
+}
@@ -0,0 +1,86 @@
+// Copyright (C) 2014 Sacha Refshauge
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 3.0.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 3.0 for more details.
+
+// A copy of the GPL 3.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official GIT repository and contact information can be found at
+// http://github.com/xsacha/Sachesi
+
+#pragma once
+
+#include <QObject>
+#include <QList>
+#include <QPointer>
+#include <QSet>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <functional>
+
+// How long an answer is used without asking again (seconds)
+#define RESPONSE_CACHE_TTL (10 * 60)
+// How old an answer may be and still be shown while a fresh one is fetched (seconds)
+#define RESPONSE_CACHE_MAX_STALE (24 * 60 * 60)
+
+struct CachedReply {
+    QByteArray data;
+    QNetworkReply::NetworkError error;
+    QString errorString;
+    bool cached; // Came from disk
+    bool streamed; // Everything in 'data' went through the chunk callback, in order
+};
+
+// Keeps what the update servers answered, so that asking the same thing again doesn't
+// go over the network. Requests are matched on their URL and body, leaving out the
+// authEchoTS timestamp. Answers older than the TTL can still be used while a fresh
+// one is fetched in the background (stale-while-revalidate), and are used if the
+// server can't be reached.
+class ResponseCache : public QObject {
+    Q_OBJECT
+public:
+    typedef std::function<void(const CachedReply&)> Callback;
+    // Data as it arrives, for callers that want to start on it early
+    typedef std::function<void(const QByteArray&)> ChunkCallback;
+
+    static ResponseCache* instance();
+
+    static QString fingerprint(const QUrl& url, const QByteArray& body);
+    static QString cachePath();
+
+    // The callback is called once, later, unless 'context' is gone by then. Returns the
+    // reply when the caller is waiting on the network, so it can be aborted.
+    // 'chunk' sees the data first, a piece at a time. If the callback's reply is not 'streamed',
+    // the server failed part way and an older answer is used: the chunks should be thrown away.
+    QNetworkReply* post(QNetworkAccessManager* manager, const QNetworkRequest& request, const QByteArray& body,
+                        QObject* context, Callback callback, ChunkCallback chunk = ChunkCallback());
+    void clear();
+
+private slots:
+    void deliverCached();
+
+private:
+    explicit ResponseCache(QObject* parent = 0);
+    bool load(const QString& key, QByteArray* data, qint64* age) const;
+    void store(const QString& key, const QByteArray& data);
+    QNetworkReply* fetch(QNetworkAccessManager* manager, const QNetworkRequest& request, const QByteArray& body,
+                         const QString& key, QPointer<QObject> context, ChunkCallback chunk);
+
+    struct Ready {
+        QPointer<QObject> context;
+        Callback callback;
+        ChunkCallback chunk;
+        CachedReply reply;
+    };
+    QList<Ready> _ready;
+    QSet<QString> _revalidating;
+    int _ttl, _maxStale;
+    bool _staleWhileRevalidate;
+};
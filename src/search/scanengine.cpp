@@ -0,0 +1,257 @@
+// Copyright (C) 2014 Sacha Refshauge
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 3.0.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 3.0 for more details.
+
+// A copy of the GPL 3.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official GIT repository and contact information can be found at
+// http://github.com/xsacha/Sachesi
+
+#include "scanengine.h"
+#include "../ports.h"
+#include "updateparser.h"
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QSet>
+#include <QTimer>
+
+ScanEngine::ScanEngine(QObject* parent)
+    : QObject(parent)
+    , _inFlight(0)
+    , _retrying(0)
+    , _done(0), _total(0)
+    , _generation(0)
+{
+    _manager = new QNetworkAccessManager(this);
+    _results = new ScanResultModel(this);
+    QSettings settings("Qtness","Sachesi");
+    _concurrency = qBound(1, settings.value("scanConcurrency", SCAN_CONCURRENCY).toInt(), SCAN_MAX_CONCURRENCY);
+}
+
+ScanEngine::~ScanEngine() {
+    cancel();
+}
+
+QString ScanEngine::detailQuery(const QString& hwid, const QString& npc, int mode, const QString& delta) {
+    QString version = UPDATE_DETAILS_VERSION;
+    return QString("<?xml version=\"1.0\" encoding=\"UTF-8\"?>"
+                   "<updateDetailRequest version=\"%1\" authEchoTS=\"%2\">"
+                   "<clientProperties>"
+                   "<hardware>"
+                   "<pin>0x2FFFFFB3</pin><bsn>1128121361</bsn><imei>004401139269240</imei><id>0x%3</id>"
+                   "</hardware>"
+                   "<network>"
+                   "<homeNPC>0x%4</homeNPC><iccid>89014104255505565333</iccid>"
+                   "</network>"
+                   "<software>"
+                   "<currentLocale>en_US</currentLocale><legalLocale>en_US</legalLocale>"
+                   "</software>"
+                   "</clientProperties>"
+                   "<updateDirectives><allowPatching type=\"REDBEND\">true</allowPatching><upgradeMode>%5</upgradeMode><provideDescriptions>false</provideDescriptions><provideFiles>true</provideFiles><queryType>NOTIFICATION_CHECK</queryType></updateDirectives>"
+                   "<pollType>manual</pollType>"
+                   "<resultPackageSetCriteria>"
+                   "%6"
+                   "<releaseIndependent><packageType operation=\"include\">application</packageType></releaseIndependent>"
+                   "</resultPackageSetCriteria>"
+                   "%7"
+                   "</updateDetailRequest>")
+            .arg(version) // API Version
+            .arg(QDateTime::currentMSecsSinceEpoch()) // Current time, in case it cares one day
+            .arg(hwid) // Search Device HWID
+            .arg(npc) // Country + Carrier
+            .arg(mode == 1 ? "repair" : "upgrade") // Upgrade or Repair?
+            // 2.3.0 doesn't support 'latest'. Does this mean we need to do availableBundles lookup first?
+            .arg((version == "2.3.0") ? "" : "<softwareRelease softwareReleaseVersion=\"latest\" />")
+            .arg(delta); // User installed applications (to support REDBEND patching)
+}
+
+ScanSummary ScanEngine::summarize(const QByteArray& data) {
+    UpdateResult result = UpdateParser::parse(data);
+    ScanSummary summary;
+    summary.release = result.release;
+    summary.os = result.os;
+    summary.radio = result.radio;
+    summary.packages = result.packages.count();
+    summary.error = result.message;
+    return summary;
+}
+
+void ScanEngine::scanAll(QStringList npcs, QVariantList modes) {
+    QList<ScanJob> jobs;
+    // Some devices share a HWID
+    QSet<QString> seen;
+    int devices = sizeof(dev) / sizeof(dev[0]) / 2;
+    for (int d = 0; d < devices; d++) {
+        for (int v = 0; v < dev[d*2+1].count(); v++) {
+            ScanJob job;
+            job.hwid = dev[d*2+1].at(v);
+            job.variant = v < dev[d*2].count() ? dev[d*2].at(v) : job.hwid;
+            job.attempts = 0;
+            foreach (QString npc, npcs) {
+                job.npc = npc;
+                foreach (QVariant mode, modes) {
+                    job.mode = mode.toInt();
+                    QString key = QString("%1/%2/%3").arg(job.hwid).arg(job.npc).arg(job.mode);
+                    if (seen.contains(key))
+                        continue;
+                    seen.insert(key);
+                    jobs.append(job);
+                }
+            }
+        }
+    }
+    scan(jobs);
+}
+
+void ScanEngine::scan(QList<ScanJob> jobs) {
+    cancel();
+    _summaries.clear();
+    _releases.clear();
+    _summaryOrder.clear();
+    _results->clear();
+    _queue = jobs;
+    _done = 0;
+    _total = jobs.count();
+    emit resultsChanged();
+    emit progressChanged();
+    startNext();
+}
+
+void ScanEngine::cancel() {
+    _generation++;
+    _retrying = 0;
+    _queue.clear();
+    _inFlight = 0;
+    foreach (QPointer<QNetworkReply> reply, _replies) {
+        if (!reply.isNull())
+            reply->abort();
+    }
+    _replies.clear();
+    emit progressChanged();
+}
+
+void ScanEngine::setConcurrency(int concurrency) {
+    concurrency = qBound(1, concurrency, SCAN_MAX_CONCURRENCY);
+    if (concurrency == _concurrency)
+        return;
+    _concurrency = concurrency;
+    QSettings settings("Qtness","Sachesi");
+    settings.setValue("scanConcurrency", _concurrency);
+    emit concurrencyChanged();
+    startNext();
+}
+
+void ScanEngine::startNext() {
+    while (!_queue.isEmpty() && _inFlight < _concurrency) {
+        ScanJob job = _queue.takeFirst();
+        QNetworkRequest request;
+        request.setRawHeader("Content-Type", "text/xml;charset=UTF-8");
+        request.setUrl(QUrl(serverUrl(UPDATE_DETAILS_URL)));
+        int generation = _generation;
+        _inFlight++;
+        // Answers seen recently come from the cache and don't take a connection
+        QNetworkReply* reply = ResponseCache::instance()->post(_manager, request, detailQuery(job.hwid, job.npc, job.mode).toUtf8(),
+                                                               this, [=](const CachedReply& result) {
+            if (generation == _generation)
+                jobFinished(job, result);
+        });
+        if (reply != nullptr)
+            _replies.append(reply);
+    }
+}
+
+void ScanEngine::jobFinished(const ScanJob& job, const CachedReply& reply) {
+    _inFlight--;
+    if (!reply.cached) {
+        for (int i = _replies.count() - 1; i >= 0; i--) {
+            if (_replies.at(i).isNull() || _replies.at(i)->isFinished())
+                _replies.removeAt(i);
+        }
+    }
+
+    if (reply.error != QNetworkReply::NoError) {
+        if (job.attempts < SCAN_RETRIES)
+            retry(job);
+        else
+            addResult(job, QString(), reply.errorString);
+        startNext();
+        return;
+    }
+
+    // The echoed timestamp is the only thing that differs between otherwise identical answers
+    QByteArray data = reply.data;
+    QByteArray normalized = QString::fromUtf8(data).remove(QRegExp("authEchoTS=\"[0-9]*\"")).toUtf8();
+    QString key = QCryptographicHash::hash(normalized, QCryptographicHash::Sha1).toHex();
+    if (!_summaries.contains(key)) {
+        ScanSummary summary = summarize(data);
+        _summaries.insert(key, summary);
+        PackedVersion release(summary.release);
+        if (release.isValid())
+            _releases.insert(release, summary.release);
+        _summaryOrder.append(key);
+        emit resultsChanged();
+    }
+    addResult(job, key, QString());
+    startNext();
+}
+
+void ScanEngine::retry(ScanJob job) {
+    job.attempts++;
+    _retrying++;
+    int generation = _generation;
+    QTimer* timer = new QTimer(this);
+    timer->setSingleShot(true);
+    connect(timer, &QTimer::timeout, this, [=]() {
+        timer->deleteLater();
+        if (generation != _generation)
+            return;
+        _retrying--;
+        _queue.prepend(job);
+        startNext();
+    });
+    timer->start(SCAN_RETRY_DELAY * job.attempts);
+}
+
+void ScanEngine::addResult(const ScanJob& job, const QString& responseKey, const QString& error) {
+    ScanResult result;
+    result.hwid = job.hwid;
+    result.variant = job.variant;
+    result.npc = job.npc;
+    result.mode = job.mode == 1 ? "repair" : "upgrade";
+    result.packages = 0;
+    if (responseKey.isEmpty()) {
+        result.response = -1;
+        result.error = error;
+    } else {
+        ScanSummary summary = _summaries.value(responseKey);
+        result.response = _summaryOrder.indexOf(responseKey);
+        result.release = summary.release;
+        result.os = summary.os;
+        result.radio = summary.radio;
+        result.packages = summary.packages;
+        result.error = summary.error;
+    }
+    _results->append(result);
+    _done++;
+    emit progressChanged();
+}
+
+void ScanEngine::exportResults() {
+    QString text = tr("HWID") + "\t" + tr("Device") + "\t" + "NPC" + "\t" + tr("Mode") + "\t" + tr("Release") + "\t" + tr("OS") + "\t" + tr("Radio") + "\t" + tr("Response") + "\t" + tr("Error") + "\n";
+    foreach (const ScanResult& result, _results->results()) {
+        QStringList fields;
+        fields << result.hwid << result.variant << result.npc << result.mode
+               << result.release << result.os << result.radio
+               << QString::number(result.response) << result.error;
+        text.append(fields.join("\t") + "\n");
+    }
+    writeDisplayFile(tr("Scan"), text);
+}
@@ -0,0 +1,122 @@
+// Copyright (C) 2014 Sacha Refshauge
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 3.0.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 3.0 for more details.
+
+// A copy of the GPL 3.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official GIT repository and contact information can be found at
+// http://github.com/xsacha/Sachesi
+
+#pragma once
+
+#include <QObject>
+#include <QHash>
+#include <QMap>
+#include <QList>
+#include <QStringList>
+#include <QVariantList>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QPointer>
+#include "responsecache.h"
+#include "packedversion.h"
+#include "scanresultmodel.h"
+
+// Requests in flight at once, unless changed in the settings
+#define SCAN_CONCURRENCY 8
+#define SCAN_MAX_CONCURRENCY 32
+// A failed request is tried this many more times, waiting a little longer each time (ms)
+#define SCAN_RETRIES 3
+#define SCAN_RETRY_DELAY 1000
+
+#define UPDATE_DETAILS_URL "https://csssl.berryinfra.xyz/cse/updateDetails/2.2/"
+#define UPDATE_DETAILS_VERSION "2.2.1"
+
+// One query to the update server
+struct ScanJob {
+    QString hwid;
+    QString variant; // Device name, for display
+    QString npc;
+    int mode; // 0 = upgrade, 1 = repair
+    int attempts;
+};
+
+// What an update server response offers. Identical responses are only read once.
+struct ScanSummary {
+    QString release;
+    QString os;
+    QString radio;
+    int packages;
+    QString error; // friendlyMessage from the server
+};
+
+// Asks the update server about every combination of device, carrier and mode it is given,
+// a few at a time, and collects what each one was offered in a table.
+class ScanEngine : public QObject {
+    Q_OBJECT
+    Q_PROPERTY(bool running READ running NOTIFY progressChanged)
+    Q_PROPERTY(int  done READ done NOTIFY progressChanged)
+    Q_PROPERTY(int  total READ total NOTIFY progressChanged)
+    Q_PROPERTY(int  distinct READ distinct NOTIFY resultsChanged)
+    Q_PROPERTY(QString newestRelease READ newestRelease NOTIFY resultsChanged)
+    Q_PROPERTY(int  concurrency READ concurrency WRITE setConcurrency NOTIFY concurrencyChanged)
+    Q_PROPERTY(ScanResultModel* results READ results CONSTANT)
+public:
+    explicit ScanEngine(QObject* parent = 0);
+    ~ScanEngine();
+
+    // The updateDetailRequest sent for a device. 'delta' lists installed apps, for patches.
+    static QString detailQuery(const QString& hwid, const QString& npc, int mode, const QString& delta = QString());
+    static ScanSummary summarize(const QByteArray& data);
+
+    void scan(QList<ScanJob> jobs);
+    // Every known device for each of the NPCs and modes (0 = upgrade, 1 = repair)
+    Q_INVOKABLE void scanAll(QStringList npcs, QVariantList modes);
+    Q_INVOKABLE void cancel();
+    Q_INVOKABLE void exportResults();
+
+    bool running() const { return !_queue.isEmpty() || _inFlight > 0 || _retrying > 0; }
+    int done() const { return _done; }
+    int total() const { return _total; }
+    int distinct() const { return _summaries.count(); }
+    QString newestRelease() const { return _releases.isEmpty() ? QString() : _releases.last(); }
+    int concurrency() const { return _concurrency; }
+    void setConcurrency(int concurrency);
+    ScanResultModel* results() const { return _results; }
+
+signals:
+    void progressChanged();
+    void resultsChanged();
+    void concurrencyChanged();
+
+private:
+    void startNext();
+    void jobFinished(const ScanJob& job, const CachedReply& reply);
+    void retry(ScanJob job);
+    void addResult(const ScanJob& job, const QString& responseKey, const QString& error);
+
+    QNetworkAccessManager* _manager;
+    QList<ScanJob> _queue;
+    int _inFlight;
+    // Requests that went to the network, so that cancel() can stop them
+    QList<QPointer<QNetworkReply> > _replies;
+    int _retrying;
+    int _done, _total;
+    int _concurrency;
+    // Keyed by a hash of the response, so devices that are offered the same thing share one entry
+    QHash<QString, ScanSummary> _summaries;
+    QStringList _summaryOrder;
+    // Sorted by version, so the newest is always the last entry
+    QMap<PackedVersion, QString> _releases;
+    ScanResultModel* _results;
+    // Bumped by cancel(), so retries that were already waiting know to give up
+    int _generation;
+};
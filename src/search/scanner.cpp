@@ -18,67 +18,125 @@
 #include <QXmlStreamReader>
 #include "scanner.h"
 #include "../ports.h"
+#include "responsecache.h"
 
 void Scanner::clearHistory() {
     foreach(DiscoveredRelease* rel, _history) {
         rel->deleteLater();
     }
     _history.clear();
+    ReleaseDatabase::instance()->clear();
     emit historyChanged();
 }
 
-void Scanner::exportHistory() {
+// Newest first, like anything found in this session
+void Scanner::loadHistory() {
+    foreach (const ReleaseRecord& record, ReleaseDatabase::instance()->find()) {
+        DiscoveredRelease* release = new DiscoveredRelease();
+        release->setOsVersion(record.osVersion);
+        release->setSrVersion(record.srVersion);
+        release->setActiveServers(record.servers);
+        release->setBaseUrl(record.baseUrl);
+        _history.prepend(release);
+    }
+}
+
+void Scanner::remember(DiscoveredRelease* release) {
+    ReleaseRecord record;
+    record.osVersion = release->osVersion();
+    record.srVersion = release->srVersion();
+    record.servers = release->activeServers();
+    record.baseUrl = release->baseUrl();
+    ReleaseDatabase::instance()->record(record);
+    _history.prepend(release);
+    emit historyChanged();
+}
+
+bool Scanner::isKnown(const QString& osVersion) const {
+    if (!ReleaseDatabase::instance()->contains(osVersion))
+        return false;
+    // Links may have turned up since
+    return _findExisting != 1 || !ReleaseDatabase::instance()->value(osVersion).baseUrl.isEmpty();
+}
+
+DiscoveredRelease* Scanner::knownRelease(const QString& osVersion) {
+    foreach (DiscoveredRelease* release, _history) {
+        if (release->osVersion() == osVersion)
+            return release;
+    }
+    ReleaseRecord record = ReleaseDatabase::instance()->value(osVersion);
+    DiscoveredRelease* release = new DiscoveredRelease();
+    release->setOsVersion(record.osVersion);
+    release->setSrVersion(record.srVersion);
+    release->setActiveServers(record.servers);
+    release->setBaseUrl(record.baseUrl);
+    _history.prepend(release);
+    emit historyChanged();
+    return release;
+}
+
+void Scanner::exportHistory(QString osPrefix, int servers) {
     QString historyText;
-    foreach(DiscoveredRelease* rel, _history) {
-        historyText.append(tr("SR: ") + " " + rel->srVersion() + " | " + tr("OS: ") + rel->osVersion() + " [");
-        if (rel->activeServers() & 1)
+    QList<ReleaseRecord> releases = ReleaseDatabase::instance()->find(osPrefix, servers);
+    for (int i = releases.count() - 1; i >= 0; i--) {
+        const ReleaseRecord& rel = releases.at(i);
+        historyText.append(tr("SR: ") + " " + rel.srVersion + " | " + tr("OS: ") + rel.osVersion + " [");
+        if (rel.servers & 1)
             historyText.append(tr("Production") + ", ");
-        if (rel->activeServers() & 2)
+        if (rel.servers & 2)
             historyText.append(tr("Beta") + ", ");
-        if (rel->activeServers() & 4)
+        if (rel.servers & 4)
             historyText.append(tr("Alpha") + ", ");
         historyText.chop(2);
-        historyText.append("]\n");
+        historyText.append("]");
+        if (!rel.baseUrl.isEmpty())
+            historyText.append(" " + rel.baseUrl);
+        historyText.append("\n");
     }
 
     writeDisplayFile(tr("History"), historyText);
 }
 
-void Scanner::reverseLookup(QString OSver) {
-    // If we only want real links, we're only going to want the server we can download from
-    _isActive = true; emit isActiveChanged();
-    _curRelease = new DiscoveredRelease();
-    _curRelease->setOsVersion(OSver);
-    emit curReleaseChanged();
-    QString query = QString("<srVersionLookupRequest version=\"2.0.0\" authEchoTS=\"%1\">"
-                            "<clientProperties>"
-                            "<hardware><pin>0x2FFFFFB3</pin><bsn>1140011878</bsn><id>0x85002c0a</id></hardware>"
-                            "<software><osVersion>%2</osVersion></software>"
-                            "</clientProperties>"
-                            "</srVersionLookupRequest>")
+QString Scanner::lookupQuery(const QString& osVersion) const {
+    return QString("<srVersionLookupRequest version=\"2.0.0\" authEchoTS=\"%1\">"
+                   "<clientProperties>"
+                   "<hardware><pin>0x2FFFFFB3</pin><bsn>1140011878</bsn><id>0x85002c0a</id></hardware>"
+                   "<software><osVersion>%2</osVersion></software>"
+                   "</clientProperties>"
+                   "</srVersionLookupRequest>")
             .arg(QDateTime::currentMSecsSinceEpoch())
-            .arg(OSver);
-    QNetworkRequest request;
-    request.setRawHeader("Content-Type", "text/xml;charset=UTF-8");
+            .arg(osVersion);
+}
+
+QStringList Scanner::lookupServers() const {
     QStringList serverList = QStringList("cs.sl");
     if (_findExisting != 1) {
         serverList << "beta2.sl.eval" << "alpha.sl.eval";
     }
-    _scansActive = serverList.count();
-    foreach(QString server, serverList) {
-        request.setUrl(QUrl(QString("https://%1.berryinfra.xyz/%2cse/srVersionLookup/2.0/").arg(server).arg(server == "cs.sl" ? "" : "sls")));
-        QNetworkReply* reply = _manager->post(request, query.toUtf8());
-        connect(reply, SIGNAL(error(QNetworkReply::NetworkError)),
-                this, SLOT(serverError(QNetworkReply::NetworkError)));
-        connect(reply, SIGNAL(finished()), this, SLOT(newSRVersion()));
-    }
+    QStringList urls;
+    foreach(QString server, serverList)
+        urls << QString("https://%1.berryinfra.xyz/%2cse/srVersionLookup/2.0/").arg(server).arg(server == "cs.sl" ? "" : "sls");
+    return urls;
 }
 
-void Scanner::newSRVersion() {
-    QNetworkReply* reply = (QNetworkReply*)sender();
+QString Scanner::releaseUrl(const QString& srVersion) {
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(srVersion.toLatin1());
+    return serverUrl("http://cdnnfsssl.berryinfra.xyz/fs/qnx/production/" + QString(hash.result().toHex()));
+}
+
+int Scanner::serverBit(const QString& host) {
+    if (host.startsWith("cs"))
+        return 1;
+    if (host.startsWith("beta"))
+        return 2;
+    if (host.startsWith("alpha"))
+        return 4;
+    return 0;
+}
+
+QString Scanner::readSRVersion(const QByteArray& data) {
     QString swRelease;
-    QByteArray data = reply->readAll();
-    //for (int i = 0; i < data.size(); i += 3000) qDebug() << data.mid(i, 3000);
     QXmlStreamReader xml(data);
     while(!xml.atEnd() && !xml.hasError()) {
         if(xml.tokenType() == QXmlStreamReader::StartElement) {
@@ -88,17 +146,39 @@ void Scanner::newSRVersion() {
         }
         xml.readNext();
     }
+    return swRelease;
+}
+
+void Scanner::reverseLookup(QString OSver) {
+    // If we only want real links, we're only going to want the server we can download from
+    _isActive = true; emit isActiveChanged();
+    _curRelease = new DiscoveredRelease();
+    _curRelease->setOsVersion(OSver);
+    emit curReleaseChanged();
+    QString query = lookupQuery(OSver);
+    QNetworkRequest request;
+    request.setRawHeader("Content-Type", "text/xml;charset=UTF-8");
+    QStringList serverList = lookupServers();
+    _scansActive = serverList.count();
+    foreach(QString server, serverList) {
+        request.setUrl(QUrl(serverUrl(server)));
+        QString host = QUrl(server).host();
+        ResponseCache::instance()->post(_manager, request, query.toUtf8(), this, [=](const CachedReply& reply) {
+            if (reply.error != QNetworkReply::NoError)
+                completeScan();
+            else
+                newSRVersion(reply.data, host);
+        });
+    }
+}
+
+void Scanner::newSRVersion(const QByteArray& data, const QString& host) {
+    //for (int i = 0; i < data.size(); i += 3000) qDebug() << data.mid(i, 3000);
+    QString swRelease = readSRVersion(data);
 
     // Software release has a version
     if (swRelease.startsWith('1')) {
-        QString replyHost = reply->url().host();
-        if (replyHost.startsWith("cs")) {
-            _curRelease->setActiveServers(1);
-        } else if (replyHost.startsWith("beta")) {
-            _curRelease->setActiveServers(2);
-        } else if (replyHost.startsWith("alpha")) {
-            _curRelease->setActiveServers(4);
-        }
+        _curRelease->setActiveServers(serverBit(host));
         // Software release is new so we should check if it has a release
         if (swRelease != _curRelease->srVersion()) {
             _curRelease->setSrVersion(swRelease);
@@ -106,21 +186,17 @@ void Scanner::newSRVersion() {
             if (_findExisting == 2) {
                 completeScan();
             } else {
-                QCryptographicHash hash(QCryptographicHash::Sha1);
-                hash.addData(swRelease.toLatin1());
-                QString url = "http://cdnnfsssl.berryinfra.xyz/fs/qnx/production/" + QString(hash.result().toHex());
+                QString url = releaseUrl(swRelease);
                 QNetworkRequest request;
                 request.setRawHeader("Content-Type", "text/xml;charset=UTF-8");
                 request.setUrl(QUrl(url));
                 QNetworkReply* replyTmp = _manager->head(request);
                 connect(replyTmp, SIGNAL(finished()), this, SLOT(validateDownload()));
             }
-            reply->deleteLater();
             return;
         }
     }
     completeScan();
-    reply->deleteLater();
 }
 
 void Scanner::validateDownload()
@@ -136,61 +212,193 @@ void Scanner::validateDownload()
     reply->deleteLater();
 }
 
-void appendNewHeader(QString *potentialText, QString name, QString devices) {
-    potentialText->append("\n" + name + ": " + devices + " (Debrick + Core OS)\n");
+void Scanner::setWindow(int window) {
+    window = qBound(1, window, LOOKUP_MAX_WINDOW);
+    if (window == _window)
+        return;
+    _window = window;
+    QSettings settings("Qtness","Sachesi");
+    settings.setValue("lookupWindow", _window);
+    emit windowChanged();
+}
+
+void Scanner::setSkipKnown(bool skipKnown) {
+    if (skipKnown == _skipKnown)
+        return;
+    _skipKnown = skipKnown;
+    QSettings settings("Qtness","Sachesi");
+    settings.setValue("lookupSkipKnown", _skipKnown);
+    emit skipKnownChanged();
+}
+
+void Scanner::scanRange(QString prefix, int fromBuild, int toBuild, int step) {
+    cancelRange();
+    _rangePrefix = prefix;
+    _rangeNext = fromBuild;
+    _rangeEnd = toBuild;
+    _rangeStep = qMax(1, step);
+    _rangeHit = -1;
+    _rangeDone = 0;
+    _rangeTotal = (toBuild >= fromBuild) ? (toBuild - fromBuild) / _rangeStep + 1 : 0;
+    emit rangeProgressChanged();
+    _isAuto = true; emit isAutoChanged();
+    setIsActive(true);
+    pumpRange();
+}
+
+void Scanner::cancelRange() {
+    foreach (QNetworkReply* reply, _rangeReplies.keys()) {
+        reply->disconnect(this);
+        reply->abort();
+        reply->deleteLater();
+    }
+    _rangeReplies.clear();
+    _rangeBuilds.clear();
+    _rangeNext = _rangeEnd + 1;
+}
+
+// Keeps up to 'window' builds being looked up
+void Scanner::pumpRange() {
+    while (_rangeBuilds.count() < _window && _rangeNext <= _rangeEnd
+           && (_rangeHit < 0 || _rangeNext < _rangeHit)) {
+        int build = _rangeNext;
+        _rangeNext += _rangeStep;
+        // Already in the database, so it is answered from there without asking the servers
+        QString osVersion = _rangePrefix + "." + QString::number(build);
+        if (_skipKnown && isKnown(osVersion)) {
+            _rangeDone++;
+            emit rangeProgressChanged();
+            rangeFound(build, knownRelease(osVersion));
+            continue;
+        }
+        startBuild(build);
+    }
+    if (_rangeBuilds.isEmpty() && _isActive && _scansActive == 0) {
+        if (_rangeHit >= 0)
+            setIsAuto(false);
+        setIsActive(false);
+        finishedFunc();
+    }
 }
 
-void Scanner::appendNewLink(QString *potentialText, QString linkType, QString hwType, QString version) {
-    bool os = (linkType == "Core" || linkType == "Debrick");
-    if (!os) {
-        potentialText->append(linkType + " Radio\n");
+void Scanner::startBuild(int build) {
+    RangeBuild entry;
+    entry.osVersion = _rangePrefix + "." + QString::number(build);
+    entry.servers = 0;
+    QString query = lookupQuery(entry.osVersion);
+    QNetworkRequest request;
+    request.setRawHeader("Content-Type", "text/xml;charset=UTF-8");
+    // Lookups are tiny, so let them queue up on the same connections
+    request.setAttribute(QNetworkRequest::HttpPipeliningAllowedAttribute, true);
+    QStringList servers = lookupServers();
+    entry.pending = servers.count();
+    _rangeBuilds.insert(build, entry);
+    foreach (QString server, servers) {
+        request.setUrl(QUrl(serverUrl(server)));
+        QNetworkReply* reply = _manager->post(request, query.toUtf8());
+        // The reply's URL may be a test server's
+        reply->setProperty("serverBit", serverBit(QUrl(server).host()));
+        connect(reply, SIGNAL(finished()), this, SLOT(rangeReply()));
+        _rangeReplies.insert(reply, build);
     }
-    potentialText->append(_curRelease->baseUrl() + "/" + hwType + "-" + version + "-nto+armle-v7+signed.bar\n");
 }
 
+void Scanner::rangeReply() {
+    QNetworkReply* reply = qobject_cast<QNetworkReply*>(sender());
+    if (reply == nullptr || !_rangeReplies.contains(reply))
+        return;
+    int build = _rangeReplies.take(reply);
+    reply->deleteLater();
+    if (!_rangeBuilds.contains(build))
+        return;
+    RangeBuild& entry = _rangeBuilds[build];
+    QString swRelease = readSRVersion(reply->readAll());
+    if (swRelease.startsWith('1')) {
+        entry.srVersion = swRelease;
+        entry.servers |= reply->property("serverBit").toInt();
+    }
+    if (--entry.pending > 0)
+        return;
+
+    if (entry.srVersion.isEmpty()) {
+        buildDone(build);
+        return;
+    }
+    // Links don't matter, so skip checking them
+    if (_findExisting == 2) {
+        buildDone(build);
+        return;
+    }
+    entry.pending = 1;
+    QNetworkRequest request;
+    request.setUrl(QUrl(releaseUrl(entry.srVersion)));
+    QNetworkReply* head = _manager->head(request);
+    connect(head, SIGNAL(finished()), this, SLOT(rangeValidated()));
+    _rangeReplies.insert(head, build);
+}
+
+void Scanner::rangeValidated() {
+    QNetworkReply* reply = qobject_cast<QNetworkReply*>(sender());
+    if (reply == nullptr || !_rangeReplies.contains(reply))
+        return;
+    int build = _rangeReplies.take(reply);
+    reply->deleteLater();
+    if (!_rangeBuilds.contains(build))
+        return;
+    uint status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toUInt();
+    // Seems to give 301 redirect if it's real
+    if (status == 200 || (status > 300 && status <= 308))
+        _rangeBuilds[build].baseUrl = reply->url().toString();
+    buildDone(build);
+}
+
+void Scanner::buildDone(int build) {
+    RangeBuild entry = _rangeBuilds.take(build);
+    _rangeDone++;
+    emit rangeProgressChanged();
+
+    if (!entry.srVersion.isEmpty()) {
+        DiscoveredRelease* release = new DiscoveredRelease();
+        release->setOsVersion(entry.osVersion);
+        release->setSrVersion(entry.srVersion);
+        release->setActiveServers(entry.servers);
+        release->setBaseUrl(entry.baseUrl);
+        remember(release);
+        rangeFound(build, release);
+    }
+    pumpRange();
+}
+
+void Scanner::rangeFound(int build, DiscoveredRelease* release) {
+    _curRelease = release;
+    emit curReleaseChanged();
+
+    // Stop at the lowest build that is what we were looking for. Lower builds still
+    // in flight are waited for, anything above it is dropped.
+    bool wanted = (_findExisting == 0) || (_findExisting == 1 && !release->baseUrl().isEmpty());
+    if (wanted && (_rangeHit < 0 || build < _rangeHit)) {
+        _rangeHit = build;
+        foreach (QNetworkReply* reply, _rangeReplies.keys()) {
+            if (_rangeReplies.value(reply) > build) {
+                _rangeReplies.remove(reply);
+                reply->disconnect(this);
+                reply->abort();
+                reply->deleteLater();
+            }
+        }
+        foreach (int other, _rangeBuilds.keys()) {
+            if (other > build)
+                _rangeBuilds.remove(other);
+        }
+    }
+}
 
 void Scanner::generatePotentialLinks() {
-    QStringList parts = _curRelease->osVersion().split('.');
-    // Just a guess that the Radio is +1. In some builds this isn't true.
-    int build = parts.last().toInt() + 1;
-    QString radioVersion = "";
-    for (int i = 0; i < 3; i++)
-        radioVersion += parts.at(i) + ".";
-    radioVersion += QString::number(build);
-
-    QString potentialText = QString("Potential OS and Radio links for SR " + _curRelease->srVersion() + " (OS " + _curRelease->osVersion() + " + Radio " + radioVersion + ")\n\n"
-                                    "* Operating Systems *\n");
-    appendNewHeader(&potentialText, "QC8974", "Blackberry Passport");
-    appendNewLink(&potentialText, "Debrick", "qc8960.factory_sfi_hybrid_qc8974.desktop", _curRelease->osVersion());
-    appendNewLink(&potentialText, "Core",    "qc8960.factory_sfi_hybrid_qc8974", _curRelease->osVersion());
-
-    appendNewHeader(&potentialText, "QC8960", "Blackberry Z10/Z30/Q5/Q10");
-    appendNewLink(&potentialText, "Debrick", "qc8960.factory_sfi.desktop", _curRelease->osVersion());
-    appendNewLink(&potentialText, "Core",    "qc8960.factory_sfi", _curRelease->osVersion());
-    
-    appendNewHeader(&potentialText, "QC8x30", "Blackberry Z3");
-    appendNewLink(&potentialText, "Debrick", "qc8960.factory_sfi_hybrid_qc8x30.desktop", _curRelease->osVersion());
-    appendNewLink(&potentialText, "Core",    "qc8960.factory_sfi_hybrid_qc8x30", _curRelease->osVersion());
-
-    appendNewHeader(&potentialText, "OMAP", "Blackberry Z10 STL 100-1");
-    appendNewLink(&potentialText, "Debrick", "winchester.factory_sfi.desktop", _curRelease->osVersion());
-    appendNewLink(&potentialText, "Core",    "winchester.factory_sfi", _curRelease->osVersion());
-
-    potentialText.append("\n\n* Radios *\n");
-    // Touch
-    appendNewLink(&potentialText, "Z30 + Classic + Leap", "qc8960.wtr5", radioVersion);
-    appendNewLink(&potentialText, "Z10 (STL 100-1)", "m5730", radioVersion);
-    appendNewLink(&potentialText, "Z10 (STL 100-2/3/4) + P9982", "qc8960", radioVersion);
-    appendNewLink(&potentialText, "Z3", "qc8930.wtr5", radioVersion);
-    // QWERTY
-    appendNewLink(&potentialText, "Passport + Ontario", "qc8974.wtr2", radioVersion);
-    appendNewLink(&potentialText, "Q5 + Q10 + P9983", "qc8960.wtr", radioVersion);
-    writeDisplayFile(tr("VersionLookup"), potentialText);
-}
-
-void Scanner::serverError(QNetworkReply::NetworkError err) {
-    Q_UNUSED(err);
-    completeScan();
-    sender()->deleteLater();
+    if (_curRelease == nullptr || _curRelease->baseUrl().isEmpty())
+        return;
+    _links->generate(_curRelease->baseUrl(), _curRelease->osVersion(), _curRelease->srVersion());
 }
 
+void Scanner::linksFound(QString report) {
+    writeDisplayFile(tr("VersionLookup"), report);
+}
@@ -20,7 +20,24 @@
 #include <QNetworkAccessManager>
 #include <QNetworkReply>
 #include <QQmlListProperty>
+#include <QMap>
+#include <QSettings>
 #include "discoveredrelease.h"
+#include "releasedatabase.h"
+#include "linkgenerator.h"
+
+// How many builds scanRange() looks up at once, unless changed in the settings
+#define LOOKUP_WINDOW 24
+#define LOOKUP_MAX_WINDOW 64
+
+// A build being looked up by scanRange()
+struct RangeBuild {
+    QString osVersion;
+    QString srVersion;
+    int servers;
+    int pending; // Replies still to come
+    QString baseUrl;
+};
 
 class Scanner : public QObject {
     Q_OBJECT
@@ -29,6 +46,13 @@ class Scanner : public QObject {
     Q_PROPERTY(bool isActive READ isActive WRITE setIsActive NOTIFY isActiveChanged)
     Q_PROPERTY(int findExisting READ findExisting WRITE setFindExisting NOTIFY findExistingChanged)
     Q_PROPERTY(DiscoveredRelease* curRelease READ curRelease NOTIFY curReleaseChanged)
+    Q_PROPERTY(int window READ window WRITE setWindow NOTIFY windowChanged)
+    Q_PROPERTY(bool skipKnown READ skipKnown WRITE setSkipKnown NOTIFY skipKnownChanged)
+    Q_PROPERTY(bool linksRunning READ linksRunning NOTIFY linksProgressChanged)
+    Q_PROPERTY(int linksDone READ linksDone NOTIFY linksProgressChanged)
+    Q_PROPERTY(int linksTotal READ linksTotal NOTIFY linksProgressChanged)
+    Q_PROPERTY(int rangeDone MEMBER _rangeDone NOTIFY rangeProgressChanged)
+    Q_PROPERTY(int rangeTotal MEMBER _rangeTotal NOTIFY rangeProgressChanged)
 
     Q_PROPERTY(QQmlListProperty<DiscoveredRelease> history READ history NOTIFY historyChanged)
 public:
@@ -40,8 +64,18 @@ public:
     , _findExisting(0)
     , _scansActive(0)
     , _curRelease(NULL)
+    , _rangeNext(0), _rangeEnd(-1), _rangeStep(1)
+    , _rangeHit(-1)
+    , _rangeDone(0), _rangeTotal(0)
     {
         _manager = new QNetworkAccessManager();
+        QSettings settings("Qtness","Sachesi");
+        _window = qBound(1, settings.value("lookupWindow", LOOKUP_WINDOW).toInt(), LOOKUP_MAX_WINDOW);
+        _skipKnown = settings.value("lookupSkipKnown", true).toBool();
+        _links = new LinkGenerator(_manager, this);
+        connect(_links, &LinkGenerator::progressChanged, this, &Scanner::linksProgressChanged);
+        connect(_links, &LinkGenerator::finished, this, &Scanner::linksFound);
+        loadHistory();
     }
     virtual ~Scanner() {}
     bool isAuto() const { return _isAuto; }
@@ -62,8 +96,7 @@ public:
                 if (_findExisting != 2 && (_findExisting != 1 || _curRelease->baseUrl() != "")) {
                     setIsAuto(false);
                 }
-                _history.prepend(_curRelease);
-                emit historyChanged();
+                remember(_curRelease);
             } else {
                 _curRelease->setSrVersion(tr("No Release"));
             }
@@ -78,21 +111,43 @@ public:
         _finishedScan = true; emit signalFinished();
         _finishedScan = false;
     }
-    void setIsAuto(bool isAuto) { _isAuto = isAuto; emit isAutoChanged(); }
+    void setIsAuto(bool isAuto) {
+        _isAuto = isAuto;
+        // Stopping an autoscan drops whatever it still has in flight
+        if (!isAuto && !_rangeBuilds.isEmpty()) {
+            cancelRange();
+            setIsActive(false);
+        }
+        emit isAutoChanged();
+    }
     void setIsActive(bool isActive) { _isActive = isActive; emit isActiveChanged(); }
     void setFindExisting(int findExisting) { _findExisting = findExisting; emit findExistingChanged(); }
 
     Q_INVOKABLE void clearHistory();
-    Q_INVOKABLE void exportHistory();
+    // Everything found so far, in this session or before. Can be narrowed to OS versions
+    // starting with 'osPrefix' and to releases on any of 'servers' (1 = production, 2 = beta, 4 = alpha).
+    Q_INVOKABLE void exportHistory(QString osPrefix = QString(), int servers = 0);
     Q_INVOKABLE void reverseLookup(QString OSver);
+    // Checks the OS and radio links every device family could have in the current release
     Q_INVOKABLE void generatePotentialLinks();
+    bool linksRunning() const { return _links->running(); }
+    int linksDone() const { return _links->done(); }
+    int linksTotal() const { return _links->total(); }
+    // Looks up <prefix>.<build> for every 'step'th build from 'fromBuild' to 'toBuild', many at
+    // once, and stops at the first one that findExisting asks for
+    Q_INVOKABLE void scanRange(QString prefix, int fromBuild, int toBuild, int step);
+    int window() const { return _window; }
+    void setWindow(int window);
+    bool skipKnown() const { return _skipKnown; }
+    void setSkipKnown(bool skipKnown);
 
     bool finishedScan() const { return _finishedScan; }
 
 private slots:
-    void newSRVersion();
     void validateDownload();
-    void serverError(QNetworkReply::NetworkError err);
+    void rangeReply();
+    void rangeValidated();
+    void linksFound(QString report);
 
 Q_SIGNALS:
     void signalFinished();
@@ -102,6 +157,10 @@ Q_SIGNALS:
     void softwareReleaseChanged();
     void curReleaseChanged();
     void historyChanged();
+    void windowChanged();
+    void skipKnownChanged();
+    void linksProgressChanged();
+    void rangeProgressChanged();
 
 private:
     bool _finishedScan;
@@ -113,5 +172,36 @@ private:
     QList<DiscoveredRelease*> _history;
     QNetworkAccessManager* _manager;
 
-    void appendNewLink(QString *potentialText, QString linkType, QString hwType, QString version);
+    void loadHistory();
+    // Adds a release to the history and the database
+    void remember(DiscoveredRelease* release);
+    // Whether the database already has what a scan of the OS would be looking for
+    bool isKnown(const QString& osVersion) const;
+    // The history entry of a release from the database
+    DiscoveredRelease* knownRelease(const QString& osVersion);
+
+    void newSRVersion(const QByteArray& data, const QString& host);
+    QString lookupQuery(const QString& osVersion) const;
+    QStringList lookupServers() const;
+    static QString releaseUrl(const QString& srVersion);
+    static int serverBit(const QString& host);
+    static QString readSRVersion(const QByteArray& data);
+
+    void cancelRange();
+    void pumpRange();
+    void startBuild(int build);
+    void buildDone(int build);
+    void rangeFound(int build, DiscoveredRelease* release);
+
+    int _window;
+    bool _skipKnown;
+    LinkGenerator* _links;
+    QString _rangePrefix;
+    int _rangeNext, _rangeEnd, _rangeStep;
+    // Lowest build found so far that ends the scan
+    int _rangeHit;
+    int _rangeDone, _rangeTotal;
+    QMap<int, RangeBuild> _rangeBuilds;
+    // Lookups and link checks, with the build they are for
+    QHash<QNetworkReply*, int> _rangeReplies;
 };
@@ -0,0 +1,77 @@
+// Copyright (C) 2014 Sacha Refshauge
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 3.0.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 3.0 for more details.
+
+// A copy of the GPL 3.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official GIT repository and contact information can be found at
+// http://github.com/xsacha/Sachesi
+
+#include "scanresultmodel.h"
+
+ScanResultModel::ScanResultModel(QObject* parent)
+    : QAbstractListModel(parent)
+{ }
+
+int ScanResultModel::rowCount(const QModelIndex& parent) const {
+    return parent.isValid() ? 0 : _results.count();
+}
+
+QVariant ScanResultModel::data(const QModelIndex& index, int role) const {
+    if (!index.isValid() || index.row() >= _results.count())
+        return QVariant();
+    const ScanResult& result = _results.at(index.row());
+    switch (role) {
+    case HwidRole: return result.hwid;
+    case Qt::DisplayRole:
+    case VariantRole: return result.variant;
+    case NpcRole: return result.npc;
+    case ModeRole: return result.mode;
+    case ResponseRole: return result.response;
+    case ReleaseRole: return result.release;
+    case OsRole: return result.os;
+    case RadioRole: return result.radio;
+    case PackagesRole: return result.packages;
+    case ErrorRole: return result.error;
+    }
+    return QVariant();
+}
+
+QHash<int, QByteArray> ScanResultModel::roleNames() const {
+    QHash<int, QByteArray> roles;
+    roles[HwidRole] = "hwid";
+    roles[VariantRole] = "variant";
+    roles[NpcRole] = "npc";
+    roles[ModeRole] = "mode";
+    roles[ResponseRole] = "response";
+    roles[ReleaseRole] = "release";
+    roles[OsRole] = "os";
+    roles[RadioRole] = "radio";
+    roles[PackagesRole] = "packages";
+    roles[ErrorRole] = "error";
+    return roles;
+}
+
+void ScanResultModel::append(const ScanResult& result) {
+    beginInsertRows(QModelIndex(), _results.count(), _results.count());
+    _results.append(result);
+    endInsertRows();
+    emit countChanged();
+}
+
+void ScanResultModel::clear() {
+    if (_results.isEmpty())
+        return;
+    beginResetModel();
+    _results.clear();
+    endResetModel();
+    emit countChanged();
+}
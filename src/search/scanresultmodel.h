@@ -0,0 +1,74 @@
+// Copyright (C) 2014 Sacha Refshauge
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 3.0.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 3.0 for more details.
+
+// A copy of the GPL 3.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official GIT repository and contact information can be found at
+// http://github.com/xsacha/Sachesi
+
+#pragma once
+
+#include <QAbstractListModel>
+#include <QVector>
+
+// One row of a scan: what a device, carrier and mode was offered
+struct ScanResult {
+    QString hwid;
+    QString variant;
+    QString npc;
+    QString mode; // "upgrade" or "repair"
+    int response; // Index of the distinct response, or -1 if the request failed
+    QString release;
+    QString os;
+    QString radio;
+    int packages;
+    QString error;
+};
+
+// The scan table for QML. Rows are only ever appended while a scan runs, so each
+// answer costs one row insert rather than a copy of everything found so far.
+class ScanResultModel : public QAbstractListModel {
+    Q_OBJECT
+    Q_PROPERTY(int count READ count NOTIFY countChanged)
+
+public:
+    enum Roles {
+        HwidRole = Qt::UserRole + 1,
+        VariantRole,
+        NpcRole,
+        ModeRole,
+        ResponseRole,
+        ReleaseRole,
+        OsRole,
+        RadioRole,
+        PackagesRole,
+        ErrorRole,
+    };
+
+    ScanResultModel(QObject* parent = 0);
+
+    int rowCount(const QModelIndex& parent = QModelIndex()) const;
+    QVariant data(const QModelIndex& index, int role) const;
+    QHash<int, QByteArray> roleNames() const;
+
+    int count() const { return _results.count(); }
+    const QVector<ScanResult>& results() const { return _results; }
+    const ScanResult& at(int row) const { return _results.at(row); }
+    void append(const ScanResult& result);
+    void clear();
+
+signals:
+    void countChanged();
+
+private:
+    QVector<ScanResult> _results;
+};
@@ -0,0 +1,118 @@
+// Copyright (C) 2014 Sacha Refshauge
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 3.0.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 3.0 for more details.
+
+// A copy of the GPL 3.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official GIT repository and contact information can be found at
+// http://github.com/xsacha/Sachesi
+
+#include "updateparser.h"
+#include <QStringList>
+
+UpdateParser::UpdateParser(QObject* parent)
+    : QObject(parent)
+{
+    qRegisterMetaType<UpdateResult>("UpdateResult");
+}
+
+UpdateParser::~UpdateParser() {
+    qDeleteAll(_states);
+}
+
+void UpdateParser::pump(State* state) {
+    QXmlStreamReader& xml = state->xml;
+    while (!xml.atEnd()) {
+        QXmlStreamReader::TokenType token = xml.readNext();
+        // Out of data for now. Anything else is a broken response, which is read as far as it goes.
+        if (token == QXmlStreamReader::Invalid)
+            break;
+        if (token == QXmlStreamReader::Characters) {
+            if (state->inMessage)
+                state->result.message += xml.text().toString();
+            continue;
+        }
+        if (token == QXmlStreamReader::EndElement) {
+            if (xml.name() == "friendlyMessage")
+                state->inMessage = false;
+            continue;
+        }
+        if (token != QXmlStreamReader::StartElement)
+            continue;
+
+        if (xml.name() == "package") {
+            PackageInfo package;
+            // Remember: these *can* change
+            package.friendlyName = xml.attributes().value("name").toString();
+            package.name = xml.attributes().value("path").toString().split('/').last();
+            package.size = xml.attributes().value("downloadSize").toString().toInt();
+            package.version = xml.attributes().value("version").toString();
+            package.packageId = xml.attributes().value("id").toString();
+            package.checksum = xml.attributes().value("checksum").toString();
+            QString type = xml.attributes().value("type").toString();
+            if (type == "system:os" || type == "system:desktop") {
+                package.type = "os";
+                state->result.os = package.version;
+            } else if (type == "system:radio") {
+                package.type = "radio";
+                state->result.radio = package.version;
+            } else
+                package.type = "application";
+            // For lack of a better name, the url
+            package.url = state->fileSet + "/" + package.name;
+            state->result.packages.append(package);
+        } else if (xml.name() == "friendlyMessage") {
+            state->inMessage = true;
+            state->result.message.clear();
+        } else if (xml.name() == "fileSet") {
+            state->fileSet = xml.attributes().value("url").toString();
+        } else if (xml.name() == "softwareReleaseMetadata") {
+            state->result.release = xml.attributes().value("softwareReleaseVersion").toString();
+        } else if (xml.name() == "bundle") {
+            QString newver = xml.attributes().value("version").toString();
+            if (state->result.release == "" || (state->result.release.split(".").last().toInt() < newver.split(".").last().toInt()))
+                state->result.release = newver;
+        }
+    }
+}
+
+UpdateResult UpdateParser::parse(const QByteArray& data) {
+    State state;
+    state.xml.addData(data);
+    pump(&state);
+    state.result.message = state.result.message.split(QChar('.'))[0];
+    return state.result;
+}
+
+void UpdateParser::feed(int id, QByteArray data) {
+    State* state = _states.value(id);
+    if (state == nullptr) {
+        state = new State();
+        _states.insert(id, state);
+    }
+    state->xml.addData(data);
+    pump(state);
+}
+
+void UpdateParser::restart(int id) {
+    delete _states.take(id);
+}
+
+void UpdateParser::finish(int id, QString variant) {
+    State* state = _states.take(id);
+    UpdateResult result;
+    if (state != nullptr) {
+        result = state->result;
+        result.message = result.message.split(QChar('.'))[0];
+        delete state;
+    }
+    emit parsed(id, variant, result);
+}
@@ -0,0 +1,78 @@
+// Copyright (C) 2014 Sacha Refshauge
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 3.0.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 3.0 for more details.
+
+// A copy of the GPL 3.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official GIT repository and contact information can be found at
+// http://github.com/xsacha/Sachesi
+
+#pragma once
+
+#include <QObject>
+#include <QHash>
+#include <QList>
+#include <QMetaType>
+#include <QXmlStreamReader>
+
+// A <package> of an updateDetails response
+struct PackageInfo {
+    QString friendlyName;
+    QString name;
+    QString url;
+    QString version;
+    QString packageId;
+    QString checksum;
+    QString type; // os, radio or application
+    int size;
+};
+
+struct UpdateResult {
+    QString release;
+    QString os;
+    QString radio;
+    QString message; // friendlyMessage, up to the first full stop
+    QList<PackageInfo> packages;
+};
+Q_DECLARE_METATYPE(UpdateResult)
+
+// Reads updateDetails responses as they arrive. Lives on its own thread, so that
+// large responses don't hold up the UI; only the finished result is passed back.
+class UpdateParser : public QObject {
+    Q_OBJECT
+public:
+    explicit UpdateParser(QObject* parent = 0);
+    ~UpdateParser();
+
+    // A whole response at once, on whatever thread calls it
+    static UpdateResult parse(const QByteArray& data);
+
+public slots:
+    void feed(int id, QByteArray data);
+    // Starts 'id' over, for when the data seen so far turns out to be the wrong answer
+    void restart(int id);
+    void finish(int id, QString variant);
+
+signals:
+    void parsed(int id, QString variant, UpdateResult result);
+
+private:
+    struct State {
+        QXmlStreamReader xml;
+        UpdateResult result;
+        QString fileSet; // Base URL of the packages that follow
+        bool inMessage;
+        State() : inMessage(false) {}
+    };
+    // Reads as far as the data goes
+    static void pump(State* state);
+    QHash<int, State*> _states;
+};
@@ -39,8 +39,12 @@ void Splitter::processExtractWrapper()
     else // Assume it is a rcfs/qnx6/ifs
         processExtractType();
 
-    // Now we should be done parsing through the entire file and its components
-    // So run through the partition Info we collected
+    extractPartitions(QFileInfo(selectedFile).absolutePath());
+}
+
+// Runs through the partition Info we collected and extracts each one
+void Splitter::extractPartitions(QString baseDir)
+{
     // First gather sizes so we can have an established goal in the UI
     for (int i = 0; i < partitionInfo.count(); i++)
     {
@@ -51,9 +55,10 @@ void Splitter::processExtractWrapper()
     }
 
     // All files will be extracted relative to the given container file
-    QString baseDir = QFileInfo(selectedFile).absolutePath();
     foreach (PartitionInfo info, partitionInfo)
     {
+        if (kill)
+            break;
         int unique = newProgressInfo(info.size);
         // If we are extracting FS images (only type supported for this method right now), then we want to create a filesystem type
         QFileSystem *fs = createTypedFileSystem(selectedFile, info.dev, info.type, info.offset, info.size, baseDir);
@@ -68,10 +73,16 @@ void Splitter::processExtractWrapper()
             // We need to make Splitter a QML-exposed class, then it's nicer to push these signals
             // QObject::connect(fs, SIGNAL(currentNameChanged(QString)), this, SLOT()));
         }
-        if (extractImage)
-            fs->extractImage();
-        else
-            fs->extractContents();
+        if (extractTypes & EXTRACT_MANIFEST)
+            fs->setManifest(QFileHash::XXH64);
+        if (extractTypes & EXTRACT_TO_TAR)
+            fs->setSinkType(SinkTar);
+        else if (extractTypes & EXTRACT_TO_ZIP)
+            fs->setSinkType(SinkZip);
+        bool ok = extractImage ? fs->extractImage() : fs->extractContents();
+        // Extraction stops at the first file that can't be read or written
+        if (!ok && !kill)
+            emit error(QString("Could not extract %1 completely.").arg(QFileInfo(selectedFile).fileName()));
 
         delete fs;
     }
@@ -82,22 +93,99 @@ void Splitter::processExtractWrapper()
     progressInfo.clear();
 }
 
-// Process an Autoloader with the aim of extracting files
-void Splitter::processExtractAutoloader()
+// Extracts from a device that is still being filled, such as a download in progress.
+// Reads block until the data arrives, so everything is done front to back where possible:
+// a .signed stored in a .bar is found from its local header and extracted in place.
+// A .bar carries one OS or radio image, so the walk stops there.
+// A compressed .signed has to wait for the central directory at the end.
+void Splitter::processExtractStream()
+{
+    extracting = true;
+    progressInfo.clear();
+    partitionInfo.clear();
+    QIODevice* dev = devHandle.first();
+    QString baseDir = QFileInfo(selectedFile).absolutePath();
+
+    if (QFileInfo(selectedFile).suffix() == "signed")
+    {
+        processExtract(dev, dev->size(), 0);
+        return extractPartitions(baseDir);
+    }
+
+    // Walk the local file headers of the zip
+    QNXStream zipStream(dev);
+    qint64 pos = 0;
+    bool found = false;
+    while (!kill && pos + 30 <= dev->size())
+    {
+        dev->seek(pos);
+        quint32 signature;
+        quint16 version, flags, method, time, date, nameLen, extraLen;
+        quint32 crc, compSize, uncompSize;
+        zipStream >> signature >> version >> flags >> method >> time >> date;
+        zipStream >> crc >> compSize >> uncompSize >> nameLen >> extraLen;
+        // Sizes come after the data, so there is no way to skip ahead
+        if (signature != 0x04034b50 || (flags & 8))
+            break;
+        QString name = QString::fromUtf8(dev->read(nameLen));
+        qint64 dataPos = pos + 30 + nameLen + extraLen;
+        if (method == 0 && QFileInfo(name).suffix() == "signed")
+        {
+            found = true;
+            if (uncompSize > 1024 * 1024 * 5)
+            {
+                // Extract now. The next header is past the end of the image and
+                // reading it would wait for nearly the whole download.
+                processExtract(dev, uncompSize, dataPos);
+                break;
+            }
+        }
+        pos = dataPos + compSize;
+    }
+    if (!found && !kill)
+    {
+        // Compressed, so let QuaZip find it once the whole file is here
+        QuaZip barFile(dev);
+        barFile.open(QuaZip::mdUnzip);
+        QList<QuaZipFile*> signedFiles;
+        foreach (QString signedName, barFile.getFileNameList())
+        {
+            if (QFileInfo(signedName).suffix() != "signed")
+                continue;
+            barFile.setCurrentFile(signedName);
+            QuaZipFile *signedFile = new QuaZipFile(&barFile);
+            if (!signedFile->open(QIODevice::ReadOnly))
+            {
+                delete signedFile;
+                continue;
+            }
+            signedFiles.append(signedFile);
+            if (signedFile->size() > 1024 * 1024 * 5)
+                processExtract(signedFile, signedFile->size(), 0);
+        }
+        extractPartitions(baseDir);
+        // These read through barFile, so they have to go before it does
+        qDeleteAll(signedFiles);
+        barFile.close();
+        return;
+    }
+    extractPartitions(baseDir);
+}
+
+// Finds the offset table of an Autoloader. The last offset is the end of the file.
+QList<qint64> Splitter::readAutoloaderOffsets(QIODevice *autoloaderFile, QString *error)
 {
     // We hardcode this only to speed it up. It isn't required and may cause issues later on.
 #define START_CAP_SEARCH 0x400000
 #define END_CAP_SEARCH 0x1000000
-    QFile *autoloaderFile = new QFile(selectedFile);
-    devHandle.append(autoloaderFile);
-    autoloaderFile->open(QIODevice::ReadOnly);
-    read = 0;
-    maxSize = 1;
+    QList<qint64> offsets;
     int findHeader = 0;
     autoloaderFile->seek(START_CAP_SEARCH);
     for (int b = START_CAP_SEARCH; b < END_CAP_SEARCH;)
     {
         QByteArray tmp = autoloaderFile->read(BUFFER_LEN);
+        if (tmp.size() < BUFFER_LEN)
+            break;
         for (int i = 0; i < BUFFER_LEN - 12; i++)
         {
             if (tmp.at(i) == (char)0x9C && tmp.at(i + 1) == (char)0xD5 && tmp.at(i + 2) == (char)0xC5 && tmp.at(i + 3) == (char)0x97 &&
@@ -111,11 +199,12 @@ void Splitter::processExtractAutoloader()
 
     if (!findHeader)
     {
-        return die(tr("Was not a Blackberry Autoloader file."));
+        if (error)
+            *error = tr("Was not a Blackberry Autoloader file.");
+        return offsets;
     }
 
-    qint64 files;
-    QList<qint64> offsets;
+    qint64 files = 0;
     QNXStream dataStream(autoloaderFile);
     autoloaderFile->seek(findHeader);
 
@@ -134,7 +223,9 @@ void Splitter::processExtractAutoloader()
 
     if (files < 1 || files > 20)
     {
-        return die(tr("Unknown Blackberry Autoloader file."));
+        if (error)
+            *error = tr("Unknown Blackberry Autoloader file.");
+        return offsets;
     }
 
     // Collect offsets
@@ -144,6 +235,26 @@ void Splitter::processExtractAutoloader()
         dataStream >> offsets[i];
     }
     offsets.append(autoloaderFile->size()); // End of file
+    return offsets;
+}
+
+// Process an Autoloader with the aim of extracting files
+void Splitter::processExtractAutoloader()
+{
+    QFile *autoloaderFile = new QFile(selectedFile);
+    devHandle.append(autoloaderFile);
+    autoloaderFile->open(QIODevice::ReadOnly);
+    read = 0;
+    maxSize = 1;
+
+    QString error;
+    QList<qint64> offsets = readAutoloaderOffsets(autoloaderFile, &error);
+    if (offsets.isEmpty())
+    {
+        return die(error);
+    }
+    int files = offsets.count() - 1;
+    QNXStream dataStream(autoloaderFile);
 
     // Create sizes and files
     QString baseName = selectedFile;
@@ -334,6 +445,29 @@ void Splitter::processExtractType()
     partitionInfo.append(PartitionInfo(imageFile, 0, imageFile->size()));
 }
 
+// Packs the folder selectedFile in to a new .qnx6 image next to it
+void Splitter::processCreateQNX6()
+{
+    QString folder = QDir::cleanPath(selectedFile);
+    QString output = folder + ".qnx6";
+    for (int i = 2; QFile::exists(output); i++)
+        output = folder + QString::number(i) + ".qnx6";
+
+    // There is nothing to read yet, so the filesystem doesn't get a device
+    FS::QNX6 qnx6(output, nullptr, 0, 0, QFileInfo(output).absolutePath());
+    int unique = newProgressInfo(1);
+    connect(&qnx6, &QFileSystem::sizeChanged, [&](qint64 delta)
+            {
+                // The total is only known once the folder has been scanned
+                maxSize = qMax(qnx6.maxSize, (qint64)1);
+                progressInfo[unique].maxSize = maxSize;
+                updateCurProgress(unique, qnx6.curSize, delta); });
+    if (!qnx6.createImageFromFolder(folder, output))
+        return die(tr("Could not create %1").arg(output));
+    emit finished();
+    progressInfo.clear();
+}
+
 QFileSystem *Splitter::createTypedFileSystem(QString name, QIODevice *dev, QFileSystemType type, qint64 offset, qint64 size, QString baseDir)
 {
     if (type == FS_RCFS)
@@ -346,20 +480,18 @@ QFileSystem *Splitter::createTypedFileSystem(QString name, QIODevice *dev, QFile
     return nullptr;
 }
 
-void Splitter::processExtract(QIODevice *dev, qint64 signedSize, qint64 signedPos)
+// Reads the partition table of a .signed image starting at signedPos
+QList<PartitionInfo> Splitter::readPartitions(QIODevice *dev, qint64 signedSize, qint64 signedPos, QString *error)
 {
-    qDebug() << "Starting processExtract";
-    qDebug() << "signedSize:" << signedSize << "signedPos:" << signedPos;
-
-    if (signedPos > 0)
-        dev->seek(signedPos);
+    QList<PartitionInfo> partInfo;
+    dev->seek(signedPos);
     if (dev->read(4) != QByteArray("mfcq", 4))
     {
-        QMessageBox::information(nullptr, "Error", "Was not a Blackberry .signed image.");
+        if (error)
+            *error = "Was not a Blackberry .signed image.";
         qDebug() << "Not a Blackberry .signed image.";
-        return;
+        return partInfo;
     }
-    QList<PartitionInfo> partInfo;
     dev->seek(signedPos + 12);
 
     // We are now at the partition table
@@ -376,9 +508,10 @@ void Splitter::processExtract(QIODevice *dev, qint64 signedSize, qint64 signedPo
 
     if (numPartitions > 15)
     {
-        QMessageBox::information(nullptr, "Error", "Bad partition table.");
+        if (error)
+            *error = "Bad partition table.";
         qDebug() << "Bad partition table.";
-        return;
+        return partInfo;
     }
 
     partInfo.append(PartitionInfo(dev, signedPos + firstOffset));
@@ -413,6 +546,21 @@ void Splitter::processExtract(QIODevice *dev, qint64 signedSize, qint64 signedPo
         qDebug() << "Removing last partition due to small size.";
         partInfo.removeLast();
     }
+    return partInfo;
+}
+
+void Splitter::processExtract(QIODevice *dev, qint64 signedSize, qint64 signedPos)
+{
+    qDebug() << "Starting processExtract";
+    qDebug() << "signedSize:" << signedSize << "signedPos:" << signedPos;
+
+    QString error;
+    QList<PartitionInfo> partInfo = readPartitions(dev, signedSize, signedPos, &error);
+    if (!error.isEmpty())
+    {
+        QMessageBox::information(nullptr, "Error", error);
+        return;
+    }
 
     // Add to the main partition list
     foreach (PartitionInfo info, partInfo)
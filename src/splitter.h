@@ -86,6 +86,11 @@ struct PartitionInfo {
 #define PACKED_FILE_IFS     (1 << 3)
 #define PACKED_FILE_PINLIST (1 << 4)
 
+// Extraction options, alongside the QFileSystemType bits
+#define EXTRACT_MANIFEST    (1 << 3)
+#define EXTRACT_TO_TAR      (1 << 4)
+#define EXTRACT_TO_ZIP      (1 << 5)
+
 class Splitter: public QObject {
     Q_OBJECT
 
@@ -94,6 +99,8 @@ public:
     Splitter(QString file, int options) : option(options), selectedFile(file)  { reset(); }
     Splitter(QStringList files) : selectedFiles(files)  { reset(); }
     Splitter(QList<QUrl> urls) : selectedUrls(urls) { reset(); }
+    // Extract from a device that isn't finished yet. 'file' is where it will end up.
+    Splitter(QIODevice* dev, QString file) : selectedFile(file) { reset(); devHandle.append(dev); }
     ~Splitter() { }
     bool extractApps, extractImage;
     int extractTypes;
@@ -241,12 +248,17 @@ public slots:
         emit finished();
     }
 
+    static QList<PartitionInfo> readPartitions(QIODevice* dev, qint64 signedSize, qint64 signedPos, QString* error = nullptr);
+    static QList<qint64> readAutoloaderOffsets(QIODevice* dev, QString* error = nullptr);
     void processExtractSigned();
     void processExtract(QIODevice* dev, qint64 signedSize, qint64 signedPos);
     void processExtractType();
+    void processCreateQNX6();
     QFileSystem* createTypedFileSystem(QString name, QIODevice* dev, QFileSystemType type, qint64 offset = 0, qint64 size = 0, QString baseDir = ".");
 
     void processExtractWrapper();
+    void processExtractStream();
+    void extractPartitions(QString baseDir);
 
     // Old, compatibility
     quint64 updateProgress(qint64 delta) {
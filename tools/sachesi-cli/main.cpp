@@ -0,0 +1,237 @@
+// Copyright (C) 2014 Sacha Refshauge
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 3.0.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 3.0 for more details.
+
+// A copy of the GPL 3.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official GIT repository and contact information can be found at
+// http://github.com/xsacha/Sachesi
+
+// Downloads a list of links the same way the GUI does, without a display.
+// Files are resumed from whatever an earlier run left behind and several run at once.
+// Progress and errors are written to stdout as one JSON object per line.
+
+#include <QCoreApplication>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTimer>
+#include <stdio.h>
+
+#include "downloadinfo.h"
+#include "bandwidth.h"
+
+// How often progress is printed (ms)
+#define CLI_PROGRESS_INTERVAL 1000
+
+struct Link {
+    QString url;
+    qint64 size;
+    QString checksum;
+};
+
+static void emitEvent(const QString& event, QJsonObject fields = QJsonObject()) {
+    fields.insert("event", event);
+    fputs(QJsonDocument(fields).toJson(QJsonDocument::Compact).constData(), stdout);
+    fputc('\n', stdout);
+    fflush(stdout);
+}
+
+// "url [size] [checksum]", as one argument or one line of a list file
+static bool parseLink(const QString& line, Link* link) {
+    QStringList parts = line.split(QRegExp("[\\s,]+"), QString::SkipEmptyParts);
+    if (parts.isEmpty() || parts.first().startsWith('#'))
+        return false;
+    link->url = parts.at(0);
+    link->size = parts.count() > 1 ? parts.at(1).toLongLong() : 0;
+    link->checksum = parts.count() > 2 ? parts.at(2) : QString();
+    return true;
+}
+
+static int usage(const char* name) {
+    fprintf(stderr, "Usage: %s download [options] <url[,size[,checksum]]|@list>...\n", name);
+    fprintf(stderr, "  --out <dir>          Where the files go (default: current directory)\n");
+    fprintf(stderr, "  --parallel <n>       Files downloaded at once (1-%d)\n", MAX_PARALLEL_DOWNLOADS);
+    fprintf(stderr, "  --on-mismatch <a>    keep, discard or abort when a size or checksum is wrong (default: discard)\n");
+    fprintf(stderr, "  --retries <n>        How often a file is discarded and fetched again before giving up (default: 2)\n");
+    fprintf(stderr, "A list has one link per line. Links without a size are looked up on the server first.\n");
+    return 2;
+}
+
+int main(int argc, char* argv[]) {
+    QCoreApplication app(argc, argv);
+    // The same settings and caches as the GUI
+    app.setOrganizationName("Qtness");
+    app.setOrganizationDomain("qtness.com");
+    app.setApplicationName("Sachesi");
+
+    QStringList args = app.arguments();
+    if (args.count() < 2 || args.at(1) != "download")
+        return usage(argv[0]);
+
+    QString outDir = getSaveDir();
+    int parallel = 0;
+    QString onMismatch = "discard";
+    int retries = 2;
+    QList<Link> links;
+    for (int i = 2; i < args.count(); i++) {
+        QString arg = args.at(i);
+        bool hasValue = i + 1 < args.count();
+        if (arg == "--out" && hasValue)
+            outDir = args.at(++i);
+        else if (arg == "--parallel" && hasValue)
+            parallel = args.at(++i).toInt();
+        else if (arg == "--on-mismatch" && hasValue)
+            onMismatch = args.at(++i);
+        else if (arg == "--retries" && hasValue)
+            retries = args.at(++i).toInt();
+        else if (arg.startsWith("--"))
+            return usage(argv[0]);
+        else if (arg.startsWith('@')) {
+            QFile list(arg.mid(1));
+            if (!list.open(QIODevice::ReadOnly | QIODevice::Text)) {
+                fprintf(stderr, "Could not open %s\n", arg.mid(1).toLocal8Bit().constData());
+                return 1;
+            }
+            while (!list.atEnd()) {
+                Link link;
+                if (parseLink(QString::fromUtf8(list.readLine()), &link))
+                    links.append(link);
+            }
+        } else {
+            Link link;
+            if (parseLink(arg, &link))
+                links.append(link);
+        }
+    }
+    if (links.isEmpty() || (onMismatch != "keep" && onMismatch != "discard" && onMismatch != "abort"))
+        return usage(argv[0]);
+
+    DownloadInfo download;
+    if (parallel > 0)
+        download.useParallel(parallel);
+
+    int exitCode = 0;
+    QHash<QString, int> discarded;
+    DownloadPolicy policy;
+    policy.mismatch = [&](const QString& fileName, const QString& issue) {
+        DownloadPolicy::Action action = DownloadPolicy::Keep;
+        if (onMismatch == "abort")
+            action = DownloadPolicy::Abort;
+        else if (onMismatch == "discard")
+            action = (discarded[fileName]++ < retries) ? DownloadPolicy::Discard : DownloadPolicy::Abort;
+        QJsonObject fields;
+        fields.insert("file", fileName);
+        fields.insert("message", issue);
+        fields.insert("action", action == DownloadPolicy::Keep ? "keep" : action == DownloadPolicy::Discard ? "discard" : "abort");
+        emitEvent("issue", fields);
+        if (action == DownloadPolicy::Abort) {
+            exitCode = 1;
+            app.exit(exitCode);
+        }
+        return action;
+    };
+    policy.error = [&](const QString& error) {
+        QJsonObject fields;
+        fields.insert("message", error);
+        emitEvent("error", fields);
+        exitCode = 1;
+        app.exit(exitCode);
+    };
+    policy.finished = [&](const QString& baseDir) {
+        QJsonObject fields;
+        fields.insert("dir", baseDir);
+        emitEvent("done", fields);
+        app.exit(exitCode);
+    };
+    download.setPolicy(policy);
+
+    QObject::connect(&download, &DownloadInfo::fileCompleted, [&](QString fileName) {
+        QJsonObject fields;
+        fields.insert("file", fileName);
+        emitEvent("file", fields);
+    });
+
+    QTimer progressTimer;
+    progressTimer.setInterval(CLI_PROGRESS_INTERVAL);
+    QObject::connect(&progressTimer, &QTimer::timeout, [&]() {
+        if (!download.running)
+            return;
+        QJsonObject fields;
+        fields.insert("received", (double)download.size);
+        fields.insert("total", (double)download.totalSize);
+        fields.insert("files", download.id);
+        fields.insert("maxFiles", download.maxId);
+        fields.insert("active", download.active());
+        fields.insert("rate", (double)Bandwidth::instance()->downloadRate());
+        emitEvent("progress", fields);
+    });
+
+    // Sizes are needed up front. Anything not given is asked of the server.
+    QNetworkAccessManager manager;
+    LinkVerifier verifier(&manager);
+    QList<Apps*> apps;
+    int toVerify = 0;
+    auto begin = [&]() {
+        download.setAppsIn(apps, outDir);
+        qDeleteAll(apps);
+        apps.clear();
+        QJsonObject fields;
+        fields.insert("files", download.maxId);
+        fields.insert("total", (double)download.totalSize);
+        emitEvent("start", fields);
+        if (download.maxId == 0) {
+            // Everything is already there
+            fields = QJsonObject();
+            fields.insert("dir", outDir);
+            emitEvent("done", fields);
+            app.exit(0);
+            return;
+        }
+        progressTimer.start();
+        download.download(false);
+    };
+    foreach (Link link, links) {
+        Apps* file = new Apps();
+        file->setUrl(link.url);
+        file->setName(link.url.split('/').last());
+        // Applications are the ones skipped when they are already complete in the folder
+        file->setType("application");
+        file->setIsMarked(true);
+        file->setSize(link.size);
+        file->setChecksum(link.checksum);
+        apps.append(file);
+        if (link.size > 0)
+            continue;
+        toVerify++;
+        verifier.verify(link.url, [&, file](const VerifyResult& result) {
+            if (!result.found()) {
+                QJsonObject fields;
+                fields.insert("message", QString("%1 is not on the server (%2)").arg(file->url()).arg(result.status));
+                emitEvent("error", fields);
+                exitCode = 1;
+                app.exit(exitCode);
+                return;
+            }
+            file->setSize(result.length);
+            if (--toVerify == 0)
+                begin();
+        });
+    }
+    QTimer startTimer;
+    startTimer.setSingleShot(true);
+    QObject::connect(&startTimer, &QTimer::timeout, begin);
+    if (toVerify == 0)
+        startTimer.start(0);
+
+    int ret = app.exec();
+    qDeleteAll(apps);
+    return ret ? ret : exitCode;
+}
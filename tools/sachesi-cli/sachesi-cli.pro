@@ -0,0 +1,32 @@
+# Headless downloader: sachesi-cli download [options] <links>. Needs no display.
+QT = core network
+TEMPLATE = app
+TARGET = sachesi-cli
+CONFIG += console c++11
+CONFIG -= app_bundle
+
+P = $$_PRO_FILE_PWD_/../..
+INCLUDEPATH += $$P/src
+
+SOURCES += \
+    main.cpp \
+    $$P/src/portscore.cpp \
+    $$P/src/apps.cpp \
+    $$P/src/downloadfile.cpp \
+    $$P/src/linkverifier.cpp \
+    $$P/src/deltaplanner.cpp \
+    $$P/src/downloadstore.cpp \
+    $$P/src/bandwidth.cpp \
+    $$P/src/search/releasedatabase.cpp
+
+HEADERS += \
+    $$P/src/portscore.h \
+    $$P/src/packedversion.h \
+    $$P/src/apps.h \
+    $$P/src/downloadinfo.h \
+    $$P/src/downloadfile.h \
+    $$P/src/linkverifier.h \
+    $$P/src/deltaplanner.h \
+    $$P/src/downloadstore.h \
+    $$P/src/bandwidth.h \
+    $$P/src/search/releasedatabase.h
@@ -0,0 +1,263 @@
+// Copyright (C) 2014 Sacha Refshauge
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 3.0.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 3.0 for more details.
+
+// A copy of the GPL 3.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official GIT repository and contact information can be found at
+// http://github.com/xsacha/Sachesi
+
+// Mounts the partitions of a .signed, Autoloader or raw filesystem image read-only.
+// Each partition shows up in the root as p<n>.qnx6, p<n>.rcfs or p<n>.ifs.
+// Nothing is extracted: each tree is indexed in to a QNodeTable and data is read on demand.
+
+#define FUSE_USE_VERSION 26
+#include <fuse.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <stdio.h>
+
+#include "splitter.h"
+
+struct Partition {
+    QString name;
+    QFileSystem* fs;
+    const QNodeTable* nodes;
+};
+
+static QFile* image = nullptr;
+static QList<Partition> partitions;
+
+// The directory of the last lookup. The kernel asks about every entry of a directory
+// after listing it, so only the last part of those paths needs looking up.
+static QString lastDir;
+static int lastDirPart = -1;
+static quint32 lastDirNode = NODE_NONE;
+
+// Splits /p<n>.<type>/rest in to a partition and a node of its table. Node NODE_NONE with
+// partition -1 is the mount root.
+static bool lookup(const QString& path, int* part, quint32* node) {
+    int slash = path.lastIndexOf('/');
+    if (slash > 0 && lastDirPart >= 0 && path.leftRef(slash) == lastDir) {
+        *part = lastDirPart;
+        *node = partitions.at(lastDirPart).nodes->child(lastDirNode, path.mid(slash + 1));
+        return *node != NODE_NONE;
+    }
+    QStringList parts = path.split('/', QString::SkipEmptyParts);
+    *part = -1;
+    *node = NODE_NONE;
+    if (parts.isEmpty())
+        return true;
+    QString partName = parts.takeFirst();
+    for (int i = 0; i < partitions.count(); i++) {
+        if (partitions.at(i).name == partName) {
+            const QNodeTable* nodes = partitions.at(i).nodes;
+            *part = i;
+            *node = nodes->find(parts.join("/"));
+            if (*node == NODE_NONE)
+                return false;
+            if (nodes->isDir(*node)) {
+                lastDir = path;
+                while (lastDir.endsWith('/'))
+                    lastDir.chop(1);
+                lastDirPart = i;
+                lastDirNode = *node;
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+static void fillStat(int part, quint32 index, struct stat* st) {
+    memset(st, 0, sizeof(struct stat));
+    if (part == -1) {
+        st->st_mode = S_IFDIR | 0555;
+        st->st_nlink = 2;
+        return;
+    }
+    const QNodeTable* nodes = partitions.at(part).nodes;
+    const QFileNode& node = nodes->node(index);
+    if (nodes->isDir(index)) {
+        st->st_mode = S_IFDIR | 0555;
+        st->st_nlink = 2;
+    } else if (nodes->isLink(index)) {
+        st->st_mode = S_IFLNK | 0777;
+        st->st_nlink = 1;
+    } else {
+        st->st_mode = S_IFREG | 0444 | (node.mode & 0111);
+        st->st_nlink = 1;
+        st->st_size = node.size;
+    }
+    st->st_mtime = st->st_ctime = st->st_atime = node.time;
+}
+
+static int sachesi_getattr(const char* cpath, struct stat* st) {
+    int part;
+    quint32 index;
+    if (!lookup(QString::fromUtf8(cpath), &part, &index))
+        return -ENOENT;
+    fillStat(part, index, st);
+    return 0;
+}
+
+// Attributes are handed over with the names. FUSE 2 still asks getattr for each of them,
+// which is a single hashed lookup through the directory cache above.
+static int sachesi_readdir(const char* cpath, void* buf, fuse_fill_dir_t filler, off_t offset, struct fuse_file_info* fi) {
+    Q_UNUSED(offset);
+    Q_UNUSED(fi);
+    int part;
+    quint32 index;
+    if (!lookup(QString::fromUtf8(cpath), &part, &index))
+        return -ENOENT;
+    struct stat st;
+    fillStat(part, index, &st);
+    filler(buf, ".", &st, 0);
+    filler(buf, "..", nullptr, 0);
+    if (part == -1) {
+        for (int i = 0; i < partitions.count(); i++) {
+            fillStat(i, 0, &st);
+            filler(buf, partitions.at(i).name.toUtf8().constData(), &st, 0);
+        }
+        return 0;
+    }
+    const QNodeTable* nodes = partitions.at(part).nodes;
+    if (!nodes->isDir(index))
+        return -ENOTDIR;
+    for (quint32 child = nodes->node(index).firstChild; child != NODE_NONE; child = nodes->node(child).nextSibling) {
+        fillStat(part, child, &st);
+        filler(buf, nodes->name(child).toUtf8().constData(), &st, 0);
+    }
+    return 0;
+}
+
+static int sachesi_open(const char* cpath, struct fuse_file_info* fi) {
+    int part;
+    quint32 index;
+    if (!lookup(QString::fromUtf8(cpath), &part, &index))
+        return -ENOENT;
+    if (part == -1 || partitions.at(part).nodes->isDir(index))
+        return -EISDIR;
+    if ((fi->flags & O_ACCMODE) != O_RDONLY)
+        return -EROFS;
+    return 0;
+}
+
+static int sachesi_read(const char* cpath, char* buf, size_t size, off_t offset, struct fuse_file_info* fi) {
+    Q_UNUSED(fi);
+    int part;
+    quint32 index;
+    if (!lookup(QString::fromUtf8(cpath), &part, &index) || part == -1)
+        return -ENOENT;
+    qint64 read = partitions.at(part).fs->readNode(index, buf, offset, size);
+    return read < 0 ? -EIO : (int)read;
+}
+
+static int sachesi_readlink(const char* cpath, char* buf, size_t size) {
+    int part;
+    quint32 index;
+    if (!lookup(QString::fromUtf8(cpath), &part, &index) || part == -1)
+        return -ENOENT;
+    if (!partitions.at(part).nodes->isLink(index) || size == 0)
+        return -EINVAL;
+    QByteArray target = partitions.at(part).fs->readLink(index).toUtf8();
+    int len = qMin((int)size - 1, target.size());
+    memcpy(buf, target.constData(), len);
+    buf[len] = 0;
+    return 0;
+}
+
+// Works out which partitions are in the image, the same way Splitter does for extraction
+static QList<PartitionInfo> findPartitions(QFile* dev, QString* error) {
+    dev->seek(0);
+    if (dev->read(4) == QByteArray("mfcq", 4))
+        return Splitter::readPartitions(dev, dev->size(), 0, error);
+
+    PartitionInfo raw(dev, 0, dev->size());
+    if (raw.type != FS_UNKNOWN)
+        return QList<PartitionInfo>() << raw;
+
+    QList<PartitionInfo> found;
+    QList<qint64> offsets = Splitter::readAutoloaderOffsets(dev, error);
+    for (int i = 0; i + 1 < offsets.count(); i++) {
+        qint64 size = offsets[i + 1] - offsets[i];
+        dev->seek(offsets[i]);
+        if (dev->read(4) == QByteArray("mfcq", 4))
+            found.append(Splitter::readPartitions(dev, size, offsets[i], error));
+        else
+            found.append(PartitionInfo(dev, offsets[i], size));
+    }
+    return found;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        fprintf(stderr, "Usage: %s <image.signed|autoloader.exe|image> <mountpoint> [FUSE options]\n", argv[0]);
+        fprintf(stderr, "Bar files are not supported; extract the .signed from them first.\n");
+        return 1;
+    }
+
+    QString fileName = QString::fromLocal8Bit(argv[1]);
+    image = new QFile(fileName);
+    if (!image->open(QIODevice::ReadOnly)) {
+        fprintf(stderr, "Could not open %s\n", argv[1]);
+        return 1;
+    }
+
+    QString error;
+    QList<PartitionInfo> infos = findPartitions(image, &error);
+    foreach (PartitionInfo info, infos) {
+        Partition p;
+        QString ext;
+        if (info.type == FS_QNX6) {
+            p.fs = new FS::QNX6(fileName, image, info.offset, info.size, ".");
+            ext = "qnx6";
+        } else if (info.type == FS_RCFS) {
+            p.fs = new FS::RCFS(fileName, image, info.offset, info.size, ".");
+            ext = "rcfs";
+        } else if (info.type == FS_IFS) {
+            p.fs = new FS::IFS(fileName, image, info.offset, info.size, ".");
+            ext = "ifs";
+        } else
+            continue;
+        // The whole tree is indexed up front. Not deleted on failure: a QFileSystem at offset 0 owns the image.
+        p.nodes = p.fs->nodeTable();
+        if (p.nodes == nullptr)
+            continue;
+        p.name = QString("p%1.%2").arg(partitions.count()).arg(ext);
+        fprintf(stderr, "%s: %u nodes, %lld KB index\n", p.name.toUtf8().constData(), p.nodes->count(), p.nodes->memoryUsage() / 1024);
+        partitions.append(p);
+    }
+    if (partitions.isEmpty()) {
+        fprintf(stderr, "No QNX6, RCFS or IFS partitions found. %s\n", error.toLocal8Bit().constData());
+        return 1;
+    }
+
+    struct fuse_operations ops;
+    memset(&ops, 0, sizeof(ops));
+    ops.getattr = sachesi_getattr;
+    ops.readdir = sachesi_readdir;
+    ops.open = sachesi_open;
+    ops.read = sachesi_read;
+    ops.readlink = sachesi_readlink;
+
+    // Single threaded: every partition shares the one QFile and its seek position
+    QList<QByteArray> args;
+    // The image never changes, so the kernel can keep what it was told
+    args << argv[0] << argv[2] << "-s" << "-o" << "ro,attr_timeout=3600,entry_timeout=3600";
+    for (int i = 3; i < argc; i++)
+        args << argv[i];
+    QVector<char*> fuseArgv;
+    for (int i = 0; i < args.count(); i++)
+        fuseArgv.append(args[i].data());
+    return fuse_main(fuseArgv.count(), fuseArgv.data(), &ops, nullptr);
+}
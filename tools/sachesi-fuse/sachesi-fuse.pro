@@ -0,0 +1,55 @@
+# Read-only FUSE mount of the QNX6/RCFS partitions in a .signed, Autoloader or raw image.
+# Requires libfuse 2.x (osxfuse on Mac).
+QT += widgets
+TEMPLATE = app
+TARGET = sachesi-fuse
+CONFIG += console c++11
+CONFIG -= app_bundle
+
+P = $$_PRO_FILE_PWD_/../..
+INCLUDEPATH += $$P/ext $$P/src
+DEFINES += _FILE_OFFSET_BITS=64
+
+CONFIG += link_pkgconfig
+PKGCONFIG += fuse
+LIBS += -lz
+
+SOURCES += \
+    main.cpp \
+    $$P/src/splitter.cpp \
+    $$P/src/ports.cpp \
+    $$P/src/portscore.cpp \
+    $$P/src/fs/fs.cpp \
+    $$P/src/fs/ifs.cpp \
+    $$P/src/fs/rcfs.cpp \
+    $$P/src/fs/qnx6.cpp \
+    $$P/src/fs/hash.cpp \
+    $$P/src/fs/sink.cpp \
+    $$P/src/fs/nodetable.cpp
+
+HEADERS += \
+    $$P/src/splitter.h \
+    $$P/src/ports.h \
+    $$P/src/portscore.h \
+    $$P/src/packedversion.h \
+    $$P/src/autoloaderwriter.h \
+    $$P/src/fs/fs.h \
+    $$P/src/fs/ifs.h \
+    $$P/src/fs/rcfs.h \
+    $$P/src/fs/qnx6.h \
+    $$P/src/fs/hash.h \
+    $$P/src/fs/sink.h \
+    $$P/src/fs/nodetable.h
+
+shared_quazip: LIBS += -lquazip
+else {
+    DEFINES += QUAZIP_STATIC
+    include($$P/ext/quazip/quazip.pri)
+}
+shared_lzo2 {
+    LIBS += -llzo2
+    DEFINES += _LZO2_SHARED
+} else {
+    SOURCES += $$P/src/lzo.cpp
+    HEADERS += $$P/src/lzo.h
+}
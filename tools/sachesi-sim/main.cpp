@@ -0,0 +1,126 @@
+// Copyright (C) 2014 Sacha Refshauge
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 3.0.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 3.0 for more details.
+
+// A copy of the GPL 3.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official GIT repository and contact information can be found at
+// http://github.com/xsacha/Sachesi
+
+// Stands in for the update, lookup and download servers so scans and downloads can be
+// run against something local, with as much latency, throttling and failure as wanted.
+// Point Sachesi at it with the serverOverride setting.
+
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QTimer>
+#include <stdio.h>
+
+#include "simserver.h"
+
+// How often the totals are printed (ms)
+#define SIM_STATS_INTERVAL 5000
+
+static int usage(const char* name) {
+    fprintf(stderr, "Usage: %s [options]\n", name);
+    fprintf(stderr, "  --port <n>            Port to listen on (default: 8080)\n");
+    fprintf(stderr, "  --data <dir>          Serve updateDetails.xml and srVersionLookup.xml from here instead of making them up\n");
+    fprintf(stderr, "  --latency <ms>        Delay before every response (default: 0)\n");
+    fprintf(stderr, "  --jitter <ms>         Up to this much extra delay (default: 0)\n");
+    fprintf(stderr, "  --rate <KB/s>         Per connection limit, 0 for none (default: 0)\n");
+    fprintf(stderr, "  --fail-rate <0-1>     Requests answered with 503 (default: 0)\n");
+    fprintf(stderr, "  --drop-rate <0-1>     Bodies cut off part way through (default: 0)\n");
+    fprintf(stderr, "  --redirect-rate <0-1> Files answered with a 302 first (default: 0)\n");
+    fprintf(stderr, "  --release-every <n>   OS builds with a release on beta servers. Production has half. (default: 10)\n");
+    fprintf(stderr, "  --apps <n>            Applications in each update (default: 40)\n");
+    fprintf(stderr, "  --app-size <KB>       Largest application (default: 4096)\n");
+    fprintf(stderr, "  --bar-size <KB>       OS and radio files (default: 65536)\n");
+    return 2;
+}
+
+int main(int argc, char* argv[]) {
+    QCoreApplication app(argc, argv);
+    qsrand(QDateTime::currentDateTime().toTime_t());
+
+    SimOptions options;
+    options.port = 8080;
+    options.latency = 0;
+    options.jitter = 0;
+    options.rate = 0;
+    options.failRate = 0;
+    options.dropRate = 0;
+    options.redirectRate = 0;
+    options.releaseEvery = 10;
+    options.apps = 40;
+    options.appSize = 4096 * 1024;
+    options.barSize = Q_INT64_C(65536) * 1024;
+
+    QStringList args = app.arguments();
+    for (int i = 1; i < args.count(); i++) {
+        QString arg = args.at(i);
+        if (i + 1 >= args.count())
+            return usage(argv[0]);
+        QString value = args.at(++i);
+        if (arg == "--port")
+            options.port = value.toUShort();
+        else if (arg == "--data")
+            options.dataDir = value;
+        else if (arg == "--latency")
+            options.latency = value.toInt();
+        else if (arg == "--jitter")
+            options.jitter = value.toInt();
+        else if (arg == "--rate")
+            options.rate = value.toLongLong() * 1024;
+        else if (arg == "--fail-rate")
+            options.failRate = value.toDouble();
+        else if (arg == "--drop-rate")
+            options.dropRate = value.toDouble();
+        else if (arg == "--redirect-rate")
+            options.redirectRate = value.toDouble();
+        else if (arg == "--release-every")
+            options.releaseEvery = value.toInt();
+        else if (arg == "--apps")
+            options.apps = value.toInt();
+        else if (arg == "--app-size")
+            options.appSize = value.toLongLong() * 1024;
+        else if (arg == "--bar-size")
+            options.barSize = value.toLongLong() * 1024;
+        else
+            return usage(argv[0]);
+    }
+
+    SimServer server(options);
+    if (!server.listen(QHostAddress::LocalHost, options.port)) {
+        fprintf(stderr, "Could not listen on port %d: %s\n", options.port, server.errorString().toLocal8Bit().constData());
+        return 1;
+    }
+    fprintf(stderr, "Listening on %s\n", server.baseUrl().toLatin1().constData());
+    fprintf(stderr, "Set serverOverride=%s in Sachesi's settings to use it.\n", server.baseUrl().toLatin1().constData());
+
+    // Only printed when something happened
+    SimStats last = server.stats();
+    QTimer statsTimer;
+    statsTimer.setInterval(SIM_STATS_INTERVAL);
+    QObject::connect(&statsTimer, &QTimer::timeout, [&]() {
+        SimStats now = server.stats();
+        if (now.requests == last.requests && now.bytes == last.bytes)
+            return;
+        double seconds = SIM_STATS_INTERVAL / 1000.0;
+        fprintf(stderr, "%lld requests (%.1f/s), %.1f MB sent (%.2f MB/s), %d connections, %lld faults\n",
+                now.requests, (now.requests - last.requests) / seconds,
+                now.bytes / 1048576.0, (now.bytes - last.bytes) / seconds / 1048576.0,
+                now.connections, now.faults);
+        last = now;
+    });
+    statsTimer.start();
+
+    return app.exec();
+}
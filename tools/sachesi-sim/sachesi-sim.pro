@@ -0,0 +1,13 @@
+# Local stand-in for the update servers: sachesi-sim [options]. See the README.
+QT = core network
+TEMPLATE = app
+TARGET = sachesi-sim
+CONFIG += console c++11
+CONFIG -= app_bundle
+
+SOURCES += \
+    main.cpp \
+    simserver.cpp
+
+HEADERS += \
+    simserver.h
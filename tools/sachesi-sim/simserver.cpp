@@ -0,0 +1,376 @@
+// Copyright (C) 2014 Sacha Refshauge
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 3.0.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 3.0 for more details.
+
+// A copy of the GPL 3.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official GIT repository and contact information can be found at
+// http://github.com/xsacha/Sachesi
+
+#include "simserver.h"
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QRegExp>
+#include <QStringList>
+
+static bool roll(double rate) {
+    return rate > 0 && qrand() < rate * RAND_MAX;
+}
+
+SimServer::SimServer(const SimOptions& options, QObject* parent)
+    : QTcpServer(parent)
+    , _options(options)
+{
+    _stats.requests = _stats.bytes = _stats.faults = 0;
+    _stats.connections = 0;
+}
+
+void SimServer::incomingConnection(qintptr socketDescriptor) {
+    QTcpSocket* socket = new QTcpSocket();
+    if (!socket->setSocketDescriptor(socketDescriptor)) {
+        delete socket;
+        return;
+    }
+    new SimConnection(this, socket);
+}
+
+qint64 SimServer::appSize(const QString& name) const {
+    // Somewhere between half and all of the largest size, always the same for a name
+    qint64 half = qMax(Q_INT64_C(1), _options.appSize / 2);
+    return half + qHash(name) % (half + 1);
+}
+
+SimServer::Response SimServer::route(const QByteArray& method, const QString& target, const QByteArray& body) {
+    Response response;
+    response.status = 404;
+    response.fileSize = -1;
+    response.fileSeed = 0;
+    if (roll(_options.failRate)) {
+        _stats.faults++;
+        response.status = 503;
+        return response;
+    }
+
+    QStringList path = target.split('?').first().split('/', QString::SkipEmptyParts);
+    QString host;
+    if (!path.isEmpty() && path.first().contains('.'))
+        host = path.takeFirst();
+    if (path.isEmpty())
+        return response;
+
+    if (method == "POST" && path.contains("updateDetails"))
+        return updateDetails(body);
+    if (method == "POST" && path.contains("srVersionLookup"))
+        return srVersionLookup(host, body);
+    if (method != "GET" && method != "HEAD")
+        return response;
+
+    if (path.first() == "fs") {
+        response = releaseFile(path);
+        // The CDN answers a release folder with a redirect to itself
+        if (response.status == 301)
+            response.headers << qMakePair(QByteArray("Location"), (baseUrl() + target + "/").toUtf8());
+        return response;
+    }
+    if (path.first() == "files" && path.count() == 3) {
+        if (roll(_options.redirectRate) && !target.contains("redirected=1")) {
+            _stats.faults++;
+            response.status = 302;
+            response.headers << qMakePair(QByteArray("Location"), (baseUrl() + target + "?redirected=1").toUtf8());
+            return response;
+        }
+        QString name = path.last();
+        response.status = 200;
+        response.fileSize = name.startsWith("sys.app") ? appSize(name) : _options.barSize;
+        response.fileSeed = qHash(name);
+    }
+    return response;
+}
+
+SimServer::Response SimServer::canned(const QString& name) {
+    Response response;
+    response.status = 404;
+    response.fileSize = -1;
+    response.fileSeed = 0;
+    if (_options.dataDir.isEmpty())
+        return response;
+    QFile file(QDir(_options.dataDir).filePath(name));
+    if (!file.open(QIODevice::ReadOnly))
+        return response;
+    response.status = 200;
+    response.headers << qMakePair(QByteArray("Content-Type"), QByteArray("text/xml;charset=UTF-8"));
+    response.body = file.readAll();
+    return response;
+}
+
+SimServer::Response SimServer::updateDetails(const QByteArray& body) {
+    Response response = canned("updateDetails.xml");
+    if (response.status == 200)
+        return response;
+
+    QString request = QString::fromUtf8(body);
+    QRegExp hwidExp("<id>0x([0-9A-Fa-f]+)</id>");
+    QString hwid = hwidExp.indexIn(request) >= 0 ? hwidExp.cap(1).toUpper() : "UNKNOWN";
+    QRegExp echoExp("authEchoTS=\"([0-9]*)\"");
+    QString echo = echoExp.indexIn(request) >= 0 ? echoExp.cap(1) : "0";
+
+    // Devices get one of a few releases, so a scan of all of them has a handful of distinct answers
+    int build = 2000 + (qHash(hwid) % 8) * qMax(1, _options.releaseEvery);
+    QString os = QString("10.3.3.%1").arg(build);
+    QString radio = QString("10.3.3.%1").arg(build + 1);
+    QString release = QString("10.3.3.%1").arg(build + 1000);
+
+    QString xml = QString("<?xml version=\"1.0\" encoding=\"UTF-8\"?>"
+                          "<updateDetailResponse version=\"2.2.1\" authEchoTS=\"%1\"><data authEchoTS=\"%1\">"
+                          "<softwareReleaseMetadata softwareReleaseVersion=\"%2\" isSecurity=\"false\"/>"
+                          "<fileSets><fileSet url=\"%3/files/%2\">")
+            .arg(echo).arg(release).arg(baseUrl());
+    QString package("<package id=\"%1\" name=\"%2\" path=\"%3\" downloadSize=\"%4\" operation=\"add\" version=\"%5\" type=\"%6\"/>");
+    xml += package.arg("os-" + hwid).arg("qc8960.factory_sfi").arg("qc8960.factory_sfi-" + os + "-nto+armle-v7+signed.bar")
+            .arg(_options.barSize).arg(os).arg("system:os");
+    xml += package.arg("radio-" + hwid).arg("qc8960.wtr5").arg("qc8960.wtr5-" + radio + "-nto+armle-v7+signed.bar")
+            .arg(_options.barSize).arg(radio).arg("system:radio");
+    for (int i = 0; i < _options.apps; i++) {
+        QString version = QString("1.0.%1.%2").arg(build).arg(i);
+        QString name = QString("sys.app%1-%2-nto+armle-v7+signed.bar").arg(i).arg(version);
+        xml += package.arg(QString("app-%1").arg(i)).arg(QString("sys.app%1").arg(i)).arg(name)
+                .arg(appSize(name)).arg(version).arg("");
+    }
+    xml += "</fileSet></fileSets></data></updateDetailResponse>";
+
+    response.status = 200;
+    response.headers << qMakePair(QByteArray("Content-Type"), QByteArray("text/xml;charset=UTF-8"));
+    response.body = xml.toUtf8();
+    return response;
+}
+
+SimServer::Response SimServer::srVersionLookup(const QString& host, const QByteArray& body) {
+    Response response = canned("srVersionLookup.xml");
+    if (response.status == 200)
+        return response;
+
+    QRegExp osExp("<osVersion>([0-9.]+)</osVersion>");
+    QString os = osExp.indexIn(QString::fromUtf8(body)) >= 0 ? osExp.cap(1) : QString();
+    QStringList parts = os.split('.');
+    QString found;
+    if (parts.count() == 4 && _options.releaseEvery > 0) {
+        int build = parts.last().toInt();
+        bool production = host.isEmpty() || host.startsWith("cs");
+        int every = production ? _options.releaseEvery * 2 : _options.releaseEvery;
+        if (build % every == 0) {
+            parts.last() = QString::number(build + 1000);
+            found = parts.join(".");
+            // The release folder is named after the SHA1 of the release
+            QString folder = QCryptographicHash::hash(found.toLatin1(), QCryptographicHash::Sha1).toHex();
+            _releases.insert(folder, os);
+        }
+    }
+    response.status = 200;
+    response.headers << qMakePair(QByteArray("Content-Type"), QByteArray("text/xml;charset=UTF-8"));
+    response.body = found.isEmpty()
+            ? QByteArray("<srVersionLookupResponse version=\"2.0.0\"/>")
+            : QString("<srVersionLookupResponse version=\"2.0.0\"><softwareReleaseVersion>%1</softwareReleaseVersion></srVersionLookupResponse>").arg(found).toUtf8();
+    return response;
+}
+
+// fs/qnx/production/<sha1>[/<file>]. Releases have the OS at their OS build and radios one build later.
+SimServer::Response SimServer::releaseFile(const QStringList& path) {
+    Response response;
+    response.status = 404;
+    response.fileSize = -1;
+    response.fileSeed = 0;
+    if (path.count() < 4 || !_releases.contains(path.at(3)))
+        return response;
+    if (path.count() == 4) {
+        response.status = 301;
+        return response;
+    }
+    QString os = _releases.value(path.at(3));
+    QStringList parts = os.split('.');
+    parts.last() = QString::number(parts.last().toInt() + 1);
+    QString radio = parts.join(".");
+    QString name = path.last();
+    if (path.count() == 5 && (name.contains("-" + os + "-") || name.contains("-" + radio + "-"))) {
+        response.status = 200;
+        response.fileSize = _options.barSize;
+        response.fileSeed = qHash(name);
+    }
+    return response;
+}
+
+SimConnection::SimConnection(SimServer* server, QTcpSocket* socket)
+    : QObject(server)
+    , _server(server)
+    , _socket(socket)
+    , _busy(false)
+    , _close(false)
+    , _pos(0), _end(0), _dropAt(-1), _allowance(0)
+{
+    _socket->setParent(this);
+    _server->stats().connections++;
+    _delay.setSingleShot(true);
+    _throttle.setInterval(SIM_THROTTLE_TICK);
+    connect(&_delay, SIGNAL(timeout()), this, SLOT(respond()));
+    connect(&_throttle, SIGNAL(timeout()), this, SLOT(pump()));
+    connect(_socket, SIGNAL(readyRead()), this, SLOT(readRequests()));
+    connect(_socket, SIGNAL(bytesWritten(qint64)), this, SLOT(pump()));
+    connect(_socket, SIGNAL(disconnected()), this, SLOT(deleteLater()));
+}
+
+SimConnection::~SimConnection() {
+    _server->stats().connections--;
+}
+
+void SimConnection::readRequests() {
+    _buffer.append(_socket->readAll());
+    if (_busy)
+        return;
+    int headerEnd = _buffer.indexOf("\r\n\r\n");
+    if (headerEnd < 0) {
+        // Nobody sends headers this big
+        if (_buffer.size() > 1024 * 1024)
+            _socket->abort();
+        return;
+    }
+    QList<QByteArray> lines = _buffer.left(headerEnd).split('\n');
+    QList<QByteArray> requestLine = lines.takeFirst().trimmed().split(' ');
+    if (requestLine.count() < 3) {
+        _socket->abort();
+        return;
+    }
+    QHash<QByteArray, QByteArray> headers;
+    foreach (QByteArray line, lines) {
+        int colon = line.indexOf(':');
+        if (colon > 0)
+            headers.insert(line.left(colon).trimmed().toLower(), line.mid(colon + 1).trimmed());
+    }
+    qint64 length = headers.value("content-length").toLongLong();
+    if (_buffer.size() < headerEnd + 4 + length)
+        return;
+
+    _method = requestLine.at(0);
+    _target = QString::fromUtf8(requestLine.at(1));
+    _range = headers.value("range");
+    _close = requestLine.at(2) == "HTTP/1.0" || headers.value("connection").toLower() == "close";
+    _requestBody = _buffer.mid(headerEnd + 4, length);
+    _buffer.remove(0, headerEnd + 4 + length);
+    _busy = true;
+
+    const SimOptions& options = _server->options();
+    _delay.start(options.latency + (options.jitter > 0 ? qrand() % (options.jitter + 1) : 0));
+}
+
+void SimConnection::respond() {
+    _response = _server->route(_method, _target, _requestBody);
+    _server->stats().requests++;
+
+    int status = _response.status;
+    QList<QPair<QByteArray, QByteArray> > headers = _response.headers;
+    _pos = 0;
+    _end = _response.fileSize >= 0 ? _response.fileSize : _response.body.size();
+    if (_response.fileSize >= 0) {
+        headers << qMakePair(QByteArray("Accept-Ranges"), QByteArray("bytes"));
+        QRegExp rangeExp("bytes=(\\d*)-(\\d*)");
+        if (status == 200 && rangeExp.exactMatch(QString::fromLatin1(_range))) {
+            qint64 size = _response.fileSize;
+            qint64 start, end;
+            if (rangeExp.cap(1).isEmpty()) {
+                start = qMax(Q_INT64_C(0), size - rangeExp.cap(2).toLongLong());
+                end = size;
+            } else {
+                start = rangeExp.cap(1).toLongLong();
+                end = rangeExp.cap(2).isEmpty() ? size : qMin(size, rangeExp.cap(2).toLongLong() + 1);
+            }
+            if (start >= size || start >= end) {
+                status = 416;
+                headers << qMakePair(QByteArray("Content-Range"), QString("bytes */%1").arg(size).toLatin1());
+                _end = 0;
+            } else {
+                status = 206;
+                headers << qMakePair(QByteArray("Content-Range"), QString("bytes %1-%2/%3").arg(start).arg(end - 1).arg(size).toLatin1());
+                _pos = start;
+                _end = end;
+            }
+        }
+    }
+
+    QByteArray head = "HTTP/1.1 " + QByteArray::number(status) + " Sim\r\n";
+    headers << qMakePair(QByteArray("Content-Length"), QByteArray::number(_end - _pos));
+    if (_close)
+        headers << qMakePair(QByteArray("Connection"), QByteArray("close"));
+    for (int i = 0; i < headers.count(); i++)
+        head += headers.at(i).first + ": " + headers.at(i).second + "\r\n";
+    head += "\r\n";
+    _socket->write(head);
+
+    if (_method == "HEAD")
+        _end = _pos;
+    _dropAt = (_end > _pos && roll(_server->options().dropRate)) ? _pos + qrand() % (_end - _pos) : -1;
+    _allowance = 0;
+    pump();
+}
+
+void SimConnection::pump() {
+    if (!_busy || _delay.isActive())
+        return;
+    qint64 rate = _server->options().rate;
+    if (rate > 0 && sender() == &_throttle)
+        _allowance = qMin(rate, _allowance + rate * SIM_THROTTLE_TICK / 1000);
+    while (_pos < _end && _socket->bytesToWrite() < SIM_SOCKET_BUFFER) {
+        qint64 n = qMin((qint64)SIM_CHUNK, _end - _pos);
+        if (rate > 0)
+            n = qMin(n, _allowance);
+        if (_dropAt >= 0)
+            n = qMin(n, _dropAt - _pos);
+        if (n <= 0)
+            break;
+        QByteArray chunk;
+        if (_response.fileSize >= 0) {
+            chunk.resize(n);
+            char* data = chunk.data();
+            for (qint64 i = 0; i < n; i++)
+                data[i] = SimServer::fileByte(_response.fileSeed, _pos + i);
+        } else {
+            chunk = _response.body.mid(_pos, n);
+        }
+        _socket->write(chunk);
+        _pos += n;
+        _server->stats().bytes += n;
+        if (rate > 0)
+            _allowance -= n;
+    }
+    if (_dropAt >= 0 && _pos >= _dropAt) {
+        _server->stats().faults++;
+        _busy = false;
+        _socket->abort();
+        return;
+    }
+    if (_pos < _end) {
+        if (rate > 0 && !_throttle.isActive())
+            _throttle.start();
+        return;
+    }
+    finishResponse();
+}
+
+void SimConnection::finishResponse() {
+    _busy = false;
+    _throttle.stop();
+    _response = SimServer::Response();
+    if (_close) {
+        _socket->disconnectFromHost();
+        return;
+    }
+    // The next pipelined request may already be here
+    if (!_buffer.isEmpty())
+        readRequests();
+}
@@ -0,0 +1,127 @@
+// Copyright (C) 2014 Sacha Refshauge
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 3.0.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 3.0 for more details.
+
+// A copy of the GPL 3.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official GIT repository and contact information can be found at
+// http://github.com/xsacha/Sachesi
+
+#pragma once
+
+#include <QObject>
+#include <QHash>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTimer>
+
+// How much of a body is handed to the socket at a time
+#define SIM_CHUNK (64 * 1024)
+// The socket is refilled once less than this is waiting to be sent
+#define SIM_SOCKET_BUFFER (256 * 1024)
+// How often a throttled body is topped up (ms)
+#define SIM_THROTTLE_TICK 20
+
+struct SimOptions {
+    quint16 port;
+    QString dataDir; // Canned updateDetails.xml and srVersionLookup.xml, used instead of generated ones
+    int latency; // Before every response (ms)
+    int jitter; // Up to this much more (ms)
+    qint64 rate; // Per connection (bytes/s), 0 for no limit
+    double failRate; // Answered with 503
+    double dropRate; // Connection closed part way through the body
+    double redirectRate; // Files answered with a 302 to themselves
+    int releaseEvery; // OS builds with a release on beta and alpha. Production has every second one.
+    int apps; // Applications in an update
+    qint64 appSize; // Largest application
+    qint64 barSize; // OS and radio files
+};
+
+struct SimStats {
+    qint64 requests;
+    qint64 bytes;
+    qint64 faults;
+    int connections;
+};
+
+// An HTTP/1.1 server that stands in for the update, lookup and download servers.
+// Requests that were sent through serverUrl() have the original host as the first part of the path.
+class SimServer : public QTcpServer {
+    Q_OBJECT
+public:
+    SimServer(const SimOptions& options, QObject* parent = 0);
+
+    const SimOptions& options() const { return _options; }
+    SimStats& stats() { return _stats; }
+    QString baseUrl() const { return QString("http://127.0.0.1:%1").arg(serverPort()); }
+
+    // What a request gets. 'body' is empty for files, which are made up as they are sent.
+    struct Response {
+        int status;
+        QList<QPair<QByteArray, QByteArray> > headers;
+        QByteArray body;
+        qint64 fileSize; // -1 unless the body is a file
+        quint32 fileSeed;
+    };
+    Response route(const QByteArray& method, const QString& target, const QByteArray& body);
+
+    // Every byte of a made up file can be worked out from its position, so ranges are cheap
+    static char fileByte(quint32 seed, qint64 pos) { return (char)((pos * 31 + seed) >> (pos & 3)); }
+    qint64 appSize(const QString& name) const;
+
+protected:
+    void incomingConnection(qintptr socketDescriptor);
+
+private:
+    Response updateDetails(const QByteArray& body);
+    Response srVersionLookup(const QString& host, const QByteArray& body);
+    Response releaseFile(const QStringList& path);
+    Response canned(const QString& name);
+
+    SimOptions _options;
+    SimStats _stats;
+    // Releases handed out by srVersionLookup, by the SHA1 their folder is named after
+    QHash<QString, QString> _releases;
+};
+
+// One client connection. Requests are answered in order, so pipelining works.
+class SimConnection : public QObject {
+    Q_OBJECT
+public:
+    SimConnection(SimServer* server, QTcpSocket* socket);
+    ~SimConnection();
+
+private slots:
+    void readRequests();
+    void respond();
+    void pump();
+
+private:
+    void finishResponse();
+
+    SimServer* _server;
+    QTcpSocket* _socket;
+    QByteArray _buffer;
+    bool _busy;
+    bool _close;
+    // The request being answered
+    QByteArray _method;
+    QString _target;
+    QByteArray _range;
+    QByteArray _requestBody;
+    // The body being sent
+    SimServer::Response _response;
+    qint64 _pos, _end;
+    qint64 _dropAt;
+    qint64 _allowance;
+    QTimer _delay;
+    QTimer _throttle;
+};